@@ -0,0 +1,71 @@
+#!/bin/sh
+# Compile time of feather on generated programs, scaling one parameter of
+# the generator at a time; the other options go to feather (-O for instance).
+#
+#    sh bench/bench.sh exe/feather exe/generate obj/bench.c [options]
+#
+# Each line gives the input size, the time of the main phases measured by
+# --time-report (the dumps are not counted), the remaining phases, their
+# sum and the throughput in lines per second.
+
+if [ $# -lt 3 ]; then
+  echo "usage: $0 feather generate input.c [options of feather]" >&2
+  exit 1
+fi
+FEATHER=$1
+GENERATE=$2
+INPUT=$3
+shift 3
+
+printf '%-10s %6s %8s %8s %9s %9s %9s %9s %9s %9s %10s %11s %9s\n' series value lines instr \
+  "parse ms" "dom ms" "front ms" "phi ms" "rename ms" "other ms" "total ms" "lines/s" "rss kB"
+
+# series value arguments of the generator
+run() {
+  series=$1
+  value=$2
+  shift 2
+  "$GENERATE" "$@" > "$INPUT" || exit 1
+  lines=$(wc -l < "$INPUT")
+  "$FEATHER" --time-report $OPTIONS "$INPUT" 2>&1 >/dev/null | awk -v series="$series" \
+      -v value="$value" -v lines="$lines" '
+    substr($0, 18, 5) == "total" {
+      phase = substr($0, 1, 16)
+      sub(/ +$/, "", phase)
+      wall = $(NF-6)
+      total += wall
+      if (phase in main)
+        main[phase] += wall
+      else
+        other += wall
+      if ($(NF-4) > rss)
+        rss = $(NF-4)
+      instructions = $(NF-3)
+    }
+    BEGIN {
+      main["parse"] = 0; main["dominators"] = 0; main["frontiers"] = 0
+      main["phi insertion"] = 0; main["renaming"] = 0
+    }
+    END {
+      printf "%-10s %6s %8d %8d %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %10.1f %11.0f %9d\n", series, value,
+        lines, instructions, main["parse"], main["dominators"], main["frontiers"], main["phi insertion"],
+        main["renaming"], other, total, (total > 0) ? lines*1000.0/total : 0, rss
+    }'
+}
+
+OPTIONS="$*"
+for functions in 1 10 100 1000; do
+  run functions $functions --functions=$functions --statements=200
+done
+for statements in 250 1000 4000 16000; do
+  run statements $statements --statements=$statements
+done
+for depth in 0 2 4 8; do
+  run depth $depth --statements=1000 --depth=$depth
+done
+for loops in 0 4 16 64; do
+  run loops $loops --statements=2000 --loops=$loops
+done
+for variables in 8 64 512 4096; do
+  run variables $variables --statements=2000 --variables=$variables
+done
@@ -0,0 +1,190 @@
+// Generator of synthetic SimpleC translation units, used to measure feather
+// on inputs much larger than the samples of the exe directory.
+//
+//    g++ -o generate bench/generate.cpp
+//    ./generate [functions [statements]] [--depth=N] [--loops=N] [--variables=N] [--main] > input.c
+//
+// Each function declares its variables and runs its statements, spread on
+// its loops. With a depth, every if opens a chain of nested blocks, each
+// declaring a variable, so the lookups go through that many scopes. With
+// --main, a main function returns the sum of the results of all functions,
+// so the unit runs and its exit code can be compared with gcc.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+class Parameters {
+public:
+  int functions;
+  // statements of the body of each function, outside the nested blocks
+  int statements;
+  // blocks nested in the then branch of each if
+  int depth;
+  // while loops of each function, sharing its statements
+  int loops;
+  int variables;
+  // a main calling every function
+  bool main;
+
+  Parameters()
+    : functions(1), statements(1000), depth(0), loops(0), variables(8), main(false) {}
+};
+
+Parameters parameters;
+
+void printVariable(std::ostream& out, int index)
+{  out << 'v' << (index % parameters.variables); }
+
+void printIndent(std::ostream& out, int indent)
+{  for (int column = 0; column < indent; ++column)
+    out << ' ';
+}
+
+void printStatement(std::ostream& out, int index, int depth, int indent)
+{  printIndent(out, indent);
+  switch (index % 4) {
+    case 0:
+      printVariable(out, index);
+      out << " = ";
+      printVariable(out, index+1);
+      out << " + " << (index % 17) << " * ";
+      printVariable(out, index+2);
+      out << ";\n";
+      break;
+    case 1:
+      out << "if (";
+      printVariable(out, index);
+      out << " < " << (index % 31) << ") {\n";
+      if (depth > 0) {
+        // the block declares its own variable and nests the next statements
+        printIndent(out, indent+2);
+        out << "int w" << depth << ";\n";
+        printIndent(out, indent+2);
+        out << 'w' << depth << " = ";
+        printVariable(out, index+3);
+        out << " - 1;\n";
+        for (int nested = 2; nested <= 4; ++nested)
+          printStatement(out, index+nested, depth-1, indent+2);
+        printIndent(out, indent+2);
+        printVariable(out, index+3);
+        out << " = w" << depth << ";\n";
+      }
+      else {
+        printIndent(out, indent+2);
+        printVariable(out, index+3);
+        out << " = ";
+        printVariable(out, index+3);
+        out << " - 1;\n";
+      };
+      printIndent(out, indent);
+      out << "}\n";
+      printIndent(out, indent);
+      out << "else {\n";
+      printIndent(out, indent+2);
+      printVariable(out, index+4);
+      out << " = ";
+      printVariable(out, index+1);
+      out << ";\n";
+      printIndent(out, indent);
+      out << "};\n";
+      break;
+    case 2:
+      out << "do {\n";
+      printIndent(out, indent+2);
+      printVariable(out, index);
+      out << " = ";
+      printVariable(out, index);
+      out << " + 2;\n";
+      printIndent(out, indent);
+      out << "} while (";
+      printVariable(out, index);
+      out << " < " << (index % 100) << ");\n";
+      break;
+    default:
+      printVariable(out, index+5);
+      out << " = (";
+      printVariable(out, index+6);
+      out << " - ";
+      printVariable(out, index+7);
+      out << ") / 3;\n";
+      break;
+  };
+}
+
+void printFunction(std::ostream& out, int function)
+{  out << "int function" << function << "(int argc) {\n";
+  for (int variable = 0; variable < parameters.variables; ++variable)
+    out << "  int v" << variable << ";\n";
+  for (int loop = 0; loop < parameters.loops; ++loop)
+    out << "  int i" << loop << ";\n";
+  for (int variable = 0; variable < parameters.variables; ++variable)
+    out << "  v" << variable << " = argc;\n";
+  // the statements before the first loop, then the ones of each loop
+  int loopStatements = parameters.statements / (parameters.loops + 1);
+  int statement = 0;
+  for (; statement < parameters.statements - parameters.loops*loopStatements; ++statement)
+    printStatement(out, statement, parameters.depth, 2);
+  for (int loop = 0; loop < parameters.loops; ++loop) {
+    out << "  i" << loop << " = 0;\n  while (i" << loop << " < 4) {\n";
+    for (int last = statement + loopStatements; statement < last; ++statement)
+      printStatement(out, statement, parameters.depth, 4);
+    out << "    i" << loop << " = i" << loop << " + 1;\n  };\n";
+  };
+  out << "  return v0;\n}\n\n";
+}
+
+void printMain(std::ostream& out)
+{  out << "int main(int argc) {\n  int result;\n  result = 0;\n";
+  for (int function = 0; function < parameters.functions; ++function)
+    out << "  result = result + function" << function << "(argc);\n";
+  out << "  return result;\n}\n";
+}
+
+// --name=value, the value being copied to result
+bool readOption(const char* argument, const char* name, int& result)
+{  int length = std::strlen(name);
+  if (std::strncmp(argument, name, length) != 0 || argument[length] != '=')
+    return false;
+  result = std::atoi(argument+length+1);
+  return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{  int positional = 0;
+  for (int argIndex = 1; argIndex < argc; ++argIndex) {
+    const char* argument = argv[argIndex];
+    if (readOption(argument, "--functions", parameters.functions)
+        || readOption(argument, "--statements", parameters.statements)
+        || readOption(argument, "--depth", parameters.depth)
+        || readOption(argument, "--loops", parameters.loops)
+        || readOption(argument, "--variables", parameters.variables))
+      continue;
+    if (std::strcmp(argument, "--main") == 0) {
+      parameters.main = true;
+      continue;
+    };
+    if (argument[0] == '-') {
+      std::cerr << "usage: " << argv[0] << " [functions [statements]] [--functions=N] [--statements=N]"
+        " [--depth=N] [--loops=N] [--variables=N] [--main]" << std::endl;
+      return 1;
+    };
+    if (positional++ == 0)
+      parameters.functions = std::atoi(argument);
+    else
+      parameters.statements = std::atoi(argument);
+  };
+  if (parameters.variables < 1)
+    parameters.variables = 1;
+  if (parameters.loops < 0)
+    parameters.loops = 0;
+  for (int function = 0; function < parameters.functions; ++function)
+    printFunction(std::cout, function);
+  if (parameters.main)
+    printMain(std::cout);
+  return 0;
+}
@@ -0,0 +1,31 @@
+/* Nested ifs declaring their own variables, then a do loop on b: the phi
+   function of the loop must read the b assigned in the loop on its back
+   edge, and the one of the entry after the ifs */
+int main(int argc) {
+  int a;
+  int b;
+  a = argc;
+  b = 1;
+  if (b < 7) {
+    int w1;
+    w1 = a;
+    if (w1 < 4) {
+      int w2;
+      w2 = a + 1;
+      if (a < 4) {
+        int w3;
+        w3 = w1 + 1;
+        b = a + 2;
+        b = w3;
+      };
+      a = b + 3;
+      b = w2;
+    };
+    a = w1;
+  };
+  b = a + 2;
+  do {
+    b = b + 2;
+  } while (b < 14);
+  return a + b;
+}
@@ -0,0 +1,27 @@
+/* The phi function of a, constant on both edges of the loop, is folded by
+   --sccp before the phi functions of x, y, s and i, which keep their copies */
+int main(int argc) {
+  int a;
+  int x;
+  int y;
+  int t;
+  int s;
+  int i;
+  a = 2;
+  x = argc;
+  y = 7;
+  s = 0;
+  i = 0;
+  do {
+    t = x;
+    x = y;
+    y = t;
+    if (x < y) {
+      a = 5;
+    };
+    s = s + a * x;
+    a = 2;
+    i = i + 1;
+  } while (i < 6);
+  return s;
+}
@@ -0,0 +1,23 @@
+/* f0 has an if and is inlined in a do loop: the back edge phi of v0 must
+   read the value of the expanded body, not its own result */
+int f0(int a0, int a1) {
+  int l0;
+  l0 = a0 * 2;
+  if (l0 < a1) {
+    l0 = a1 - l0;
+  };
+  return l0;
+}
+int main(int argc) {
+  int v0;
+  int k1;
+  v0 = 1;
+  k1 = 0;
+  do {
+    if (argc) {
+      v0 = f0(0 - 3, 3);
+    };
+    k1 = k1 + 1;
+  } while (k1 < 3);
+  return v0 + k1;
+}
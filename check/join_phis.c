@@ -0,0 +1,35 @@
+/* The join of the if of mix has a phi function for each of d, x, y and c,
+   the one of d being constant; the loop of main calls it with -O */
+int mix(int n, int a, int b) {
+  int d;
+  int x;
+  int y;
+  int c;
+  x = a;
+  y = b;
+  c = x;
+  d = 3;
+  if (n < 4) {
+    d = 3;
+    c = y;
+    y = x + n;
+    x = c;
+  }
+  else {
+    d = 3;
+    x = y - n;
+    y = c;
+  };
+  return x * 7 + y * 3 + c + d;
+}
+int main(int argc) {
+  int i;
+  int s;
+  s = 0;
+  i = 0;
+  while (i < 8) {
+    s = s + mix(i, i + argc, s / 5) / 9;
+    i = i + 1;
+  };
+  return s;
+}
@@ -0,0 +1,21 @@
+/* The then branch of an if is a loop, followed by another loop: the join
+   of the if and the head of the second loop both have phi functions of s */
+int main(int argc) {
+  int s;
+  int i;
+  int j;
+  s = argc;
+  i = 0;
+  j = 0;
+  if (s < 3) {
+    while (i < 4) {
+      s = s + i;
+      i = i + 1;
+    };
+  };
+  while (j < 5) {
+    s = s + 2;
+    j = j + 1;
+  };
+  return s + i;
+}
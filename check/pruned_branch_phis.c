@@ -0,0 +1,71 @@
+/* The first condition of main is constant: the phi functions of its join
+   keep a single operand and become copies, the others of the loops stay */
+int f0(int a0, int a1) {
+  int l0;
+  int l1;
+  l0 = (-(a0 / 5));
+  l1 = (13 + 7);
+  l1 = ((11 + 2) < (a0 + (a0 / 1)));
+  l1 = 17;
+  return (l0 < l1);
+}
+int main(int argc, char** argv) {
+  int v0;
+  int v1;
+  int v2;
+  int v3;
+  int v4;
+  int c0;
+  int c1;
+  int c2;
+  int c3;
+  v0 = 0;
+  v1 = argc;
+  v2 = 9;
+  v3 = argc;
+  v4 = argc;
+  c0 = 0;
+  c1 = 0;
+  c2 = 0;
+  c3 = 0;
+  v2 = (-v2);
+  v2 = c3;
+  v1 = ((7 + c1) * v4);
+  v0 = (f0(c0, f0(v2, v2)) * (v3 + (v2 <= v2)));
+  if ((v4 * c0) >= ((c3 * 16) / 7)) {
+    v0 = (((10 / 6) * v4) - (-v0));
+    v2 = (-17);
+    if (f0(c1, c1) < 12) {
+      v1 = f0(12, ((c1 + v2) < (v1 <= c0)));
+      v4 = (-c3);
+      c3 = 0;
+      do {
+        v4 = v4;
+        c3 = c3 + 1;
+      } while (c3 < 5);
+    } else {
+      v3 = (-((1 - 11) < c1));
+      v3 = c3;
+    };
+  } else {
+    if (((13 * v3) + (18 / 4)) < (6 - c3)) {
+      v3 = f0(((v1 - v4) + (c1 * c0)), (c3 >= 6));
+      v2 = (c2 * 0);
+      v0 = 19;
+    } else {
+      v3 = c0;
+    };
+    if ((-(c3 == c3)) == c0) {
+      c2 = 0;
+      do {
+        v2 = (((c3 / 5) + (-c1)) + (c1 / 7));
+        v3 = (10 + (-(c1 / 1)));
+        c2 = c2 + 1;
+      } while (c2 < 0);
+    };
+  };
+  v2 = c3;
+  v3 = ((c2 * (11 - 14)) + (f0(v4, 20) / 2));
+  v1 = 10;
+  return (v0 + v1 + v2 + v3 + v4) - ((v0 + v1 + v2 + v3 + v4) / 256) * 256;
+}
@@ -0,0 +1,23 @@
+/* After --sccp, c1 is the constant 0 and c2 * 3 is reduced in the do loop:
+   the reduction looks up the variables it has just declared, which the
+   def-use chains built before it do not know */
+int main(int argc) {
+  int v1;
+  int c1;
+  int c2;
+  int c3;
+  int s;
+  s = 0;
+  c1 = 0;
+  c3 = 0;
+  while (c3 < 4) {
+    c2 = 0;
+    do {
+      v1 = (-c2) * ((-c1) * c2);
+      s = s + v1 + c2 * 3;
+      c2 = c2 + 1;
+    } while (c2 < 5);
+    c3 = c3 + 1;
+  };
+  return s;
+}
@@ -0,0 +1,19 @@
+/* Two sibling blocks declare their own w, the first one assigning it
+   twice: the versions of the first w stay in its table, the second w
+   reads its own definition */
+int main(int argc) {
+  int s;
+  s = argc;
+  {
+    int w;
+    w = s + 1;
+    w = w * 2;
+    s = w;
+  };
+  {
+    int w;
+    w = s + 5;
+    s = s + w;
+  };
+  return s;
+}
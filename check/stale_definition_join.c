@@ -0,0 +1,17 @@
+/* b is assigned twice before the if and a third time in its else: the
+   operand of the then edge of the join must read the second definition of
+   b, not the first one */
+int main(int argc) {
+  int a;
+  int b;
+  a = 1;
+  b = 10;
+  b = 20;
+  if (argc) {
+    a = 2;
+  }
+  else {
+    b = 30;
+  };
+  return a + b;
+}
@@ -3,7 +3,7 @@
 
 #include "SyntaxTree.h"
 
-enum TypeTask { TTUndefined, TTPrint, TTDomination, TTPhiInsertion, TTLabelPhiFrontier, TTRenaming };
+enum TypeTask { TTUndefined, TTPrint, TTDomination, TTPhiInsertion, TTLabelPhiFrontier };
 
 class PrintTask : public VirtualTask {
 public:
@@ -21,22 +21,11 @@ public:
 class PrintAgenda : public WorkList {
 public:
   std::ostream& m_out;
-  std::list<VirtualInstruction*> m_markedInstruction;
 
 public:
   PrintAgenda(std::ostream& out, const Function& function)
   :  m_out(out)
   {  addNewAsFirst(new PrintTask(function.getFirstInstruction())); }
-  virtual ~PrintAgenda()
-  {  for (std::list<VirtualInstruction*>::iterator iter = m_markedInstruction.begin();
-    iter != m_markedInstruction.end(); ++iter)
-    (*iter)->mark = NULL;
-    m_markedInstruction.clear();
-  }
-  virtual void markInstructionWith(VirtualInstruction& instruction, VirtualTask& task)
-  {  m_markedInstruction.push_back(&instruction);
-    instruction.mark = (void*) 1;
-  }
 };
 
 class DominationTask : public VirtualTask {
@@ -116,10 +105,12 @@ public:
   std::set<VirtualExpression*, IsBefore> m_modified;
   bool m_isLValue;
   typedef std::set<VirtualExpression*, IsBefore> ModifiedVariables;
+  // gotos through which a join receives a new value of a variable
+  typedef SmallArray<GotoInstruction*, 2> Origins;
   class LabelResult
   {
   private:
-    typedef std::map<VirtualExpression*, std::pair<GotoInstruction*, GotoInstruction*>, PhiInsertionTask::IsBefore> Map;
+    typedef std::map<VirtualExpression*, Origins, PhiInsertionTask::IsBefore> Map;
     Map m_map;
     bool m_hasMark;
     Scope m_scope;
@@ -140,7 +131,7 @@ public:
     }
     LocalVariableExpression getAfterScopeLocalVariable() const
     {
-      return LocalVariableExpression(std::string(), m_scope.count(), m_scope);
+      return LocalVariableExpression(Atoms::AEmpty, m_scope.count(), m_scope);
     }
     Map& map()
     {
@@ -187,40 +178,67 @@ public:
 class PhiInsertionAgenda : public WorkList
 {
 private:
+  typedef PhiInsertionTask::LabelResult LabelResult;
   std::vector<LabelInstruction*> m_labels;
+  // Result of each label, indexed by registration index.
+  std::vector<LabelResult*> m_labelResults;
+
 public:
   PhiInsertionAgenda(const Function& function)
   {
+    m_labelResults.resize(function.countInstructions(), NULL);
     addNewAsFirst(new PhiInsertionTask(function));
   }
   virtual ~PhiInsertionAgenda()
   {
-    for (std::vector<LabelInstruction*>::iterator labelIter = m_labels.begin(); labelIter != m_labels.end(); ++labelIter)
+    for (std::vector<LabelResult*>::iterator resultIter = m_labelResults.begin(); resultIter != m_labelResults.end(); ++resultIter)
     {
-      if ((*labelIter)->mark)
+      if (*resultIter)
       {
-        delete (PhiInsertionTask::LabelResult*) (*labelIter)->mark;
-        (*labelIter)->mark = NULL;
+        delete *resultIter;
       }
     }
-    m_labels.clear();
   }
   const std::vector<LabelInstruction*>& labels() const
   {
     return m_labels;
   }
+  LabelResult& labelResult(const VirtualInstruction& label)
+  {
+    assert(dynamic_cast<const LabelInstruction*>(&label));
+    int index = label.getRegistrationIndex();
+    if (index >= (int) m_labelResults.size())
+    {
+      m_labelResults.resize(index+1, NULL);
+    }
+    if (!m_labelResults[index])
+    {
+      m_labelResults[index] = new LabelResult();
+    }
+    return *m_labelResults[index];
+  }
+  const LabelResult* findLabelResult(const VirtualInstruction& label) const
+  {
+    int index = label.getRegistrationIndex();
+    return (index < (int) m_labelResults.size()) ? m_labelResults[index] : NULL;
+  }
+  LabelResult* findLabelResult(const VirtualInstruction& label)
+  {
+    int index = label.getRegistrationIndex();
+    return (index < (int) m_labelResults.size()) ? m_labelResults[index] : NULL;
+  }
+  // A label is reached once the insertion has attached a result to it.
+  virtual bool isMarked(const VirtualInstruction& instruction) const
+  {
+    return (instruction.type() == VirtualInstruction::TLabel) && findLabelResult(instruction);
+  }
   virtual void markInstructionWith(VirtualInstruction& instruction, VirtualTask&  vtTask)
   {
     if (instruction.type() == VirtualInstruction::TLabel)
     {
       assert(dynamic_cast<const PhiInsertionTask*>(&vtTask));
       const PhiInsertionTask& task = (const PhiInsertionTask&) vtTask;
-      if (instruction.mark == NULL)
-      {
-        assert(dynamic_cast<const LabelInstruction*>(&instruction));
-        instruction.mark = new PhiInsertionTask::LabelResult();
-      }
-      PhiInsertionTask::LabelResult& result = *((PhiInsertionTask::LabelResult*) instruction.mark);
+      LabelResult& result = labelResult(instruction);
       if (!result.hasMark())
       {
         m_labels.push_back((LabelInstruction*) &instruction);
@@ -260,216 +278,22 @@ public:
 
 class LabelPhiFrontierAgenda : public WorkList
 {
+private:
+  PhiInsertionAgenda& m_results;
+
 public:
-  LabelPhiFrontierAgenda()
+  LabelPhiFrontierAgenda(PhiInsertionAgenda& results) : m_results(results)
   {
 
   }
 
   typedef PhiInsertionTask::IsBefore IsBefore;
   typedef PhiInsertionTask::LabelResult LabelResult;
+  typedef PhiInsertionTask::Origins Origins;
   void propagate(const LabelInstruction& label);
   void propagateOn(const LabelInstruction& label, const std::set<VirtualExpression*, IsBefore>& originModified);
 };
 
-/* Tâche de renommage */
-
-class RenamingAgenda;
-class RenamingTask: public VirtualTask
-{
-public:
-  class VariableRenaming
-  {
-  private:
-    VirtualExpression* m_toReplace;
-    LocalVariableExpression* m_newValue;
-    Function* m_function;
-    VirtualInstruction* m_lastDominator;
-    std::shared_ptr<VariableRenaming> m_parent;
-  public:
-    VariableRenaming(VirtualExpression& locate, const Function& function) : m_toReplace(&locate), m_newValue(NULL), m_function(&const_cast<Function&>(function))
-    {
-
-    }
-    VariableRenaming(VirtualExpression* toReplace, LocalVariableExpression* newValue, const Function& function, VirtualInstruction* lastDominator) : m_toReplace(toReplace), m_newValue(newValue), m_function(&const_cast<Function&>(function)), m_lastDominator(lastDominator)
-    {
-
-    }
-    class Transfert
-    {
-
-    };
-    VariableRenaming(const VariableRenaming& source, Transfert) : m_toReplace(NULL), m_newValue(source.m_newValue), m_function(source.m_function), m_lastDominator(source.m_lastDominator)
-    {
-      const_cast<VariableRenaming&>(source).m_newValue = NULL;
-    }
-    VariableRenaming(const VariableRenaming& source) : m_toReplace(source.m_toReplace), m_newValue(source.m_newValue), m_function(source.m_function), m_lastDominator(source.m_lastDominator), m_parent(source.m_parent)
-    {
-
-    }
-    VariableRenaming& operator=(const VariableRenaming& source)
-    {
-      m_toReplace = source.m_toReplace;
-      m_newValue = source.m_newValue;
-      m_function = source.m_function;
-      m_lastDominator = source.m_lastDominator;
-      m_parent = source.m_parent;
-      return *this;
-    }
-    void cloneExpressions()
-    {
-      m_toReplace = m_toReplace->clone();
-      if (m_newValue)
-      {
-        m_newValue = (LocalVariableExpression*) m_newValue->clone();
-      }
-    }
-    Comparison compare(const VariableRenaming& source) const;
-    bool operator==(const VariableRenaming& source) const
-    {
-      return compare(source) == CEqual;
-    }
-    bool operator<(const VariableRenaming& source) const
-    {
-      return compare(source) == CLess;
-    }
-    bool operator>(const VariableRenaming& source) const
-    {
-      return compare(source) == CGreater;
-    }
-    bool operator<=(const VariableRenaming& source) const
-    {
-      Comparison result = compare(source);
-      return result == CLess || result == CEqual;
-    }
-    bool operator>=(const VariableRenaming& source) const
-    {
-      Comparison result = compare(source);
-      return result == CGreater || result == CEqual;
-    }
-    bool operator!=(const VariableRenaming& source) const
-    {
-      Comparison result = compare(source);
-      return result == CGreater || result == CLess;
-    }
-    void free()
-    {
-      if (m_toReplace)
-      {
-        delete m_toReplace;
-        m_toReplace = NULL;
-      }
-      if (m_newValue)
-      {
-        delete m_newValue;
-        m_newValue = NULL;
-      }
-    }
-    LocalVariableExpression& getNewValue() const
-    {
-      return m_newValue ? *m_newValue : *m_parent->m_newValue;
-    }
-    LocalVariableExpression* getSDominatorNewValue() const
-    {
-      return m_parent.get() ? m_parent->m_newValue : NULL;
-    }
-    void setNewValue(LocalVariableExpression* newValue, VirtualInstruction* lastDominator)
-    {
-      m_newValue = newValue;
-      m_lastDominator = lastDominator;
-    }
-    bool setDominator(VirtualInstruction& dominator, GotoInstruction* previousLabel=NULL);
-    friend class RenamingTask;
-  };
-
-public:
-  std::set<VariableRenaming> m_renamings;
-  bool m_isLValue; // attribut hérité
-  LocalVariableExpression* m_localRename; // attribut synthétisé
-  LocalVariableExpression* m_localReplace; // attribut synthétisé
-  const Function& m_function;
-  GotoInstruction* m_previousLabel;
-  GotoInstruction* m_lastBranch;
-  bool m_isOnlyPhi;
-
-private:
-  static std::set<VariableRenaming>* cloneRenamings(const std::set<VariableRenaming>& source)
-  {
-    std::set<VariableRenaming>* result = new std::set<VariableRenaming>(source);
-    for (std::set<VariableRenaming>::const_iterator iter = result->begin(); iter != result->end(); ++iter)
-    {
-      const_cast<VariableRenaming&>(*iter).cloneExpressions();
-    }
-    return result;
-  }
-  static void freeRenamings(std::set<VariableRenaming>& source)
-  {
-    for (std::set<VariableRenaming>::const_iterator iter = source.begin(); iter != source.end(); ++iter)
-    {
-      const_cast<VariableRenaming&>(*iter).free();
-    }
-    source.clear();
-  }
-
-public:
-  RenamingTask(const Function& function) : m_isLValue(false), m_localRename(NULL), m_localReplace(NULL), m_function(function), m_previousLabel(NULL), m_lastBranch(NULL), m_isOnlyPhi(false)
-  {
-    setInstruction(function.getFirstInstruction());
-  }
-  RenamingTask(const RenamingTask& source) : VirtualTask(source), m_renamings(source.m_renamings), m_isLValue(false), m_localRename(NULL), m_localReplace(NULL), m_function(source.m_function), m_previousLabel(source.m_previousLabel), m_lastBranch(source.m_lastBranch), m_isOnlyPhi(source.m_isOnlyPhi)
-  {
-    for (std::set<VariableRenaming>::const_iterator iter = m_renamings.begin(); iter != m_renamings.end(); ++iter)
-    {
-      const_cast<VariableRenaming&>(*iter).cloneExpressions();
-    }
-  }
-  virtual VirtualTask* clone() const
-  {
-    return new RenamingTask(*this);
-  }
-  virtual int getType() const
-  {
-    return TTRenaming;
-  }
-  virtual bool mergeWith(VirtualTask& source)
-  {
-    ((RenamingTask&) source).m_isOnlyPhi = true;
-    return false;
-  }
-  friend class RenamingAgenda;
-};
-
-class RenamingAgenda : public WorkList
-{
-public:
-  const Function* m_function;
-  std::list<LabelInstruction*> m_markedInstruction;
-  int m_ident;
-
-public:
-  RenamingAgenda(const Function& function) : m_function(&function), m_ident(1)
-  {
-    addNewAsFirst(new RenamingTask(function));
-  }
-  ~RenamingAgenda()
-  {
-    for (std::list<LabelInstruction*>::iterator iter = m_markedInstruction.begin(); iter != m_markedInstruction.end(); ++iter)
-    {
-      (*iter)->mark = NULL;
-    }
-    m_markedInstruction.clear();
-  }
-
-  virtual void markInstructionWith(VirtualInstruction& instruction, VirtualTask& task)
-  {
-    if ((instruction.type() == VirtualInstruction::TLabel) && !instruction.mark)
-    {
-      m_markedInstruction.push_back((LabelInstruction*) &instruction);
-      instruction.mark = (void*) 1;
-    }
-  }
-};
-
 inline void
 PrintTask::applyOn(VirtualInstruction& instruction, WorkList& continuations) {
   assert(dynamic_cast<const PrintAgenda*>(&continuations));
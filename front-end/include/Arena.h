@@ -0,0 +1,95 @@
+#ifndef ArenaH
+#define ArenaH
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Bump allocator owning the instructions and the expressions of a function.
+// Memory is only given back in bulk, when the arena dies.
+class Arena {
+private:
+  enum { BlockSize = 64*1024, Alignment = sizeof(void*) };
+  std::vector<char*> m_blocks;
+  char* m_current;
+  size_t m_remaining;
+  size_t m_allocated;
+  int m_allocations;
+
+  Arena(const Arena& source);
+  Arena& operator=(const Arena& source);
+
+  void addBlock(size_t size)
+  {  size_t blockSize = (size > BlockSize) ? size : (size_t) BlockSize;
+    char* block = (char*) std::malloc(blockSize);
+    if (!block)
+      throw std::bad_alloc();
+    m_blocks.push_back(block);
+    m_current = block;
+    m_remaining = blockSize;
+  }
+
+public:
+  Arena() : m_current(NULL), m_remaining(0), m_allocated(0), m_allocations(0) {}
+  ~Arena() { clear(); }
+
+  void* allocate(size_t size)
+  {  size = (size + Alignment - 1) & ~((size_t) Alignment - 1);
+    if (size > m_remaining)
+      addBlock(size);
+    void* result = m_current;
+    m_current += size;
+    m_remaining -= size;
+    m_allocated += size;
+    ++m_allocations;
+    return result;
+  }
+  void clear()
+  {  for (std::vector<char*>::iterator iter = m_blocks.begin(); iter != m_blocks.end(); ++iter)
+      std::free(*iter);
+    m_blocks.clear();
+    m_current = NULL;
+    m_remaining = 0;
+    m_allocated = 0;
+    m_allocations = 0;
+  }
+  size_t allocated() const { return m_allocated; }
+  // number of nodes allocated
+  int countAllocations() const { return m_allocations; }
+  int countBlocks() const { return m_blocks.size(); }
+};
+
+// Base of the IR nodes. A node built with new (arena) lives in the arena and
+// its delete only runs the destructor; a node built with a plain new (clones
+// made during the renaming for instance) keeps going through the heap.
+class ArenaNode {
+private:
+  union Header {
+    Arena* arena;
+    double alignDouble;
+    long alignLong;
+  };
+
+public:
+  static void* operator new(size_t size)
+  {  Header* header = (Header*) ::operator new(sizeof(Header) + size);
+    header->arena = NULL;
+    return header+1;
+  }
+  static void* operator new(size_t size, Arena& arena)
+  {  Header* header = (Header*) arena.allocate(sizeof(Header) + size);
+    header->arena = &arena;
+    return header+1;
+  }
+  static void operator delete(void* node)
+  {  if (node) {
+      Header* header = ((Header*) node)-1;
+      if (!header->arena)
+        ::operator delete(header);
+    };
+  }
+  static void operator delete(void* node, Arena& arena) {}
+};
+
+#endif // ArenaH
@@ -0,0 +1,93 @@
+#ifndef AtomsH
+#define AtomsH
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*************************/
+/* Définition des atomes */
+/*************************/
+
+// An atom is the index of an interned identifier. Two identifiers with the
+// same spelling give the same atom, which makes their comparison an integer
+// comparison. The pool is shared by all the programs and the threads; only
+// intern takes its lock.
+typedef int Atom;
+
+class Atoms {
+public:
+  enum { AEmpty = 0 }; // atom of the empty identifier
+
+  static Atom intern(const char* text, size_t length);
+  static Atom intern(const char* text);
+  static Atom intern(const std::string& text)
+  {  return intern(text.data(), text.size()); }
+  static const std::string& name(Atom atom);
+  static int count();
+};
+
+// Open addressing hash map keyed by atoms. It is meant for the small tables
+// of the scopes and of the program, a lookup being one multiplication and
+// usually a single probe.
+template <class Value>
+class AtomMap {
+private:
+  enum { FreeKey = -1, MinCapacity = 8 };
+  std::vector<Atom> m_keys;
+  std::vector<Value> m_values;
+  int m_count;
+  int m_shift;
+
+  int start(Atom key) const
+  {  return (int) (((unsigned) key * 2654435769U) >> m_shift); }
+  void grow()
+  {  std::vector<Atom> keys(m_keys.empty() ? (int) MinCapacity : 2*m_keys.size(), (Atom) FreeKey);
+    std::vector<Value> values(keys.size());
+    keys.swap(m_keys);
+    values.swap(m_values);
+    m_shift = 32;
+    for (size_t capacity = m_keys.size(); capacity > 1; capacity /= 2)
+      --m_shift;
+    int mask = m_keys.size()-1;
+    for (size_t index = 0; index < keys.size(); ++index)
+      if (keys[index] != FreeKey) {
+        int probe = start(keys[index]);
+        while (m_keys[probe] != FreeKey)
+          probe = (probe+1) & mask;
+        m_keys[probe] = keys[index];
+        m_values[probe] = values[index];
+      };
+  }
+
+public:
+  AtomMap() : m_count(0), m_shift(32) {}
+
+  const Value* find(Atom key) const
+  {  if (m_count == 0)
+      return NULL;
+    int mask = m_keys.size()-1;
+    for (int probe = start(key); m_keys[probe] != FreeKey; probe = (probe+1) & mask)
+      if (m_keys[probe] == key)
+        return &m_values[probe];
+    return NULL;
+  }
+  bool contain(Atom key) const { return find(key) != NULL; }
+  // Like std::map::insert, an existing key keeps its value.
+  bool insert(Atom key, const Value& value)
+  {  if (2*(m_count+1) > (int) m_keys.size())
+      grow();
+    int mask = m_keys.size()-1;
+    int probe = start(key);
+    for (; m_keys[probe] != FreeKey; probe = (probe+1) & mask)
+      if (m_keys[probe] == key)
+        return false;
+    m_keys[probe] = key;
+    m_values[probe] = value;
+    ++m_count;
+    return true;
+  }
+  int count() const { return m_count; }
+};
+
+#endif // AtomsH
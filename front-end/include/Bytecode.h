@@ -0,0 +1,138 @@
+#ifndef BytecodeH
+#define BytecodeH
+
+#include "CodeGenerator.h"
+#include <list>
+
+/***************************/
+/* Compilation en bytecode */
+/***************************/
+
+// Register bytecode of the functions of a program in SSA form, run by the
+// Interpreter. A procedure works on a frame of 64-bit registers: its
+// parameters, its variables, the temporaries of the expressions and its
+// constants, which the call copies in the frame. As in the assembly, the
+// values are kept sign-extended from the size of their type.
+//
+// An instruction is an operation followed by its operands, given by the
+// format of the operation: a register 'r', an immediate 'i', a jump
+// target 't' as an index in the code, a procedure or native function 'f'
+// and, for the calls, a count 'n' of registers that follow. The pointers
+// are machine addresses: a global is a word of the Bytecode, a string is
+// kept unescaped, and the address of a variable is the one of its
+// register in the frame.
+//
+// The functions with an empty body are the ones of the C library found in
+// a table of natives, called with up to 8 integer arguments.
+class Bytecode {
+public:
+  enum Operation { OMove, OExchange, OAdd, OSubtract, OMultiply, ODivide, ONegate, ONot,
+    OLess, OLessOrEqual, OEqual, ODifferent, OGreaterOrEqual, OGreater,
+    OAddPointer, OSubtractPointer, OPointerDifference, OExtendChar, OExtendInt,
+    OLoadChar, OLoadInt, OLoad, OStoreChar, OStoreInt, OStore, OLoadLocalChar, OLoadLocalInt,
+    OAddress, OJump, OJumpIfTrue, OJumpIfLess, OJumpIfLessOrEqual, OJumpIfEqual,
+    OJumpIfDifferent, OJumpIfGreaterOrEqual, OJumpIfGreater, OCall, OCallNative, OReturn,
+    ONumberOfOperations };
+  typedef long (*Native)(...);
+  static const int MaxNativeArguments = 8;
+
+  class Procedure {
+  public:
+    std::string name;
+    int parameters;
+    int frameSize;
+    // registers receiving a constant at each call
+    std::vector<std::pair<int, long> > constants;
+    std::vector<long> code;
+
+    Procedure() : parameters(0), frameSize(0) {}
+    void print(std::ostream& out) const;
+  };
+
+private:
+  std::vector<Procedure> m_procedures;
+  std::map<const Function*, int> m_procedureIndexes;
+  std::vector<Native> m_natives;
+  std::map<std::string, int> m_nativeIndexes;
+  std::map<Atom, long*> m_globals;
+  std::list<long> m_globalWords;
+  std::list<std::string> m_strings;
+
+public:
+  Bytecode() {}
+
+  static const char* name(Operation operation);
+  static const char* format(Operation operation);
+  // number of words of the instruction starting at code
+  static int size(const long* code);
+
+  // procedure of a function, compiled later
+  int findProcedure(const Function& function);
+  int findNative(const std::string& name);
+  long* findGlobal(Atom name);
+  const char* addString(const std::string& quotedValue);
+  void compile(Function& function);
+
+  int countProcedures() const { return m_procedures.size(); }
+  const Procedure& procedure(int index) const { return m_procedures[index]; }
+  Native native(int index) const { return m_natives[index]; }
+  // -1 if the program has no such function
+  int findProcedure(const std::string& name) const;
+  void print(std::ostream& out) const;
+};
+
+// Compilation of a function, whose SSA variables share a register by
+// class of the RegisterAllocation. The blocks are laid out in the order
+// of the ControlFlowGraph, the phi functions being copied on the edges by
+// a ParallelCopy as in the assembly.
+class BytecodeCompiler {
+private:
+  typedef CodeGenerator::ValueType ValueType;
+
+  Bytecode& m_bytecode;
+  const Function& m_function;
+  const ControlFlowGraph& m_graph;
+  const RegisterAllocation& m_allocation;
+  Bytecode::Procedure& m_procedure;
+  int m_variables;
+  int m_firstTemporary;
+  int m_temporary;
+  int m_maxTemporary;
+  // constants, by value, as -1-index until the frame is known
+  std::map<long, int> m_constants;
+  std::vector<int> m_blockStarts;
+  // code index of the jump targets, with their block
+  std::vector<std::pair<int, int> > m_jumps;
+
+  ValueType typeOf(const VirtualExpression& expression) const
+  {  return CodeGenerator::typeOf(expression, m_function); }
+  int registerOf(const VirtualExpression& variable) const;
+  int constant(long value);
+  int temporary();
+  int destination(int target) { return (target >= 0) ? target : temporary(); }
+  void emit(Bytecode::Operation operation) { m_procedure.code.push_back(operation); }
+  void emit(Bytecode::Operation operation, int fst)
+  {  emit(operation); m_procedure.code.push_back(fst); }
+  void emit(Bytecode::Operation operation, int fst, int snd)
+  {  emit(operation, fst); m_procedure.code.push_back(snd); }
+  void emit(Bytecode::Operation operation, int fst, int snd, int thd)
+  {  emit(operation, fst, snd); m_procedure.code.push_back(thd); }
+  void emitJump(int block) { m_jumps.push_back(std::make_pair(m_procedure.code.size(), block)); m_procedure.code.push_back(0); }
+  int normalize(const ValueType& type, const ValueType& valueType, int value, int target);
+  int compileInto(const VirtualExpression& expression, int target);
+  int compileBinary(const BinaryOperatorExpression& binary, int target);
+  int compileCall(const FunctionCallExpression& call, int target);
+  int compileAssign(const AssignExpression& assign, int target);
+  int compile(const VirtualExpression& expression, int target=-1);
+  void compileBranch(const VirtualExpression& condition, int target);
+  void compileEdge(const VirtualInstruction& last, int target);
+  void compileBlock(int block, int nextBlock);
+
+public:
+  BytecodeCompiler(Bytecode& bytecode, const Function& function, const ControlFlowGraph& graph,
+      const RegisterAllocation& allocation, Bytecode::Procedure& procedure);
+
+  void compile(const std::vector<int>& layout);
+};
+
+#endif // BytecodeH
@@ -0,0 +1,106 @@
+#ifndef CodeGeneratorH
+#define CodeGeneratorH
+
+#include "RegisterAllocation.h"
+#include "ParallelCopy.h"
+#include <map>
+#include <sstream>
+
+/*****************************/
+/* Génération du code x86-64 */
+/*****************************/
+
+// Assembly of the functions of a program in SSA form for x86-64 under the
+// System V calling convention, in the AT&T syntax of the GNU assembler.
+//
+// The SSA variables go to the callee-saved registers by RegisterAllocation,
+// which survive the calls; the other variables and SSA versions and the
+// parameters have their own 8-byte slot in the frame of %rbp. The
+// registers used are saved in the frame by the prologue and restored at
+// each return. An expression is computed in %rax with %rcx for the second
+// operand and the stack for the intermediate values. The values are
+// kept sign-extended on 64 bits, so the int and char operations are done
+// on 32 bits and extended again. The basic blocks are laid out in the
+// order of the ControlFlowGraph; the phi functions of a label are copied
+// on each incoming edge by a ParallelCopy, the coalesced ones being
+// already in place.
+//
+// The functions with an empty body are declarations of external functions
+// (the C library): they are called through the PLT and not generated.
+class CodeGenerator {
+public:
+  // type of a value: an int or a char under some indirections, void has
+  // no base size
+  class ValueType {
+  public:
+    int baseSize;
+    int indirections;
+
+    ValueType() : baseSize(4), indirections(0) {}
+    ValueType(int baseSizeSource, int indirectionsSource)
+    :  baseSize(baseSizeSource), indirections(indirectionsSource) {}
+    ValueType(const VirtualType* type);
+    bool isPointer() const { return indirections > 0; }
+    int getSize() const { return (indirections > 0) ? 8 : baseSize; }
+    int getPointedSize() const
+    {  assert(indirections > 0);
+      return (indirections > 1) ? 8 : (baseSize > 0 ? baseSize : 1);
+    }
+    ValueType pointed() const { return ValueType(baseSize, indirections-1); }
+    ValueType address() const { return ValueType(baseSize, indirections+1); }
+  };
+
+private:
+  std::ostream& m_out;
+  std::vector<std::string> m_strings;
+  // globals read or written by the generated functions, with their size
+  std::map<Atom, int> m_globals;
+
+  const Function* m_function;
+  const ControlFlowGraph* m_graph;
+  std::ostringstream m_code;
+  std::map<std::pair<const SymbolTable*, int>, int> m_slots;
+  int m_registers;
+  const RegisterAllocation* m_allocation;
+  // words pushed on the frame, to align the calls on 16 bytes
+  int m_depth;
+  int m_phiMoves;
+
+  std::string blockLabel(int block) const;
+  std::string slot(const VirtualExpression& variable);
+  ValueType typeOf(const VirtualExpression& expression) const { return typeOf(expression, *m_function); }
+  void push();
+  void pop(const char* reg);
+  // words of the frame below the parameters, for the saved registers
+  int countSavedRegisters() const;
+  void load(const ValueType& type, const std::string& operand, const char* reg="%rax");
+  void store(const ValueType& type, const std::string& operand);
+  void normalize(const ValueType& type, const ValueType& valueType);
+  ValueType generateOperands(const VirtualExpression& fst, const VirtualExpression& snd,
+      ValueType& sndType);
+  void generateAddress(const VirtualExpression& lvalue);
+  ValueType generateAssign(const AssignExpression& assign);
+  ValueType generateCall(const FunctionCallExpression& call);
+  ValueType generateBinary(const BinaryOperatorExpression& binary);
+  ValueType generate(const VirtualExpression& expression);
+  void generateBranch(const VirtualExpression& condition, int target);
+  void generateEdge(const VirtualInstruction& last, int target);
+  void generateReturn();
+  void generateBlock(int block, int nextBlock);
+
+public:
+  // at most countRegisters() registers receive SSA variables
+  CodeGenerator(std::ostream& out, int registers)
+  :  m_out(out), m_function(NULL), m_graph(NULL), m_registers(registers), m_allocation(NULL), m_depth(0),
+    m_phiMoves(0) {}
+
+  static int countRegisters();
+  static ValueType typeOf(const VirtualExpression& expression, const Function& function);
+
+  static bool isExternal(const Function& function);
+  void generate(Function& function);
+  // the strings and the globals, after the functions
+  void generateData();
+};
+
+#endif // CodeGeneratorH
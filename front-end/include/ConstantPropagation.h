@@ -0,0 +1,86 @@
+#ifndef ConstantPropagationH
+#define ConstantPropagationH
+
+#include "DefUse.h"
+
+/*********************************************/
+/* Propagation conditionnelle des constantes */
+/*********************************************/
+
+// Sparse conditional constant propagation of Wegman and Zadeck on a
+// function in SSA form. Each SSA variable of type int starts undefined and
+// can only go down to a constant then to unknown. The blocks are evaluated
+// once one of their incoming edges becomes executable, and an if only makes
+// the edges of the branches its condition allows executable. Two work lists
+// drive the propagation: the edges newly executable and the variables whose
+// value went down, which re-evaluate their uses.
+//
+// apply then replaces the constant expressions by their value, turns the
+// constant phi functions and the ones with a single executable origin into
+// copies, moved after the phi functions left to their label, and cuts the
+// branches that are never executable: the if keeps its constant condition
+// and the labels forget their dead predecessors. The unreachable
+// instructions stay registered in the function but are no more linked.
+class ConstantPropagation {
+public:
+  class Value {
+  public:
+    enum State { SUndefined, SConstant, SUnknown };
+
+  private:
+    State m_state;
+    int m_constant;
+
+  public:
+    Value() : m_state(SUndefined), m_constant(0) {}
+    Value(int constant) : m_state(SConstant), m_constant(constant) {}
+    static Value unknown() { Value result; result.m_state = SUnknown; return result; }
+
+    State state() const { return m_state; }
+    bool isConstant() const { return m_state == SConstant; }
+    int constant() const { assert(m_state == SConstant); return m_constant; }
+    bool operator==(const Value& source) const
+    {  return m_state == source.m_state && (m_state != SConstant || m_constant == source.m_constant); }
+    bool operator!=(const Value& source) const { return !operator==(source); }
+    Value& meet(const Value& source)
+    {  if (m_state == SUndefined)
+        *this = source;
+      else if (source.m_state == SUnknown || (source.m_state == SConstant && (m_state != SConstant || m_constant != source.m_constant)))
+        m_state = SUnknown;
+      return *this;
+    }
+  };
+
+private:
+  Function& m_function;
+  const ControlFlowGraph& m_graph;
+  DefUseChains m_chains;
+  std::vector<Value> m_values;
+  std::vector<bool> m_isExecutable;
+  // executable edges, indexed as the successors of the ControlFlowGraph
+  std::vector<bool> m_isExecutableEdge;
+  std::vector<int> m_blocksToVisit;
+  std::vector<int> m_variablesToPropagate;
+  int m_foldedExpressions;
+  int m_prunedBranches;
+
+  bool isExecutableEdge(int from, int to) const;
+  void setExecutableEdge(int from, int index);
+  void define(const VirtualExpression& variable, const Value& value);
+  Value evaluate(const VirtualExpression& expression);
+  Value evaluatePhi(const PhiExpression& phi, int block);
+  void visit(VirtualInstruction& instruction, int block);
+  void visitBlock(int block);
+  VirtualExpression* fold(VirtualExpression& expression);
+  void foldOperands(VirtualExpression& expression);
+
+public:
+  ConstantPropagation(Function& function);
+
+  void propagate();
+  void apply();
+  int countFoldedExpressions() const { return m_foldedExpressions; }
+  int countPrunedBranches() const { return m_prunedBranches; }
+};
+
+#endif // ConstantPropagationH
@@ -0,0 +1,102 @@
+#ifndef ControlFlowH
+#define ControlFlowH
+
+#include "SyntaxTree.h"
+
+/********************************/
+/* Définition des blocs de base */
+/********************************/
+
+// Basic blocks of a function. A block starts at the first instruction, at a
+// label and at the gotos following an if; it ends before the next start.
+// The blocks are numbered in the registration order of their first
+// instruction, so the block 0 is the entry. The edges are kept in contiguous
+// arrays: the successors of the block b are at m_successors[2*b] and
+// m_successors[2*b+1] (-1 when absent, the else goto before the then goto),
+// its predecessors at m_predecessors[m_predecessorStarts[b]] up to
+// m_predecessorStarts[b+1] excluded, the goto of a label before its
+// previous instruction.
+//
+// computeDominators gives the block-level dominator tree, computed with the
+// iterative algorithm of Cooper, Harvey and Kennedy over the reverse
+// postorder, and computeDominationFrontiers the frontiers of the blocks.
+// applyDominators and applyDominationFrontiers write them back in the
+// instructions the same way DominationAgenda and
+// Function::setDominationFrontier do.
+class ControlFlowGraph {
+private:
+  std::vector<int> m_blockOf;
+  std::vector<VirtualInstruction*> m_firsts;
+  std::vector<VirtualInstruction*> m_lasts;
+  std::vector<int> m_successors;
+  std::vector<int> m_predecessorStarts;
+  std::vector<int> m_predecessors;
+  std::vector<int> m_order;
+  std::vector<int> m_orderIndexes;
+
+  std::vector<int> m_dominators;
+  std::vector<int> m_childStarts;
+  std::vector<int> m_children;
+  std::vector<int> m_preorderIndexes;
+  std::vector<int> m_postorderIndexes;
+  std::vector<int> m_frontierStarts;
+  std::vector<int> m_frontiers;
+  std::vector<GotoInstruction*> m_frontierEdges;
+
+  static bool isLeader(const VirtualInstruction& instruction);
+  void addBlock(VirtualInstruction& first);
+  void addPredecessor(const VirtualInstruction* last)
+  {  if (last)
+      m_predecessors.push_back(m_blockOf[last->getRegistrationIndex()]);
+  }
+  int intersect(int fstBlock, int sndBlock) const;
+  void numberDominatorTree();
+
+public:
+  ControlFlowGraph(const Function& function);
+
+  int countBlocks() const { return m_firsts.size(); }
+  int countInstructions() const { return m_blockOf.size(); }
+  int entry() const { return 0; }
+  int blockOf(const VirtualInstruction& instruction) const
+  {  return m_blockOf[instruction.getRegistrationIndex()]; }
+  VirtualInstruction& first(int block) const { return *m_firsts[block]; }
+  VirtualInstruction& last(int block) const { return *m_lasts[block]; }
+
+  int countSuccessors(int block) const
+  {  return (m_successors[2*block] >= 0 ? 1 : 0) + (m_successors[2*block+1] >= 0 ? 1 : 0); }
+  int successor(int block, int index) const
+  {  return (m_successors[2*block] >= 0) ? m_successors[2*block+index] : m_successors[2*block+1]; }
+  int countPredecessors(int block) const
+  {  return m_predecessorStarts[block+1] - m_predecessorStarts[block]; }
+  int predecessor(int block, int index) const
+  {  return m_predecessors[m_predecessorStarts[block]+index]; }
+  // blocks reachable from the entry, each one before its successors
+  // except along the back edges
+  const std::vector<int>& reversePostorder() const { return m_order; }
+  bool isReachable(int block) const { return m_orderIndexes[block] >= 0; }
+
+  void computeDominators();
+  bool hasDominators() const { return !m_dominators.empty(); }
+  // the entry is its own dominator, an unreachable block has none (-1)
+  int immediateDominator(int block) const { return m_dominators[block]; }
+  int countChildren(int block) const
+  {  return m_childStarts[block+1] - m_childStarts[block]; }
+  int child(int block, int index) const
+  {  return m_children[m_childStarts[block]+index]; }
+  bool dominates(int fstBlock, int sndBlock) const
+  {  return m_preorderIndexes[fstBlock] >= 0 && m_preorderIndexes[sndBlock] >= 0
+      && m_preorderIndexes[fstBlock] <= m_preorderIndexes[sndBlock]
+      && m_postorderIndexes[sndBlock] <= m_postorderIndexes[fstBlock];
+  }
+  void applyDominators() const;
+
+  void computeDominationFrontiers();
+  int countFrontiers(int block) const
+  {  return m_frontierStarts[block+1] - m_frontierStarts[block]; }
+  int frontier(int block, int index) const
+  {  return m_frontiers[m_frontierStarts[block]+index]; }
+  void applyDominationFrontiers() const;
+};
+
+#endif // ControlFlowH
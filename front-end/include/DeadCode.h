@@ -0,0 +1,43 @@
+#ifndef DeadCodeH
+#define DeadCodeH
+
+#include "DefUse.h"
+
+/****************************/
+/* Élimination du code mort */
+/****************************/
+
+// Aggressive dead code elimination on a function in SSA form. Every
+// instruction is supposed dead until it is proven live: the critical ones
+// (the control flow, the returns, the calls, the assignments to a variable
+// out of the SSA form or through a pointer) are live, and an instruction
+// read by a live one through the use-def chains becomes live in turn. The
+// assignments and the phi functions never marked are removed, including
+// the cycles of phi functions feeding each other in a loop.
+//
+// The branches are all kept: removing them needs the control dependences,
+// hence the postdominators, which the function does not have.
+class DeadCodeElimination {
+private:
+  Function& m_function;
+  const ControlFlowGraph& m_graph;
+  DefUseChains m_chains;
+  std::vector<bool> m_isLive;
+  std::vector<VirtualInstruction*> m_liveToPropagate;
+  int m_removedAssignments;
+  int m_removedPhis;
+
+  bool hasSideEffect(const VirtualExpression& expression) const;
+  bool isCritical(const VirtualInstruction& instruction) const;
+  void setLive(VirtualInstruction& instruction);
+
+public:
+  DeadCodeElimination(Function& function);
+
+  void mark();
+  void sweep();
+  int countRemovedAssignments() const { return m_removedAssignments; }
+  int countRemovedPhis() const { return m_removedPhis; }
+};
+
+#endif // DeadCodeH
@@ -0,0 +1,84 @@
+#ifndef DefUseH
+#define DefUseH
+
+#include "ControlFlow.h"
+#include <map>
+#include <set>
+
+/*************************************************/
+/* Définition des chaînes définition-utilisation */
+/*************************************************/
+
+// Definitions and uses of the local variables of a function in SSA form,
+// gathered on the blocks reachable from the entry. The variables of a
+// symbol table are numbered from the start given to the table, so a
+// LocalVariableExpression finds its number with a single lookup of its
+// table. The parameters and the globals are not numbered.
+//
+// A variable is in SSA form when it has a unique definition and its address
+// is never taken; the other ones (declared but not renamed, or read through
+// a pointer) must be considered as unknown by the passes, as the parameters
+// assigned or whose address is taken. The uses of a
+// variable are the instructions reading it, a phi function reading its
+// operands; an instruction reading a variable twice appears twice.
+//
+// The use-def chains go the other way: the variables read by an instruction,
+// indexed by its registration index, lead to their definition through
+// getDefinition.
+class DefUseChains {
+private:
+  // first number and count of the variables of each table, the count being
+  // the one of the table when it is met
+  std::map<const SymbolTable*, std::pair<int, int> > m_tables;
+  int m_count;
+  std::vector<VirtualInstruction*> m_definitions;
+  std::vector<int> m_definitionCounts;
+  std::vector<bool> m_isAddressTaken;
+  std::set<int> m_assignedParameters;
+  std::vector<int> m_useStarts;
+  std::vector<VirtualInstruction*> m_uses;
+  std::vector<int> m_readStarts;
+  std::vector<int> m_reads;
+
+  int addVariable(const VirtualExpression& variable);
+  void collect(const VirtualExpression& expression, VirtualInstruction& instruction,
+      std::vector<std::pair<int, VirtualInstruction*> >& uses);
+
+public:
+  DefUseChains(const ControlFlowGraph& graph);
+
+  int countVariables() const { return m_count; }
+  // number of a local variable, -1 for the other expressions and for the
+  // variables declared after the chains were built
+  int findVariable(const VirtualExpression& variable) const;
+  int findVariable(const SymbolTable& table, int localIndex) const;
+  bool isSSA(int variable) const
+  {  return m_definitionCounts[variable] == 1 && !m_isAddressTaken[variable]; }
+  bool isAddressTaken(int variable) const { return m_isAddressTaken[variable]; }
+  // instruction assigning the variable, NULL if it is not in SSA form
+  VirtualInstruction* getDefinition(int variable) const
+  {  return isSSA(variable) ? m_definitions[variable] : NULL; }
+  bool isAssignedParameter(int index) const
+  {  return m_assignedParameters.find(index) != m_assignedParameters.end(); }
+  int countUses(int variable) const
+  {  return m_useStarts[variable+1] - m_useStarts[variable]; }
+  VirtualInstruction& use(int variable, int index) const
+  {  return *m_uses[m_useStarts[variable]+index]; }
+  int countReads(const VirtualInstruction& instruction) const
+  {  int index = instruction.getRegistrationIndex();
+    return m_readStarts[index+1] - m_readStarts[index];
+  }
+  // number of a variable read by instruction
+  int read(const VirtualInstruction& instruction, int index) const
+  {  return m_reads[m_readStarts[instruction.getRegistrationIndex()]+index]; }
+
+  static bool isVariable(const VirtualExpression& expression)
+  {  return expression.type() == VirtualExpression::TLocalVariable
+      || expression.type() == VirtualExpression::TParameter
+      || expression.type() == VirtualExpression::TGlobalVariable;
+  }
+  // the variable has the type int, function being required for a parameter
+  static bool isInteger(const VirtualExpression& variable, Function* function=NULL);
+};
+
+#endif // DefUseH
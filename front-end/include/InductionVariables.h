@@ -0,0 +1,91 @@
+#ifndef InductionVariablesH
+#define InductionVariablesH
+
+#include "DefUse.h"
+#include "Loops.h"
+
+/*************************************/
+/* Analyse des variables d'induction */
+/*************************************/
+
+// Induction variables of the NaturalLoops of a function in SSA form. A
+// basic induction variable is an int phi function of a loop header with
+// one operand entering the loop and one coming from its single latch, the
+// latter being the phi variable plus a constant step through a chain of
+// additions and subtractions of constants in the loop.
+//
+// The multiplications by a constant of a basic induction variable, or of
+// its latch operand, are reduced to an addition: a new phi function starts
+// from the product of the entry value, computed in the preheader, and is
+// increased by the product of the step next to the increment of the
+// induction variable.
+//
+// When the only exit of a loop is a test, executed once per iteration, of
+// an induction variable starting from a constant against a constant, the
+// number of executions of the loop header is set on its label for the
+// later unrolling.
+class InductionVariables {
+public:
+  class Induction {
+  public:
+    int loop;
+    int variable;
+    ExpressionInstruction* phi;
+    int entryIndex;
+    int latchIndex;
+    // variable of the latch operand and its definition, the last increment
+    int nextVariable;
+    VirtualInstruction* increment;
+    int step;
+
+    Induction(int loopSource, int variableSource, ExpressionInstruction& phiSource)
+    :  loop(loopSource), variable(variableSource), phi(&phiSource), entryIndex(-1),
+      latchIndex(-1), nextVariable(-1), increment(NULL), step(0) {}
+    const PhiExpression& getPhi() const
+    {  assert(dynamic_cast<const AssignExpression*>(&phi->getExpression()));
+      assert(dynamic_cast<const PhiExpression*>(&((const AssignExpression&) phi->getExpression()).getRValue()));
+      return (const PhiExpression&) ((const AssignExpression&) phi->getExpression()).getRValue();
+    }
+    const LocalVariableExpression& getVariable() const
+    {  assert(dynamic_cast<const LocalVariableExpression*>(&((const AssignExpression&) phi->getExpression()).getLValue()));
+      return (const LocalVariableExpression&) ((const AssignExpression&) phi->getExpression()).getLValue();
+    }
+  };
+
+private:
+  Function& m_function;
+  ControlFlowGraph m_graph;
+  DefUseChains m_chains;
+  NaturalLoops m_loops;
+  std::vector<bool> m_isInLoop;
+  std::vector<Induction> m_inductions;
+  int m_reducedMultiplications;
+  int m_tripCounts;
+
+  void markLoop(const NaturalLoops::Loop& loop, bool isInLoop);
+  bool findConstant(const VirtualExpression& expression, int& value) const;
+  bool findStep(int variable, int phiVariable, int& step) const;
+  void findInductions(int loopIndex);
+  const Induction* findInduction(int loopIndex, const VirtualExpression& expression, int& offset) const;
+  int findExitingBlock(int loopIndex) const;
+  void computeTripCount(int loopIndex);
+  // variables of the products by a factor of an induction variable and of
+  // its latch operand
+  typedef std::pair<LocalVariableExpression*, LocalVariableExpression*> Reduction;
+  LocalVariableExpression* newVariable(const Induction& induction);
+  const Reduction& findReduction(const Induction& induction, int factor, std::map<int, Reduction>& reductions);
+  VirtualExpression* reduceProducts(VirtualExpression& expression, const Induction& induction,
+      std::map<int, Reduction>& reductions);
+  void reduce(const Induction& induction);
+
+public:
+  InductionVariables(Function& function);
+
+  void analyze();
+  void reduceStrength();
+  int countInductions() const { return m_inductions.size(); }
+  int countReducedMultiplications() const { return m_reducedMultiplications; }
+  int countTripCounts() const { return m_tripCounts; }
+};
+
+#endif // InductionVariablesH
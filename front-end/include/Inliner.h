@@ -0,0 +1,89 @@
+#ifndef InlinerH
+#define InlinerH
+
+#include "ControlFlow.h"
+#include <map>
+#include <set>
+
+/*********************************/
+/* Expansion en ligne des appels */
+/*********************************/
+
+// Expansion of the calls of a function before its SSA construction. The
+// body of the callee is copied before the instruction of the call, whose
+// value becomes a variable assigned in place of the return. The parameters
+// and the variables of the callee are declared at the end of the scope of
+// the call, under the name of the callee and a number of copy, and its
+// inner blocks are declared again in this scope.
+//
+// The size of a function is the number of nodes of its expressions. A call
+// is expanded when the growth of the caller, the size of the callee less
+// the call it replaces, is at most the threshold scaled by the frequency
+// of the call: 1 plus its loop depth, up to 4. A constant argument lowers
+// the growth, its uses being folded later by the constant propagation.
+// The calls the most nested in the loops are expanded first, as long as
+// the caller stays under twice its size plus the threshold.
+//
+// The order of the calls is kept: a call is only expanded when all the
+// calls evaluated before it, except the ones of its arguments, have been.
+// The callee must have a single exit, the language putting its return at
+// its end.
+class Inliner {
+public:
+  static const int DefaultThreshold = 16;
+
+private:
+  class Site {
+  public:
+    VirtualInstruction* instruction;
+    int depth;
+    // scope of the instruction, receiving the variables of the copies
+    Scope scope;
+
+    Site(VirtualInstruction& instructionSource, int depthSource, const Scope& scopeSource)
+    :  instruction(&instructionSource), depth(depthSource), scope(scopeSource) {}
+    static bool isDeeper(const Site& fst, const Site& snd) { return fst.depth > snd.depth; }
+  };
+  // scope of the caller receiving a table of the callee, with the index of
+  // its first variable
+  typedef std::map<const SymbolTable*, std::pair<Scope, int> > TableCopies;
+
+  Function& m_function;
+  int m_threshold;
+  int m_size;
+  int m_maxSize;
+  int m_copies;
+  int m_inlinedCalls;
+  // copy in progress: its callee, NULL for the arguments of the call, the
+  // scope of the call and the index of the first parameter there
+  const Function* m_callee;
+  Scope* m_scope;
+  int m_parameters;
+  TableCopies m_tables;
+
+  static int countNodes(const VirtualExpression& expression);
+  static void findScopes(const Function& function, std::vector<Scope>& scopes,
+      std::vector<bool>& isReachable);
+  bool isInlinable(const FunctionCallExpression& call, bool isValueUsed, int depth,
+      const std::set<const Function*>& keptCallees) const;
+  int growth(const FunctionCallExpression& call) const;
+  int declare(Scope& scope, const std::string& name, VirtualType* type);
+  LocalVariableExpression* variable(const Scope& scope, int localIndex);
+  Scope copyTable(const Scope& calleeScope);
+  VirtualExpression* copy(const VirtualExpression& expression);
+  VirtualInstruction* copy(const VirtualInstruction& instruction, const Scope& calleeScope,
+      int result, std::vector<VirtualInstruction*>& copies);
+  bool expand(Site& site, FunctionCallExpression& call);
+
+public:
+  Inliner(Function& function, int threshold);
+
+  // the calls to the functions of keptCallees are not expanded
+  void apply(const std::set<const Function*>& keptCallees);
+  int countInlinedCalls() const { return m_inlinedCalls; }
+
+  static int size(const Function& function);
+  static void findCallees(const Function& function, std::vector<Function*>& callees);
+};
+
+#endif // InlinerH
@@ -0,0 +1,51 @@
+#ifndef InterpreterH
+#define InterpreterH
+
+#include "Bytecode.h"
+
+/******************************/
+/* Interprétation du bytecode */
+/******************************/
+
+// Execution of the Bytecode of a program. With GCC, the dispatch is direct
+// threaded: the operation of each instruction is replaced by the address
+// of the label executing it, and every instruction ends by jumping to the
+// label of the next one (computed goto). The other compilers, or the
+// definition of FEATHER_SWITCH_DISPATCH, fall back to a switch in a loop.
+//
+// The frames of the procedures follow each other on a stack of registers
+// allocated once, so the addresses of the variables stay valid during the
+// calls; a call recurses on execute, so the calls also stop short of the
+// end of the native stack of the thread that built the Interpreter, half of
+// the room left below it being kept for execute. A call beyond these limits
+// stops the execution and Interpreter::call returns false.
+#if defined(__GNUC__) && !defined(FEATHER_SWITCH_DISPATCH)
+#define FEATHER_THREADED_DISPATCH
+#endif
+
+class Interpreter {
+private:
+  const Bytecode& m_bytecode;
+  std::vector<long> m_stack;
+  // code of the procedures, threaded if possible
+  std::vector<std::vector<long> > m_codes;
+  // procedure whose frame did not fit on the stack, -1 without overflow
+  int m_overflow;
+  // address of the native stack below which a call overflows, as an integer
+  // since it is compared with the addresses of other frames
+  size_t m_nativeLimit;
+  // room given to the calls when the stack of the thread is unknown
+  enum { NativeFallbackSize = 1 << 20 };
+
+  // with a negative procedure, returns the addresses of the labels
+  long execute(int procedure, long* frame);
+
+public:
+  Interpreter(const Bytecode& bytecode, int stackSize=1 << 22);
+
+  // false on a stack overflow, result being then undefined
+  bool call(int procedure, const std::vector<long>& arguments, long& result);
+  int getOverflowProcedure() const { return m_overflow; }
+};
+
+#endif // InterpreterH
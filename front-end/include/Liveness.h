@@ -0,0 +1,56 @@
+#ifndef LivenessH
+#define LivenessH
+
+#include "ControlFlow.h"
+
+/***********************************************/
+/* Définition de la durée de vie des variables */
+/***********************************************/
+
+// Variables live at the entry of the basic blocks, computed on the
+// ControlFlowGraph before the insertion of the phi functions. A variable is
+// identified as in PhiInsertionTask::IsBefore, by its kind and its index, and
+// numbered densely to hold the sets in bit vectors.
+//
+// With isPruned, the classical backward fixpoint gives the live-in set of
+// each block and a label needs a phi function for the variables live at its
+// entry. Without it, only the global names are computed: the variables used
+// in a block before any assignment in this block (semi-pruned form). The
+// globals and the variables whose address is taken can be read by a call or
+// through a pointer, so they are always considered live.
+class Liveness {
+private:
+  enum Kind { KLocal, KParameter, KGlobal, KEnd };
+  std::vector<int> m_variables[KEnd];
+  int m_count;
+  int m_words;
+  bool m_isPruned;
+  // block of each instruction, copied since the insertion of the phi
+  // functions drops the ControlFlowGraph
+  std::vector<int> m_blockOf;
+  std::vector<unsigned> m_liveIns;
+  std::vector<unsigned> m_globalNames;
+  std::vector<unsigned> m_alwaysLive;
+
+  static Kind kind(const VirtualExpression& variable, int& index);
+  int findVariable(const VirtualExpression& variable) const;
+  int addVariable(const VirtualExpression& variable);
+  void collect(const VirtualExpression& expression, std::vector<int>& events);
+  static bool contain(const unsigned* set, int variable)
+  {  return (set[variable/32] >> (variable%32)) & 1U; }
+  static void add(unsigned* set, int variable)
+  {  set[variable/32] |= 1U << (variable%32); }
+
+public:
+  Liveness(const ControlFlowGraph& graph, bool isPruned);
+
+  int countVariables() const { return m_count; }
+  bool isPruned() const { return m_isPruned; }
+  bool isGlobalName(const VirtualExpression& variable) const;
+  // the leader is the first instruction of its block
+  bool isLiveAt(const VirtualInstruction& leader, const VirtualExpression& variable) const;
+  bool needsPhi(const LabelInstruction& label, const VirtualExpression& variable) const
+  {  return m_isPruned ? isLiveAt(label, variable) : isGlobalName(variable); }
+};
+
+#endif // LivenessH
@@ -0,0 +1,50 @@
+#ifndef LoopInvariantsH
+#define LoopInvariantsH
+
+#include "DefUse.h"
+#include "Loops.h"
+
+/****************************************/
+/* Déplacement des invariants de boucle */
+/****************************************/
+
+// Loop-invariant code motion on a function in SSA form, over its
+// NaturalLoops. An assignment of a SSA variable computing an arithmetic, a
+// comparison or a cast whose operands are constants, parameters never
+// assigned or SSA variables defined out of the loop is moved to the
+// preheader. The blocks of a loop are visited in reverse postorder, so the
+// invariants depending on invariants follow them, and the outer loops are
+// handled first so an invariant of several nested loops directly reaches
+// the outermost preheader. The divisions are only moved by a constant other than 0 and -1
+// since the body of a while loop may never be executed.
+//
+// The pass keeps its own ControlFlowGraph, the one of the function being
+// dropped by the first move.
+class LoopInvariantMotion {
+private:
+  Function& m_function;
+  ControlFlowGraph m_graph;
+  DefUseChains m_chains;
+  NaturalLoops m_naturalLoops;
+  std::vector<int> m_orderIndexes;
+  std::vector<bool> m_isInLoop;
+  // last instruction of the blocks, following the moves
+  std::vector<VirtualInstruction*> m_lasts;
+  // instructions already moved out of a loop, by registration index
+  std::vector<bool> m_isHoisted;
+  int m_hoistedInstructions;
+  int m_loops;
+
+  bool isInvariant(const VirtualExpression& expression) const;
+  bool isHoistable(const VirtualInstruction& instruction) const;
+  void hoist(const NaturalLoops::Loop& loop);
+
+public:
+  LoopInvariantMotion(Function& function);
+
+  void apply();
+  int countHoistedInstructions() const { return m_hoistedInstructions; }
+  int countLoops() const { return m_loops; }
+};
+
+#endif // LoopInvariantsH
@@ -0,0 +1,54 @@
+#ifndef LoopsH
+#define LoopsH
+
+#include "ControlFlow.h"
+
+/*************************************/
+/* Définition des boucles naturelles */
+/*************************************/
+
+// Natural loops of a function, found from the back edges that the parser
+// marks as goto loop: the loop header is the label targeted by the goto,
+// provided it dominates the goto, the latches are the blocks ending with
+// such a goto, and the body the blocks reaching a latch without going
+// through the header. The loops of a same header are merged. A loop is
+// only kept when the instruction falling into its header is out of the
+// loop, since the passes put there the code entering the loop.
+//
+// The loops are sorted from the largest, so an outer loop comes before the
+// loops nested in it.
+class NaturalLoops {
+public:
+  class Loop {
+  public:
+    int header;
+    std::vector<int> latches;
+    std::vector<int> blocks;
+
+    Loop(int headerSource) : header(headerSource) {}
+  };
+
+private:
+  const ControlFlowGraph& m_graph;
+  std::vector<Loop> m_loops;
+
+  static bool isLarger(const Loop& fst, const Loop& snd)
+  {  return fst.blocks.size() > snd.blocks.size(); }
+
+public:
+  // computes the dominators of graph if needed
+  NaturalLoops(ControlFlowGraph& graph);
+
+  int count() const { return m_loops.size(); }
+  const Loop& loop(int index) const { return m_loops[index]; }
+  LabelInstruction& header(const Loop& loop) const
+  {  assert(dynamic_cast<const LabelInstruction*>(&m_graph.first(loop.header)));
+    return (LabelInstruction&) m_graph.first(loop.header);
+  }
+  // instruction after which the code entering the loop goes: the one
+  // falling into the header, or the one before when it is the goto
+  // entering the loop. It follows the moves and insertions of instructions.
+  VirtualInstruction& preheader(const Loop& loop) const;
+};
+
+#endif // LoopsH
@@ -0,0 +1,28 @@
+#ifndef ParallelH
+#define ParallelH
+
+/*************************************/
+/* Définition des boucles parallèles */
+/*************************************/
+
+// Loop whose iterations are independent. run distributes them on a group of
+// threads, an idle thread taking the next iteration not yet started, and
+// returns once every iteration is done.
+class ParallelLoop {
+private:
+  int m_count;
+  volatile int m_next;
+
+  static void* work(void* loop);
+
+public:
+  ParallelLoop() : m_count(0), m_next(0) {}
+  virtual ~ParallelLoop() {}
+
+  virtual void execute(int index) = 0;
+  void run(int count, int threads);
+
+  static int countProcessors();
+};
+
+#endif // ParallelH
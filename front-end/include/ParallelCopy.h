@@ -0,0 +1,57 @@
+#ifndef ParallelCopyH
+#define ParallelCopyH
+
+#include <string>
+#include <vector>
+
+/*******************************************/
+/* Séquentialisation des copies parallèles */
+/*******************************************/
+
+// Copies done all at once, like the phi functions of a label on one of its
+// incoming edges, turned into a sequence of moves. A location, register or
+// memory, is named by its operand in the assembly, the registers starting
+// with '%'. A copy whose source is not a location (a constant) reads
+// nothing that the other copies write, so it comes last.
+//
+// A copy is emitted once its destination is no more read by the pending
+// copies; the copies remaining then form cycles. A cycle is broken by an
+// exchange when the copy goes between two registers, otherwise by saving
+// its destination to a temporary location that its readers use instead.
+// The copies whose source is their destination disappear.
+class ParallelCopy {
+public:
+  class Move {
+  public:
+    std::string destination;
+    // empty when the source is not a location
+    std::string source;
+    // copy given by add, whose destination gives the type of the move
+    int copy;
+    bool isExchange;
+
+    Move(const std::string& destinationSource, const std::string& sourceSource, int copySource)
+    :  destination(destinationSource), source(sourceSource), copy(copySource), isExchange(false) {}
+  };
+
+private:
+  std::vector<Move> m_copies;
+  int m_removedCopies;
+
+  static bool isRegister(const std::string& location) { return !location.empty() && location[0] == '%'; }
+  int countReads(const std::vector<Move>& pending, const std::string& location) const;
+
+public:
+  ParallelCopy() : m_removedCopies(0) {}
+
+  // copies are numbered from 0 in the order of the calls
+  void add(const std::string& destination, const std::string& source)
+  {  m_copies.push_back(Move(destination, source, m_copies.size())); }
+  bool isEmpty() const { return m_copies.empty(); }
+  // temporary is a location distinct from the copied ones
+  void sequentialize(const std::string& temporary, std::vector<Move>& moves);
+  // copies whose source was their destination, after sequentialize
+  int countRemovedCopies() const { return m_removedCopies; }
+};
+
+#endif // ParallelCopyH
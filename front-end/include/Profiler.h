@@ -0,0 +1,94 @@
+#ifndef ProfilerH
+#define ProfilerH
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+class Function;
+
+/***************************************/
+/* Profil des phases de la compilation */
+/***************************************/
+
+// Measures of the phases of the compilation, like -ftime-report. A Measure
+// covers a phase on a function, or on the whole program without function,
+// from its construction to its destruction: wall and CPU time of the
+// thread, peak resident size of the process at the end, instructions of
+// the function at the end, allocations and bytes of its arena and worklist
+// tasks run on it during the phase. The arena columns are not a count of the
+// live IR: the nodes cloned on the heap (phi operands, inlined copies) and
+// the ones released are not seen, and a phase of the program has no arena.
+// The functions being built on several threads with -j, the records are
+// added under a lock.
+class PhaseProfiler {
+public:
+  enum Format { FTable, FJson };
+
+  class Record {
+  public:
+    const char* phase;
+    // empty for a phase of the program
+    std::string function;
+    double wallTime;
+    double cpuTime;
+    long peakResidentSize;
+    int instructions;
+    int arenaAllocations;
+    long arenaBytes;
+    int tasks;
+
+    Record()
+    :  phase(""), wallTime(0), cpuTime(0), peakResidentSize(0), instructions(0),
+      arenaAllocations(0), arenaBytes(0), tasks(0) {}
+  };
+
+  class Measure {
+  private:
+    PhaseProfiler* m_profiler;
+    const Function* m_function;
+    Record m_start;
+
+    Measure(const Measure& source);
+    Measure& operator=(const Measure& source);
+
+  public:
+    // without profiler, nothing is measured
+    Measure(PhaseProfiler* profiler, const char* phase, const Function* function=NULL);
+    ~Measure();
+  };
+
+private:
+  std::vector<Record> m_records;
+  pthread_mutex_t m_lock;
+
+  PhaseProfiler(const PhaseProfiler& source);
+  PhaseProfiler& operator=(const PhaseProfiler& source);
+
+  void add(const Record& record);
+  // one record per phase, in the order of their first record
+  void sumPhases(std::vector<Record>& totals) const;
+  void printTable(std::ostream& out) const;
+  void printJson(std::ostream& out) const;
+
+public:
+  PhaseProfiler() { pthread_mutex_init(&m_lock, NULL); }
+  ~PhaseProfiler() { pthread_mutex_destroy(&m_lock); }
+
+  const std::vector<Record>& records() const { return m_records; }
+  void print(std::ostream& out, Format format) const
+  {  if (format == FJson)
+      printJson(out);
+    else
+      printTable(out);
+  }
+
+  // in seconds; the CPU time is the one of the calling thread
+  static double wallTime();
+  static double cpuTime();
+  // in kilobytes
+  static long peakResidentSize();
+};
+
+#endif // ProfilerH
@@ -0,0 +1,104 @@
+#ifndef RegisterAllocationH
+#define RegisterAllocationH
+
+#include "DefUse.h"
+#include "Loops.h"
+
+/****************************/
+/* Allocation des registres */
+/****************************/
+
+// Linear-scan allocation of the SSA variables of a function to a number of
+// machine registers. The instructions are numbered along the layout of the
+// blocks chosen by the code generator, each one reading its variables
+// before writing the one it assigns, and a variable lives from its
+// definition, the label for a phi function, to its last use; a phi
+// operand is read after the end of the predecessor it comes from. The live
+// interval of a variable covers in addition the blocks where it is live,
+// found by climbing the predecessors from its uses up to its definition,
+// so an interval is the hull of the live ranges and a variable live
+// around a loop keeps its register in the whole loop.
+//
+// Before the scan, a phi function and its operands are coalesced into one
+// class when their intervals do not overlap, the copies of the most
+// nested loops first: the class has the hull of their intervals and a
+// single location, so its copies on the edges disappear.
+//
+// The intervals are scanned by increasing start. When no register is
+// free, the interval of lowest spill cost among the active ones and the
+// new one stays in memory, the definitions and uses weighing 10 times
+// more for each loop around them; the ties are broken by spilling the
+// interval ending last. The variables not in SSA form, the parameters and
+// the globals stay in memory.
+class RegisterAllocation {
+public:
+  class Interval {
+  public:
+    int variable;
+    int start;
+    int end;
+    int spillCost;
+
+    Interval(int variableSource, int startSource)
+    :  variable(variableSource), start(startSource), end(startSource), spillCost(0) {}
+  };
+
+private:
+  const ControlFlowGraph& m_graph;
+  DefUseChains m_chains;
+  // position of the instructions by registration index, -1 when unreachable
+  std::vector<int> m_positions;
+  std::vector<int> m_loopDepths;
+  // intervals of the classes, by increasing start
+  std::vector<Interval> m_intervals;
+  // phi copies, by decreasing weight then the variables of the phi
+  // function and of the operand
+  std::vector<std::pair<int, std::pair<int, int> > > m_phiCopies;
+  // class of the variables, the variable with the interval of the class
+  std::vector<int> m_classes;
+  // register of the classes, -1 for the ones in memory
+  std::vector<int> m_registers;
+  int m_coalescedCopies;
+  int m_usedRegisters;
+  int m_allocatedVariables;
+  int m_spilledVariables;
+
+  static bool isStartingBefore(const Interval& fst, const Interval& snd)
+  {  return fst.start < snd.start || (fst.start == snd.start && fst.variable < snd.variable); }
+  int weight(int block) const;
+  void addUse(Interval& interval, int block, int position);
+  void extendToDefinition(Interval& interval, int block, int definitionBlock, std::vector<int>& visits);
+  void buildInterval(int variable, std::vector<int>& visits);
+  int findRoot(int variable) const
+  {  while (m_classes[variable] != variable)
+      variable = m_classes[variable];
+    return variable;
+  }
+  void coalesce(std::vector<int>& intervalIndexes);
+
+public:
+  // layout is the order of the reachable blocks in the generated code
+  RegisterAllocation(ControlFlowGraph& graph, const std::vector<int>& layout);
+
+  void allocate(int registers);
+  // class of a local variable, -1 if it is not in SSA form
+  int findClass(const VirtualExpression& variable) const
+  {  int index = m_chains.findVariable(variable);
+    return (index >= 0 && m_chains.isSSA(index)) ? m_classes[index] : -1;
+  }
+  // register of a local variable, -1 if it stays in memory
+  int findRegister(const VirtualExpression& variable) const
+  {  int index = findClass(variable);
+    return (index >= 0) ? m_registers[index] : -1;
+  }
+  const DefUseChains& chains() const { return m_chains; }
+  const std::vector<Interval>& intervals() const { return m_intervals; }
+  // registers 0 to countUsedRegisters()-1 receive a variable
+  int countUsedRegisters() const { return m_usedRegisters; }
+  int countAllocatedVariables() const { return m_allocatedVariables; }
+  int countSpilledVariables() const { return m_spilledVariables; }
+  // operands of phi functions sharing the class of the phi variable
+  int countCoalescedCopies() const { return m_coalescedCopies; }
+};
+
+#endif // RegisterAllocationH
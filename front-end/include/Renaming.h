@@ -0,0 +1,45 @@
+#ifndef RenamingH
+#define RenamingH
+
+#include "DefUse.h"
+
+/**************************/
+/* Renommage en forme SSA */
+/**************************/
+
+// Renaming of the local variables of a function once its phi functions are
+// inserted, after Cytron et al. The blocks are visited in the preorder of
+// the dominator tree: a definition gets a new version of its variable, the
+// first one keeping the declaration, and the uses read the version of the
+// nearest dominating definition. Each block then fills, in the phi functions
+// of its successors, the operand coming through their edge. The
+// versions of a subtree are restored when the walk leaves it, which makes
+// one stack of definitions by variable.
+//
+// The variables are numbered by the def-use chains, built before the
+// renaming, so a version finds its variable through the declaration it
+// comes from. A variable whose address is taken is left as it is: it is
+// read and written through the pointers as well.
+class SSARenaming {
+private:
+  ControlFlowGraph& m_graph;
+  DefUseChains m_chains;
+  int m_ident;
+  // local index of the version of each variable in the current subtree,
+  // -1 before its first definition
+  std::vector<int> m_versions;
+  std::vector<std::pair<int, int> > m_oldVersions;
+
+  int findVariable(const LocalVariableExpression& local) const;
+  void define(LocalVariableExpression& local, VirtualInstruction& instruction);
+  void rename(VirtualExpression& expression, VirtualInstruction& instruction);
+  void fillPhis(int block, int successor);
+  void visitBlock(int block);
+
+public:
+  SSARenaming(Function& function);
+
+  void apply();
+};
+
+#endif // RenamingH
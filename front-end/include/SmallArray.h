@@ -0,0 +1,82 @@
+#ifndef SmallArrayH
+#define SmallArrayH
+
+#include <cstddef>
+
+/********************************************/
+/* Définition des tableaux à stockage local */
+/********************************************/
+
+// Growable array whose first InlineCapacity elements are stored in the
+// object itself. It is meant for the short lists hung on every join (the
+// origins and the operands of the phi functions), most of them staying
+// within the inline storage and never reaching the heap. The elements are
+// copied with their assignment.
+template <class Element, int InlineCapacity>
+class SmallArray {
+private:
+  Element m_inline[InlineCapacity];
+  Element* m_elements;
+  int m_count;
+  int m_capacity;
+
+  void grow()
+  {  int capacity = 2*m_capacity;
+    Element* elements = new Element[capacity];
+    for (int index = 0; index < m_count; ++index)
+      elements[index] = m_elements[index];
+    if (m_elements != m_inline)
+      delete [] m_elements;
+    m_elements = elements;
+    m_capacity = capacity;
+  }
+
+public:
+  SmallArray() : m_elements(m_inline), m_count(0), m_capacity(InlineCapacity) {}
+  SmallArray(const SmallArray& source)
+  :  m_elements(m_inline), m_count(0), m_capacity(InlineCapacity)
+  {  for (int index = 0; index < source.m_count; ++index)
+      push_back(source.m_elements[index]);
+  }
+  ~SmallArray()
+  {  if (m_elements != m_inline)
+      delete [] m_elements;
+  }
+  SmallArray& operator=(const SmallArray& source)
+  {  if (this != &source) {
+      m_count = 0;
+      for (int index = 0; index < source.m_count; ++index)
+        push_back(source.m_elements[index]);
+    };
+    return *this;
+  }
+
+  int size() const { return m_count; }
+  bool empty() const { return m_count == 0; }
+  bool isInline() const { return m_elements == m_inline; }
+  Element& operator[](int index) { return m_elements[index]; }
+  const Element& operator[](int index) const { return m_elements[index]; }
+  void push_back(const Element& element)
+  {  if (m_count == m_capacity)
+      grow();
+    m_elements[m_count++] = element;
+  }
+  void pop_back() { --m_count; }
+  void clear() { m_count = 0; }
+  // index of the first element equal to element, -1 if there is none
+  int find(const Element& element) const
+  {  for (int index = 0; index < m_count; ++index)
+      if (m_elements[index] == element)
+        return index;
+    return -1;
+  }
+  // adds element at the end unless it is already present
+  bool addNew(const Element& element)
+  {  if (find(element) >= 0)
+      return false;
+    push_back(element);
+    return true;
+  }
+};
+
+#endif // SmallArrayH
@@ -8,6 +8,11 @@
 #include <list>
 #include <set>
 #include <memory>
+#include <algorithm>
+#include <functional>
+#include "Arena.h"
+#include "Atoms.h"
+#include "SmallArray.h"
 
 namespace std {
 
@@ -22,19 +27,21 @@ namespace std {
     :  m_count(NULL), m_object(object)
     {  if (m_object) {
       m_count = new int;
-      *m_count = 0;
-      ++(*m_count);
+      *m_count = 1;
     };
   }
   shared_ptr(const shared_ptr<Type>& source)
   :  m_count(source.m_count), m_object(source.m_object)
-  {  if (m_count) ++(*m_count); }
+  {  if (m_count) __sync_add_and_fetch(m_count, 1); }
   shared_ptr<Type>& operator=(const shared_ptr<Type>& source)
   {  if (this != &source) {
+    // source may be owned by the object we release
+    int* count = source.m_count;
+    Type* object = source.m_object;
+    if (count) __sync_add_and_fetch(count, 1);
     clear();
-    m_count = source.m_count;
-    m_object = source.m_object;
-    if (m_count) ++(*m_count);
+    m_count = count;
+    m_object = object;
   };
   return *this;
 }
@@ -43,13 +50,12 @@ void reset(Type* ptObjectSource)
   m_object = ptObjectSource;
   if (m_object) {
     m_count = new int;
-    *m_count = 0;
-    ++(*m_count);
+    *m_count = 1;
   };
 }
 ~shared_ptr()
 {  if (m_count && m_object) {
-  if (--(*m_count) == 0) {
+  if (__sync_sub_and_fetch(m_count, 1) == 0) {
     delete m_count;
     delete m_object;
   };
@@ -59,7 +65,7 @@ void reset(Type* ptObjectSource)
 }
 void clear()
 {  if (m_count && m_object) {
-  if (--(*m_count) == 0) {
+  if (__sync_sub_and_fetch(m_count, 1) == 0) {
     delete m_count;
     delete m_object;
   };
@@ -94,7 +100,13 @@ class Function;
 class VirtualInstruction;
 class SymbolTable {
 private:
-  std::map<std::string, int> m_localIndexes;
+  AtomMap<int> m_localIndexes;
+  // By local index, the declared name, or for an SSA version the name of the
+  // renamed variable. The version is printed as a suffix, so the renamings
+  // do not intern one atom per definition.
+  std::vector<Atom> m_names;
+  std::vector<int> m_renamedIndexes; // -1 for a declaration
+  std::vector<int> m_versions;
   std::vector<VirtualType*> m_types;
   std::vector<VirtualInstruction*> m_uniqueDefinitions;
   std::shared_ptr<SymbolTable> m_parent;
@@ -108,22 +120,28 @@ public:
     m_types.clear();
   }
 
-  void addDeclaration(const std::string& name, VirtualType* type)
-  {  m_localIndexes.insert(std::pair<std::string, int>(name, m_types.size()));
+  void addDeclaration(Atom name, VirtualType* type)
+  {  m_localIndexes.insert(name, m_types.size());
+    m_names.push_back(name);
+    m_renamedIndexes.push_back(-1);
+    m_versions.push_back(0);
     m_types.push_back(type);
   }
-  bool contain(const std::string& name) const { return m_localIndexes.find(name) != m_localIndexes.end(); }
-  int localIndex(const std::string& name) const { return m_localIndexes.find(name)->second; }
-  const VirtualType& getType(int uIndex) const { return *m_types[uIndex]; }
+  bool contain(Atom name) const { return m_localIndexes.contain(name); }
+  int localIndex(Atom name) const { return *m_localIndexes.find(name); }
+  const VirtualType& getType(int uIndex) const
+  {  assert(uIndex >= 0 && uIndex < (int) m_types.size()); return *m_types[uIndex]; }
+  // the renaming may reach a table several times
   void setSizeDefinitions()
   {
-    m_uniqueDefinitions.reserve(m_types.size());
-    for (std::vector<VirtualType*>::const_iterator iter = m_types.begin(); iter != m_types.end(); ++iter)
-    {
-      m_uniqueDefinitions.push_back(NULL);
-    }
+    m_uniqueDefinitions.resize(m_types.size(), NULL);
+  }
+  int addSSADeclaration(int localIndex, int& ident);
+  // the declaration an SSA version comes from
+  int originalIndex(int localIndex) const
+  {
+    return (m_renamedIndexes[localIndex] >= 0) ? m_renamedIndexes[localIndex] : localIndex;
   }
-  int addSSADeclaration(std::string& name, int localIndex, int& indent);
   bool hasSSADefinition(int localIndex) const
   {
     return m_uniqueDefinitions[localIndex] != NULL;
@@ -133,13 +151,31 @@ public:
     m_uniqueDefinitions[localIndex] = &instruction;
   }
   friend class Scope;
+  // The first declaration of a name and the SSA versions, in the order of
+  // their local indexes.
   void printAsDeclarations(std::ostream& out) const
-  {  for (std::map<std::string, int>::const_iterator iIter = m_localIndexes.begin();
-    iIter != m_localIndexes.end(); ++iIter)
-    out << m_types[iIter->second] << ' ' << iIter->first
-    << " := " << iIter->second << '\t';
+  {  for (int index = 0; index < (int) m_types.size(); ++index) {
+      if (m_renamedIndexes[index] < 0 && *m_localIndexes.find(m_names[index]) != index)
+        continue;
+      if (m_types[index])
+        m_types[index]->print(out);
+      else
+        out << "void";
+      out << ' ';
+      printName(out, index);
+      out << " := " << index << '\t';
+    };
+  }
+  void printName(std::ostream& out, int localIndex) const
+  {  if (m_renamedIndexes[localIndex] >= 0) {
+      printName(out, m_renamedIndexes[localIndex]);
+      out << '_' << m_versions[localIndex];
+    }
+    else
+      out << Atoms::name(m_names[localIndex]);
   }
   int count() const { return m_types.size(); }
+  Atom getName(int localIndex) const { return m_names[localIndex]; }
 };
 
 class Scope {
@@ -160,30 +196,37 @@ public:
   void pop() { m_last = m_last->m_parent; }
   enum FindResult { FRNotFound, FRLocal, FRGlobal, FRType };
 
-  void addDeclaration(const std::string& name, VirtualType* type)
+  void addDeclaration(Atom name, VirtualType* type)
   {  m_last->addDeclaration(name, type); }
   void setSizeDefinitions()
   {
     m_last->setSizeDefinitions();
   }
-  int addSSADeclaration(std::string& name, int localIndex, int& ident)
+  int addSSADeclaration(int localIndex, int& ident)
   {
-    return m_last->addSSADeclaration(name, localIndex, ident);
+    return m_last->addSSADeclaration(localIndex, ident);
   }
   bool hasSSADefinition(int localIndex) const
   {
     return m_last->hasSSADefinition(localIndex);
   }
+  int originalIndex(int localIndex) const
+  {
+    return m_last->originalIndex(localIndex);
+  }
   void setSSADefinition(int localIndex, VirtualInstruction& instruction)
   {
     m_last->setSSADefinition(localIndex, instruction);
   }
-  FindResult find(const std::string& name, int& local, Scope& scope) const;
+  FindResult find(Atom name, int& local, Scope& scope) const;
   int getFunctionIndex(int local) const;
   void printAsDeclarations(std::ostream& out) const
   {  m_last->printAsDeclarations(out); }
   int count() const { return m_last->count(); }
   const VirtualType& getType(int uIndex) const { return m_last->getType(uIndex); }
+  Atom getName(int localIndex) const { return m_last->getName(localIndex); }
+  void printName(std::ostream& out, int localIndex) const { m_last->printName(out, localIndex); }
+  const SymbolTable& symbolTable() const { return *m_last; }
 };
 
 /************************/
@@ -201,6 +244,7 @@ public:
   BaseType() : m_value(VUndefined) {}
   BaseType(Value valueSource) : m_value(valueSource) {}
   BaseType(const BaseType& source) : VirtualType(source), m_value(source.m_value) {}
+  Value getValue() const { return m_value; }
   virtual int getSize() const
   {  assert(m_value != VUndefined); return (m_value == VInt) ? 4 : 1; }
   virtual VirtualType* clone() const { return new BaseType(*this); }
@@ -220,6 +264,7 @@ public:
   virtual int getSize() const { return 4; }
   virtual VirtualType* clone() const { return new PointerType(*this); }
   VirtualType* getSubType() { return m_subType.release(); }
+  const VirtualType* getSSubType() const { return m_subType.get(); }
   virtual void print(std::ostream& out) const
   {  m_subType->print(out);
     out << '*';
@@ -273,25 +318,36 @@ public:
 
 class WorkList {
 private:
-  std::list<VirtualTask*> m_tasks;
+  // Tasks added as first, the front being the last element, extracted
+  // before the buckets. A sorted task added while they are pending is
+  // placed among them, so the order is the one of a single sorted list.
+  std::vector<VirtualTask*> m_tasks;
+  // Sorted tasks: one bucket per registration index, the front of a bucket
+  // being its last element, and a min-heap of the indexes of the non-empty
+  // buckets.
+  std::vector<std::vector<VirtualTask*> > m_sortedTasks;
+  std::vector<int> m_sortedIndexes;
+  // Instructions already visited, indexed by registration index.
+  std::vector<bool> m_marks;
+  // Tasks handled by execute, for the profiler.
+  int m_executedTasks;
+
+protected:
+  void setMark(const VirtualInstruction& instruction);
 
 public:
-  WorkList() {}
-  virtual ~WorkList()
-  {  for (std::list<VirtualTask*>::iterator iIter = m_tasks.begin();
-    iIter != m_tasks.end(); ++iIter)
-    if (*iIter) delete (*iIter);
-    m_tasks.clear();
-  }
+  WorkList() : m_executedTasks(0) {}
+  virtual ~WorkList();
 
-  void addNewAsFirst(VirtualTask* task) { m_tasks.push_front(task); }
-  void addNewAsLast(VirtualTask* task) { m_tasks.push_back(task); }
+  bool isEmpty() const { return m_tasks.empty() && m_sortedIndexes.empty(); }
+  void addNewAsFirst(VirtualTask* task) { m_tasks.push_back(task); }
   void addNewSorted(VirtualTask* task);
-  VirtualTask* extractFirst() { VirtualTask* result = m_tasks.front(); m_tasks.pop_front(); return result; }
-  VirtualTask* extractLast() { VirtualTask* result = m_tasks.back(); m_tasks.pop_back(); return result; }
+  VirtualTask* extractFirst();
   virtual void markInstructionWith(VirtualInstruction& instruction, VirtualTask& task);
+  virtual bool isMarked(const VirtualInstruction& instruction) const;
 
   void execute();
+  int countExecutedTasks() const { return m_executedTasks; }
 
   class Reusability {
   private:
@@ -313,7 +369,7 @@ public:
 /* Définitions des expressions */
 /*******************************/
 
-class VirtualExpression {
+class VirtualExpression : public ArenaNode {
 public:
   enum Type
   {  TUndefined, TConstant, TChar, TString, TLocalVariable, TParameter, TGlobalVariable,
@@ -359,6 +415,8 @@ private:
 
 public:
   ConstantExpression(int value) : m_value(value) { setType(TConstant); }
+  ConstantExpression(const ConstantExpression& source) : VirtualExpression(source), m_value(source.m_value) {}
+  virtual VirtualExpression* clone() const { return new ConstantExpression(*this); }
 
   const int& value() const { return m_value; }
   virtual void print(std::ostream& out) const { out << m_value; }
@@ -372,6 +430,8 @@ private:
 
 public:
   CharExpression(int valueSource) : m_value(valueSource) { setType(TChar); }
+  CharExpression(const CharExpression& source) : VirtualExpression(source), m_value(source.m_value) {}
+  virtual VirtualExpression* clone() const { return new CharExpression(*this); }
 
   const char& value() const { return m_value; }
   virtual void print(std::ostream& out) const { out << m_value; }
@@ -385,6 +445,8 @@ private:
 
 public:
   StringExpression(const std::string& valueSource) : m_value(valueSource) { setType(TString); }
+  // with its quotes
+  const std::string& getValue() const { return m_value; }
 
   virtual void print(std::ostream& out) const { out << '"' << m_value << '"'; }
   virtual std::auto_ptr<VirtualType> newType(Function* function) const
@@ -394,11 +456,11 @@ public:
 class LocalVariableExpression : public VirtualExpression {
 private:
   Scope m_scope;
-  std::string m_name;
+  Atom m_name;
   int m_localIndex;
 
 public:
-  LocalVariableExpression(const std::string& name, int localIndex, Scope scope)
+  LocalVariableExpression(Atom name, int localIndex, Scope scope)
   :  m_scope(scope), m_name(name), m_localIndex(localIndex)
   {
     setType(TLocalVariable);
@@ -412,25 +474,35 @@ public:
   {
     return new LocalVariableExpression(*this);
   }
-  virtual void print(std::ostream& out) const { out << "[local " << m_localIndex << ": " << m_name << ']'; }
+  virtual void print(std::ostream& out) const
+  {  out << "[local " << m_localIndex << ": ";
+    m_scope.printName(out, m_localIndex);
+    out << ']';
+  }
+  Atom getName() const { return m_name; }
   int getLocalScope() const { return m_localIndex; }
+  void setLocalScope(int localIndex) { assert(localIndex < m_scope.count()); m_localIndex = localIndex; }
   int getFunctionIndex(Function& function) const;
   int getGlobalIndex() const { return m_scope.getFunctionIndex(m_localIndex); }
   Scope& scope()
   {
     return m_scope;
   }
+  const Scope& scope() const
+  {
+    return m_scope;
+  }
   virtual std::auto_ptr<VirtualType> newType(Function* function) const
   {  return std::auto_ptr<VirtualType>(m_scope.getType(m_localIndex).clone()); }
 };
 
 class ParameterExpression : public VirtualExpression {
 private:
-  std::string m_name;
+  Atom m_name;
   int m_localIndex;
 
 public:
-  ParameterExpression(const std::string& name, int localIndex) : m_name(name), m_localIndex(localIndex)
+  ParameterExpression(Atom name, int localIndex) : m_name(name), m_localIndex(localIndex)
   {
     setType(TParameter);
   }
@@ -443,17 +515,17 @@ public:
     return new ParameterExpression(*this);
   }
   int getIndex() const { return m_localIndex; }
-  virtual void print(std::ostream& out) const { out << "[parameter " << m_localIndex << ": " << m_name << ']'; }
+  virtual void print(std::ostream& out) const { out << "[parameter " << m_localIndex << ": " << Atoms::name(m_name) << ']'; }
   virtual std::auto_ptr<VirtualType> newType(Function* function) const;
 };
 
 class GlobalVariableExpression : public VirtualExpression {
 private:
-  std::string m_name;
+  Atom m_name;
   int m_localIndex;
 
 public:
-  GlobalVariableExpression(const std::string& name, int localIndex)
+  GlobalVariableExpression(Atom name, int localIndex)
   :  m_name(name), m_localIndex(localIndex) { setType(TGlobalVariable); }
   GlobalVariableExpression(const GlobalVariableExpression& source) : VirtualExpression(source), m_name(source.m_name), m_localIndex(source.m_localIndex)
   {
@@ -464,7 +536,8 @@ public:
     return new GlobalVariableExpression(*this);
   }
   const int getIndex() const { return m_localIndex; }
-  virtual void print(std::ostream& out) const { out << "[global " << m_localIndex << ": " << m_name << ']'; }
+  Atom getName() const { return m_name; }
+  virtual void print(std::ostream& out) const { out << "[global " << m_localIndex << ": " << Atoms::name(m_name) << ']'; }
   virtual std::auto_ptr<VirtualType> newType(Function* function) const;
 };
 
@@ -483,7 +556,11 @@ public:
     {  assert(m_operator == OUndefined); m_operator = operatorSource; return *this; }
     ComparisonExpression& setFst(VirtualExpression* fst) { m_fst.reset(fst); return *this; }
     ComparisonExpression& setSnd(VirtualExpression* snd) { m_snd.reset(snd); return *this; }
-    virtual void handle(VirtualTask& task, WorkList& continuations, Reusability& reuse);
+    const VirtualExpression& getFst() const { return *m_fst; }
+    const VirtualExpression& getSnd() const { return *m_snd; }
+    VirtualExpression& getFst() { return *m_fst; }
+    VirtualExpression& getSnd() { return *m_snd; }
+    Operator getOperator() const { return m_operator; }
     virtual void print(std::ostream& out) const
     {  out << '(';
     if (m_fst.get())
@@ -524,7 +601,9 @@ public:
   {  assert(m_operator == OUndefined); m_operator = operatorSource; return *this; }
   UnaryOperatorExpression& setSubExpression(VirtualExpression* subExpression)
   {  m_subExpression.reset(subExpression); return *this; }
-  virtual void handle(VirtualTask &task, WorkList& continuations, Reusability& reuse);
+  Operator getOperator() const { return m_operator; }
+  const VirtualExpression& getSubExpression() const { return *m_subExpression; }
+  VirtualExpression& getSubExpression() { return *m_subExpression; }
   virtual void print(std::ostream& out) const
   {  if (m_operator == OUndefined)
     out << "no-op";
@@ -553,7 +632,11 @@ public:
   {  assert(m_operator == OUndefined); m_operator = operatorSource; return *this; }
   BinaryOperatorExpression& setFst(VirtualExpression* fst) { m_fst.reset(fst); return *this; }
   BinaryOperatorExpression& setSnd(VirtualExpression* snd) { m_snd.reset(snd); return *this; }
-  virtual void handle(VirtualTask& task, WorkList& continuations, Reusability& reuse);
+  const VirtualExpression& getFst() const { return *m_fst; }
+  const VirtualExpression& getSnd() const { return *m_snd; }
+  VirtualExpression& getFst() { return *m_fst; }
+  VirtualExpression& getSnd() { return *m_snd; }
+  Operator getOperator() const { return m_operator; }
   virtual void print(std::ostream& out) const
   {  out << '(';
   if (m_fst.get())
@@ -586,7 +669,8 @@ public:
 
   DereferenceExpression& setSubExpression(VirtualExpression* subExpression)
   {  m_subExpression.reset(subExpression); return *this; }
-  virtual void handle(VirtualTask& task, WorkList& continuations, Reusability& reuse);
+  const VirtualExpression& getSubExpression() const { return *m_subExpression; }
+  VirtualExpression& getSubExpression() { return *m_subExpression; }
   virtual void print(std::ostream& out) const
   {  out << '*';
   if (m_subExpression.get())
@@ -610,7 +694,8 @@ public:
 
   ReferenceExpression& setSubExpression(VirtualExpression* subExpression)
   {  m_subExpression.reset(subExpression); return *this; }
-  virtual void handle(VirtualTask& task, WorkList& continuations, Reusability& reuse);
+  const VirtualExpression& getSubExpression() const { return *m_subExpression; }
+  VirtualExpression& getSubExpression() { return *m_subExpression; }
   virtual void print(std::ostream& out) const
   {  out << '&';
   if (m_subExpression.get())
@@ -634,8 +719,10 @@ public:
 
   CastExpression& setSubExpression(VirtualExpression* subExpression)
   {  m_subExpression.reset(subExpression); return *this; }
-  virtual void handle(VirtualTask& task, WorkList& continuations, Reusability& reuse);
+  const VirtualExpression& getSubExpression() const { return *m_subExpression; }
+  VirtualExpression& getSubExpression() { return *m_subExpression; }
   CastExpression& setType(VirtualType* type) { m_type.reset(type); return *this; }
+  const VirtualType& getCastType() const { return *m_type; }
   virtual void print(std::ostream& out) const
   {  out << '(';
   if (m_type.get())
@@ -664,9 +751,18 @@ public:
     if (*iIter) delete (*iIter);
     m_arguments.clear();
   }
-  virtual void handle(VirtualTask& task, WorkList& continuations, Reusability& reuse);
   FunctionCallExpression& addArgument(VirtualExpression* argument)
   {  m_arguments.push_back(argument); return *this; }
+  int countArguments() const { return m_arguments.size(); }
+  const Function& getFunction() const { return *m_function; }
+  const VirtualExpression& getArgument(int index) const { return *m_arguments[index]; }
+  VirtualExpression& getArgument(int index) { return *m_arguments[index]; }
+  void setArgument(int index, VirtualExpression* argument)
+  {  if (m_arguments[index] != argument) {
+      delete m_arguments[index];
+      m_arguments[index] = argument;
+    };
+  }
   virtual void print(std::ostream& out) const;
   virtual std::auto_ptr<VirtualType> newType(Function* callerFunction) const;
 };
@@ -689,6 +785,14 @@ public:
   {
     return *m_rvalue;
   }
+  VirtualExpression& getLValue()
+  {
+    return *m_lvalue;
+  }
+  VirtualExpression& getRValue()
+  {
+    return *m_rvalue;
+  }
   virtual void handle(VirtualTask& task, WorkList& continuations, Reusability& reuse);
   virtual void print(std::ostream& out) const
   {  if (m_lvalue.get())
@@ -706,39 +810,89 @@ public:
 };
 
 class GotoInstruction;
+// Phi function of a join: one operand by incoming edge, the edge being
+// identified by the goto that ends the predecessor. The operands of the
+// usual two-way joins stay in the inline storage of the array.
 class PhiExpression : public VirtualExpression
 {
 private:
-  std::auto_ptr<VirtualExpression> m_fst;
-  GotoInstruction* m_fstFrom;
-  std::auto_ptr<VirtualExpression> m_snd;
-  GotoInstruction* m_sndFrom;
+  class Operand
+  {
+  public:
+    VirtualExpression* expression;
+    GotoInstruction* origin;
+
+    Operand() : expression(NULL), origin(NULL) {}
+    Operand(VirtualExpression* expressionSource, GotoInstruction* originSource)
+    :  expression(expressionSource), origin(originSource) {}
+  };
+  SmallArray<Operand, 2> m_operands;
+
 public:
-  PhiExpression() : m_fstFrom(NULL), m_sndFrom(NULL)
+  PhiExpression()
   {
     setType(TPhi);
   }
+  virtual ~PhiExpression()
+  {
+    for (int index = 0; index < m_operands.size(); ++index)
+    {
+      delete m_operands[index].expression;
+    }
+  }
 
   PhiExpression& addReference(VirtualExpression* expression, GotoInstruction& gotoInstruction)
   {
-    if (m_fst.get())
+    m_operands.push_back(Operand(expression, &gotoInstruction));
+    return *this;
+  }
+  // origin is NULL for the instruction falling into the label
+  PhiExpression& addOperand(VirtualExpression* expression, GotoInstruction* origin)
+  {
+    m_operands.push_back(Operand(expression, origin));
+    return *this;
+  }
+  // the operand coming through origin becomes expression
+  PhiExpression& setOperand(GotoInstruction* origin, VirtualExpression* expression)
+  {
+    int index = findOrigin(origin);
+    if (index < 0)
     {
-      assert(!m_snd.get());
-      m_snd.reset(expression);
-      m_sndFrom = &gotoInstruction;
+      return addOperand(expression, origin);
     }
-    else
+    delete m_operands[index].expression;
+    m_operands[index].expression = expression;
+    return *this;
+  }
+  int countOperands() const { return m_operands.size(); }
+  const VirtualExpression& getOperand(int index) const { return *m_operands[index].expression; }
+  GotoInstruction* getOrigin(int index) const { return m_operands[index].origin; }
+  // the operands keep their order
+  void removeOperand(int index)
+  {
+    delete m_operands[index].expression;
+    for (; index+1 < m_operands.size(); ++index)
     {
-      m_fst.reset(expression);
-      m_fstFrom = &gotoInstruction;
+      m_operands[index] = m_operands[index+1];
     }
-    return *this;
+    m_operands.pop_back();
+  }
+  // index of the operand coming through origin, -1 if there is none
+  int findOrigin(const GotoInstruction* origin) const
+  {
+    for (int index = 0; index < m_operands.size(); ++index)
+    {
+      if (m_operands[index].origin == origin)
+      {
+        return index;
+      }
+    }
+    return -1;
   }
-  virtual void handle(VirtualTask& task, WorkList& continuations, Reusability& reuse);
   virtual void print(std::ostream& out) const;
   virtual std::auto_ptr<VirtualType> newType(Function* function) const
   {
-    return m_fst.get() ? m_fst->newType(function) : m_snd->newType(function);
+    return m_operands[0].expression->newType(function);
   }
 };
 
@@ -747,7 +901,7 @@ public:
 /*******************************/
 
 class IfInstruction;
-class VirtualInstruction {
+class VirtualInstruction : public ArenaNode {
 public:
   enum Type { TUndefined, TExpression, TIf, TGoto, TLabel, TReturn, TEnterBlock, TExitBlock };
   typedef WorkList::Reusability Reusability;
@@ -759,9 +913,6 @@ private:
   int m_registrationIndex;
   int m_dominationHeight;
 
-public:
-  mutable void* mark;
-
 protected:
   void setType(Type type) { assert(m_type == TUndefined); m_type = type; }
   void setNextTo(VirtualInstruction& next) { m_next = &next; }
@@ -775,7 +926,7 @@ protected:
 
 public:
   VirtualInstruction()
-  : m_type(TUndefined), m_next(NULL), m_previous(NULL), m_registrationIndex(-1), m_dominationHeight(0), mark(NULL) {}
+  : m_type(TUndefined), m_next(NULL), m_previous(NULL), m_registrationIndex(-1), m_dominationHeight(0) {}
   virtual ~VirtualInstruction() {}
 
   Type type() const { return m_type; }
@@ -788,7 +939,7 @@ public:
     if (nexts == 0)
     result = true;
     if (m_next) {
-      if (m_next->mark == 0) {
+      if (!continuations.isMarked(*m_next)) {
         task.clearInstruction();
         task.setInstruction(*m_next);
         reuse.setReuse();
@@ -819,7 +970,6 @@ public:
     return result;
   }
   virtual void print(std::ostream& out) const = 0;
-  void clearMark() { mark = NULL; }
   bool isValid() const { return m_registrationIndex >= 0; }
   const int& getRegistrationIndex() const { return m_registrationIndex; }
   friend class Function;
@@ -831,9 +981,23 @@ VirtualTask::compare(const VirtualTask& source) const
   source.getInstruction().getRegistrationIndex());
 }
 
+inline void
+WorkList::setMark(const VirtualInstruction& instruction)
+{  int index = instruction.getRegistrationIndex();
+  if (index >= (int) m_marks.size())
+    m_marks.resize(index+1, false);
+  m_marks[index] = true;
+}
+
 inline void
 WorkList::markInstructionWith(VirtualInstruction& instruction, VirtualTask& task)
-{  instruction.mark = (void*) 1; }
+{  setMark(instruction); }
+
+inline bool
+WorkList::isMarked(const VirtualInstruction& instruction) const
+{  int index = instruction.getRegistrationIndex();
+  return (index < (int) m_marks.size()) && m_marks[index];
+}
 
 class ExpressionInstruction : public VirtualInstruction {
 private:
@@ -843,10 +1007,12 @@ public:
   ExpressionInstruction() { setType(TExpression); }
   bool isPhi() const
   {
-    return (((AssignExpression&) *m_expression).getRValue().type() == VirtualExpression::TPhi) && (m_expression->type() == VirtualExpression::TAssign);
+    return (m_expression->type() == VirtualExpression::TAssign) && (((AssignExpression&) *m_expression).getRValue().type() == VirtualExpression::TPhi);
   }
   virtual void handle(VirtualTask& task, WorkList& continuations, Reusability& reuse);
   ExpressionInstruction& setExpression(VirtualExpression* expression) { m_expression.reset(expression); return *this; }
+  const VirtualExpression& getExpression() const { return *m_expression; }
+  VirtualExpression& getExpression() { return *m_expression; }
   virtual void print(std::ostream& out) const
   {  m_expression->print(out);
     out << ';' << '\n';
@@ -861,9 +1027,13 @@ private:
 
 public:
   IfInstruction() { setType(TIf); }
-  virtual void handle(VirtualTask& task, WorkList& continuations, Reusability& reuse);
   virtual int countNexts() const { return VirtualInstruction::countNexts() + (m_then ? 1 : 0); }
   IfInstruction& setExpression(VirtualExpression* expression) { m_expression.reset(expression); return *this; }
+  const VirtualExpression& getExpression() const { return *m_expression; }
+  VirtualExpression& getExpression() { return *m_expression; }
+  GotoInstruction* getSThenInstruction() const { return m_then; }
+  // drops the then branch, when the condition is known to be false
+  GotoInstruction* disconnectThen();
   void connectToThen(GotoInstruction& gotoPoint);
   void connectToElse(GotoInstruction& gotoPoint);
 
@@ -893,6 +1063,8 @@ public:
   void setAfterIfElse() { assert(m_context == CUndefined); m_context = CAfterIfElse; }
   void setLoop() { assert(m_context == CUndefined); m_context = CLoop; }
   void setBeforeLabel() { assert(m_context == CUndefined); m_context = CBeforeLabel; }
+  bool isLoop() const { return m_context == CLoop; }
+  Context getContext() const { return m_context; }
   void connectToLabel(LabelInstruction& liInstruction);
   virtual void handle(VirtualTask& task, WorkList& continuations, Reusability& reuse);
   virtual bool propagateOnUnmarked(VirtualTask& task, WorkList& continuations, Reusability& reuse) const;
@@ -907,16 +1079,17 @@ public:
   }
   virtual void print(std::ostream& out) const
   {
+    int target = getSNextInstruction() ? getSNextInstruction()->getRegistrationIndex() : -1;
     if (m_context == CLoop)
-    out << "goto loop " << getSNextInstruction();
+    out << "goto loop " << target;
     else if (m_context == CAfterIfThen)
     out << "then";
     else if (m_context == CAfterIfElse)
     out << "else";
     else if (m_context == CBeforeLabel)
-    out << "goto label " << getSNextInstruction();
+    out << "goto label " << target;
     else
-    out << "goto " << std::hex << getSNextInstruction() << std::dec;
+    out << "goto " << target;
     if (!m_dominationFrontier.empty())
     {
       out << "\tdomination fronter = ";
@@ -937,12 +1110,22 @@ inline void
 IfInstruction::connectToElse(GotoInstruction& elsePoint)
 { connectTo(elsePoint); elsePoint.setAfterIfElse(); }
 
+inline GotoInstruction*
+IfInstruction::disconnectThen()
+{  GotoInstruction* result = m_then;
+  if (m_then) {
+    ((VirtualInstruction*) m_then)->m_previous = NULL;
+    m_then = NULL;
+  };
+  return result;
+}
+
 
 inline bool
 IfInstruction::propagateOnUnmarked(VirtualTask& task, WorkList& continuations, Reusability& reuse) const {
   if (!VirtualInstruction::propagateOnUnmarked(task, continuations, reuse)) {
     if (m_then) {
-      if (m_then->mark == 0) {
+      if (!continuations.isMarked(*m_then)) {
         std::auto_ptr<VirtualTask> newTask(task.clone());
         newTask->clearInstruction();
         newTask->setInstruction(*m_then);
@@ -961,17 +1144,29 @@ private:
   GotoInstruction* m_goto;
   VirtualInstruction* m_dominator;
   DominationFrontier m_dominationFrontier;
+  // executions of a loop header known by the induction variables, -1 if not
+  int m_tripCount;
 
 public:
-  LabelInstruction() : m_goto(NULL), m_dominator(NULL) { setType(TLabel); }
+  LabelInstruction() : m_goto(NULL), m_dominator(NULL), m_tripCount(-1) { setType(TLabel); }
 
   virtual int countPreviouses() const { return VirtualInstruction::countPreviouses() + (m_goto ? 1 : 0); }
   virtual void handle(VirtualTask& task, WorkList& continuations, Reusability& reuse);
   VirtualInstruction* getSDominator() const { return m_dominator; }
+  void setDominator(VirtualInstruction& dominator) { m_dominator = &dominator; }
   void setGotoFrom(GotoInstruction& gotoPoint) { assert(!m_goto); m_goto = &gotoPoint; }
+  GotoInstruction* getSGotoInstruction() const { return m_goto; }
+  // the goto keeps its target, it is only forgotten by the label
+  GotoInstruction* disconnectGoto()
+  {  GotoInstruction* result = m_goto;
+    m_goto = NULL;
+    return result;
+  }
+  void setTripCount(int tripCount) { m_tripCount = tripCount; }
+  int getTripCount() const { return m_tripCount; }
   virtual void print(std::ostream& out) const
   {
-    out << "label " << this;
+    out << "label " << getRegistrationIndex();
     if (m_dominator)
     {
       out << '\t' << "dominated by " << m_dominator->getRegistrationIndex() << ' ';
@@ -990,6 +1185,10 @@ public:
       }
       out << '\n';
     }
+    if (m_tripCount >= 0)
+    {
+      out << "\ttrip count = " << m_tripCount << '\n';
+    }
   }
   void addDominationFrontier(GotoInstruction& gotoInstruction)
   {
@@ -1021,8 +1220,9 @@ private:
 
 public:
   ReturnInstruction() { setType(TReturn); }
-  virtual void handle(VirtualTask& task, WorkList& continuations, Reusability& reuse);
   ReturnInstruction& setResult(VirtualExpression* expression) { m_result.reset(expression); return *this; }
+  const VirtualExpression& getResult() const { return *m_result; }
+  VirtualExpression& getResult() { return *m_result; }
   virtual void print(std::ostream& out) const
   {  out << "return ";
   m_result->print(out);
@@ -1066,10 +1266,14 @@ public:
 /****************************/
 
 class Function;
+class PhiInsertionAgenda;
+class PhaseProfiler;
+class ControlFlowGraph;
+class Liveness;
 class FunctionSignature {
 private:
   std::vector<VirtualType*> m_parameterType;
-  std::vector<std::string> m_parameterNames;
+  std::vector<Atom> m_parameterNames;
   std::auto_ptr<VirtualType> m_resultType;
 
 public:
@@ -1083,13 +1287,16 @@ public:
 
   void addNewParameter(const std::string& parameterName, VirtualType* type)
   {  m_parameterType.push_back(type);
-    m_parameterNames.push_back(parameterName);
+    m_parameterNames.push_back(Atoms::intern(parameterName));
   }
   void setResult(VirtualType* type) { m_resultType.reset(type); }
   int size() const { return m_parameterType.size(); }
   const VirtualType& getTypeParameter(int uIndex) const { return *m_parameterType[uIndex]; }
+  Atom getParameterName(int index) const { return m_parameterNames[index]; }
   const VirtualType& getResultType() const { return *m_resultType; }
-  bool findParameters(const std::string& name, int& local) const
+  // NULL for void and for the functions only called
+  const VirtualType* getSResultType() const { return m_resultType.get(); }
+  bool findParameters(Atom name, int& local) const
   {  bool fResult = false;
     int uSize = m_parameterNames.size();
     for (int uIndex = 0; uIndex < uSize; ++uIndex)
@@ -1109,20 +1316,29 @@ private:
   FunctionSignature m_signature;
   std::string m_name;
   std::vector<VirtualInstruction*> m_instructions;
+  Arena m_arena;
+  ControlFlowGraph* m_controlFlow;
+  // phi functions of the minimal form and phi functions really inserted
+  int m_phiCandidates;
+  int m_phis;
+  // worklist tasks run on the function, for the profiler
+  int m_executedTasks;
+  // what the optimizations did, in the order of the passes
+  std::vector<std::pair<const char*, int> > m_statistics;
 
 public:
-  Function() : m_globalScope(NULL)  {}
-  Function(const std::string& name) : m_globalScope(NULL), m_name(name)  {}
+  Function()
+  :  m_globalScope(NULL), m_controlFlow(NULL), m_phiCandidates(0), m_phis(0), m_executedTasks(0)  {}
+  Function(const std::string& name)
+  :  m_globalScope(NULL), m_name(name), m_controlFlow(NULL), m_phiCandidates(0), m_phis(0),
+    m_executedTasks(0)  {}
   Function(const std::string& name, Scope& globalScope)
-  :  m_globalScope(&globalScope), m_name(name)  {}
+  :  m_globalScope(&globalScope), m_name(name), m_controlFlow(NULL), m_phiCandidates(0), m_phis(0),
+    m_executedTasks(0)  {}
   Function(const Function& source)
-  :  m_globalScope(source.m_globalScope), m_name(source.m_name) {}
-  ~Function()
-  {  for (std::vector<VirtualInstruction*>::iterator iIter = m_instructions.begin();
-    iIter != m_instructions.end(); ++iIter)
-    if (*iIter) delete (*iIter);
-    m_instructions.clear();
-  }
+  :  m_globalScope(source.m_globalScope), m_name(source.m_name), m_controlFlow(NULL),
+    m_phiCandidates(0), m_phis(0), m_executedTasks(0) {}
+  ~Function();
   Function& operator=(const Function& source)
   {  m_globalScope = source.m_globalScope;
     m_name = source.m_name;
@@ -1145,10 +1361,12 @@ public:
   FunctionSignature& signature() { return m_signature; }
   const FunctionSignature& signature() const { return m_signature; }
   const std::string& getName() const { return m_name; }
-  bool findParameters(const std::string& name, int& local) const
+  bool findParameters(Atom name, int& local) const
   {  return signature().findParameters(name, local); }
   VirtualInstruction& getFirstInstruction() const
   {  return *m_instructions[0]; }
+  VirtualInstruction& getInstruction(int registrationIndex) const
+  {  return *m_instructions[registrationIndex]; }
 
   void addNewInstructionAfter(VirtualInstruction* newInstruction, VirtualInstruction& previous)
   {  newInstruction->setRegistrationIndex(m_instructions.size());
@@ -1157,6 +1375,7 @@ public:
   }
   void insertNewInstructionAfter(VirtualInstruction* newInstruction, VirtualInstruction& previous)
   {
+    invalidateControlFlow();
     newInstruction->setRegistrationIndex(m_instructions.size());
     m_instructions.push_back(newInstruction);
     VirtualInstruction* next = previous.getSNextInstruction();
@@ -1167,7 +1386,24 @@ public:
     }
   }
   void setDominationFrontier();
-  void insertPhiFunctions(const std::vector<LabelInstruction*>& labels);
+  // unlinks and deletes straight-line instructions, the remaining ones are
+  // registered again without holes
+  void removeInstructions(const std::vector<VirtualInstruction*>& instructions);
+  // unlinks a straight-line instruction and links it again after previous
+  void moveInstructionAfter(VirtualInstruction& instruction, VirtualInstruction& previous);
+  // the instructions registered from first on take the registration
+  // indexes just before next, the following ones being registered again
+  void registerBefore(int first, const VirtualInstruction& next);
+  // without liveness, a phi function is inserted for every variable of the
+  // label results (minimal form)
+  void insertPhiFunctions(PhiInsertionAgenda& agenda, const Liveness* liveness);
+  int countPhiCandidates() const { return m_phiCandidates; }
+  int countPhis() const { return m_phis; }
+  void addStatistic(const char* name, int count)
+  {  m_statistics.push_back(std::make_pair(name, count)); }
+  const std::vector<std::pair<const char*, int> >& statistics() const { return m_statistics; }
+  void addExecutedTasks(const WorkList& agenda) { m_executedTasks += agenda.countExecutedTasks(); }
+  int countExecutedTasks() const { return m_executedTasks; }
   void addFirstInstruction(VirtualInstruction* newInstruction)
   {  assert(m_instructions.empty());
     newInstruction->setRegistrationIndex(0);
@@ -1179,26 +1415,32 @@ public:
   }
   GotoInstruction& setFirst()
   {  assert(m_instructions.empty());
-    GotoInstruction* result = new GotoInstruction();
+    GotoInstruction* result = new (m_arena) GotoInstruction();
     result->setRegistrationIndex(m_instructions.size());
     m_instructions.push_back(result);
     return *result;
   }
   GotoInstruction& setThen(IfInstruction& ifInstruction)
-  {  GotoInstruction* thenPoint = new GotoInstruction();
+  {  GotoInstruction* thenPoint = new (m_arena) GotoInstruction();
     thenPoint->setRegistrationIndex(m_instructions.size());
     m_instructions.push_back(thenPoint);
     ifInstruction.connectToThen(*thenPoint);
     return *thenPoint;
   }
   GotoInstruction& setElse(IfInstruction& ifInstruction)
-  {  GotoInstruction* elsePoint = new GotoInstruction();
+  {  GotoInstruction* elsePoint = new (m_arena) GotoInstruction();
     elsePoint->setRegistrationIndex(m_instructions.size());
     m_instructions.push_back(elsePoint);
     ifInstruction.connectToElse(*elsePoint);
     return *elsePoint;
   }
   const VirtualType& getTypeGlobal(int uIndex) { return m_globalScope->getType(uIndex); }
+  Arena& arena() { return m_arena; }
+  const Arena& arena() const { return m_arena; }
+  int countInstructions() const { return m_instructions.size(); }
+  // basic blocks, built on demand and dropped when an instruction is inserted
+  ControlFlowGraph& controlFlow();
+  void invalidateControlFlow();
   const Scope& globalScope() const { assert(m_globalScope); return *m_globalScope; }
 };
 
@@ -1222,14 +1464,44 @@ FunctionCallExpression::newType(Function* callerFunction) const
 /* Définition des programmes */
 /*****************************/
 
-int getTokenIdentifier(const char* szText);
 class Program {
+public:
+  // DEWorkList follows the instructions with DominationAgenda and
+  // Function::setDominationFrontier, DEBlocks works on the basic blocks of
+  // the ControlFlowGraph. The engine only builds the SSA form: the
+  // optimizations always recompute the dominators on the blocks.
+  enum DominatorEngine { DEWorkList, DEBlocks };
+  // PPMinimal inserts a phi function at every join of the iterated
+  // domination frontiers, PPSemiPruned only for the variables read in a
+  // block before being assigned there, PPPruned only where they are live.
+  enum PhiPlacement { PPMinimal, PPSemiPruned, PPPruned };
+  // OInline expands the calls before the SSA construction, the other
+  // passes run on the SSA form, in this order
+  enum Optimization { OConstantPropagation = 1, OValueNumbering = 2, OLoopInvariants = 4,
+    OInductionVariables = 8, ODeadCode = 16, OInline = 32,
+    OAll = OConstantPropagation | OValueNumbering | OLoopInvariants | OInductionVariables | ODeadCode
+      | OInline };
+
 private:
+  // the nodes built while parsing outlive the functions referencing them
+  Arena m_arena;
   std::set<Function> m_functions;
+  AtomMap<Function*> m_functionsByName;
   Scope m_globalScope;
+  DominatorEngine m_dominatorEngine;
+  PhiPlacement m_phiPlacement;
+  int m_optimizations;
+  // registers given to the SSA variables by the backend, -1 for all
+  int m_registers;
+  // size of the callees expanded out of the loops, -1 for the default one
+  int m_inlineThreshold;
+  // measures of the phases, NULL when they are not reported
+  PhaseProfiler* m_profiler;
 
 public:
-  Program() {}
+  Program()
+  :  m_dominatorEngine(DEBlocks), m_phiPlacement(PPPruned), m_optimizations(0), m_registers(-1),
+    m_inlineThreshold(-1), m_profiler(NULL) {}
 
   void print(std::ostream& out) const
   {  for (std::set<Function>::const_iterator functionIter = m_functions.begin();
@@ -1241,9 +1513,55 @@ public:
   void computeDominationFrontiers();
   void insertPhiFunctions();
   void renameSSA();
+  void computeSSA(int threads);
+  void setDominatorEngine(DominatorEngine engine) { m_dominatorEngine = engine; }
+  void setPhiPlacement(PhiPlacement placement) { m_phiPlacement = placement; }
+  void addOptimizations(int optimizations) { m_optimizations |= optimizations; }
+  int getOptimizations() const { return m_optimizations; }
+  void setInlineThreshold(int threshold) { m_inlineThreshold = threshold; }
+  void setProfiler(PhaseProfiler* profiler) { m_profiler = profiler; }
+  PhaseProfiler* getSProfiler() const { return m_profiler; }
+  // the options of source, not its functions: the translation units of a
+  // batch are compiled in the same way
+  void copyOptions(const Program& source)
+  {  m_dominatorEngine = source.m_dominatorEngine;
+    m_phiPlacement = source.m_phiPlacement;
+    m_optimizations = source.m_optimizations;
+    m_registers = source.m_registers;
+    m_inlineThreshold = source.m_inlineThreshold;
+    m_profiler = source.m_profiler;
+  }
+  // expands the calls, the callees before their callers
+  void inlineCalls();
+  void optimize();
+  void printStatistics(std::ostream& out) const;
+  void benchDominators(std::ostream& out) const;
+  void printPhiStatistics(std::ostream& out) const;
+  void setRegisters(int registers) { m_registers = registers; }
+  // x86-64 assembly in the AT&T syntax of the GNU assembler
+  void generateAssembly(std::ostream& out) const;
+  // compiles the functions to bytecode, printed if required, and
+  // interprets main repeats times; the result is the one of main
+  int runBytecode(const char* programName, int repeats, bool printBytecode, std::ostream& report) const;
+
+  static void computeDominators(Function& function, DominatorEngine engine);
+  static void computeDominationFrontiers(Function& function, DominatorEngine engine);
+  static void insertPhiFunctions(Function& function, PhiPlacement placement);
+  static void renameSSA(Function& function);
+  static void computeSSA(Function& function, DominatorEngine engine, PhiPlacement placement,
+      PhaseProfiler* profiler=NULL);
+  // the passes leave the dominators of the blocks in the instructions,
+  // DominationAgenda cannot resume from the ones already in the labels
+  static void propagateConstants(Function& function);
+  static void numberValues(Function& function);
+  static void hoistLoopInvariants(Function& function);
+  static void reduceInductionVariables(Function& function);
+  static void eliminateDeadCode(Function& function);
+  static void optimize(Function& function, int optimizations, PhaseProfiler* profiler=NULL);
+  // State of the parse of a file. Each parse has its own context, given to
+  // the parser and to its scanner, so several files can be parsed at once.
   class ParseContext {
   private:
-    friend int getTokenIdentifier(const char* szText);
     class ParseState {
     private:
       enum Type { TUndefined, TIfThen, TIfElse, TDo, TWhile, TFor, TBlock };
@@ -1323,6 +1641,11 @@ public:
       m_states.clear(); m_scope = Scope();
     }
     Scope& scope() { return m_scope; }
+    Function* getSFunction() const { return m_function; }
+    Arena& arena()
+    {  assert(m_currentProgram);
+      return m_function ? m_function->arena() : m_currentProgram->m_arena;
+    }
     void addNewReturnInstruction(ReturnInstruction* returnInstruction)
     {  assert(m_function && m_current);
       m_function->addNewInstructionAfter(returnInstruction, *m_current);
@@ -1334,13 +1657,13 @@ public:
       m_current = instruction;
     }
     void addDeclarationStatement(VirtualType* type, const std::string& name)
-    {  m_scope.addDeclaration(name, type); }
+    {  m_scope.addDeclaration(Atoms::intern(name), type); }
     VirtualInstruction& getLastInstruction() const { assert(m_current); return *m_current; }
     void pushDoLoop()
-    {  GotoInstruction* gotoPoint = new GotoInstruction();
+    {  GotoInstruction* gotoPoint = new (m_function->arena()) GotoInstruction();
       m_function->addNewInstructionAfter(gotoPoint, *m_current);
       gotoPoint->setBeforeLabel();
-      LabelInstruction* label = new LabelInstruction();
+      LabelInstruction* label = new (m_function->arena()) LabelInstruction();
       m_function->addNewInstructionAfter(label, *gotoPoint);
       m_states.push_back(ParseState());
       m_current = &m_states.back().setDoLoop(*label);
@@ -1349,22 +1672,22 @@ public:
     {  assert(m_current == &last);
       LabelInstruction& label = m_states.back().getLoopReference();
       m_states.pop_back();
-      IfInstruction* condition = new IfInstruction();
+      IfInstruction* condition = new (m_function->arena()) IfInstruction();
       m_function->addNewInstructionAfter(condition, *m_current);
       condition->setExpression(expression);
       GotoInstruction& thenPoint = m_function->setThen(*condition);
-      GotoInstruction* loopPoint = new GotoInstruction();
+      GotoInstruction* loopPoint = new (m_function->arena()) GotoInstruction();
       m_function->addNewInstructionAfter(loopPoint, thenPoint);
       loopPoint->setLoop();
       loopPoint->connectToLabel(label);
       return *(m_current = &m_function->setElse(*condition));
     }
     void pushWhileLoop(VirtualExpression* expression)
-    {  LabelInstruction* label = new LabelInstruction();
+    {  LabelInstruction* label = new (m_function->arena()) LabelInstruction();
       m_function->addNewInstructionAfter(label, *m_current);
       m_states.push_back(ParseState());
       m_current = &m_states.back().setWhileLoop(*label);
-      IfInstruction* condition = new IfInstruction();
+      IfInstruction* condition = new (m_function->arena()) IfInstruction();
       m_function->addNewInstructionAfter(condition, *m_current);
       condition->setExpression(expression);
       m_current = &m_function->setThen(*condition);
@@ -1372,7 +1695,7 @@ public:
     VirtualInstruction& closeWhileLoop(VirtualInstruction& last)
     {  assert(m_current == &last);
       LabelInstruction& label = m_states.back().getLoopReference();
-      GotoInstruction* loopPoint = new GotoInstruction();
+      GotoInstruction* loopPoint = new (m_function->arena()) GotoInstruction();
       m_function->addNewInstructionAfter(loopPoint, last);
       loopPoint->setLoop();
       loopPoint->connectToLabel(label);
@@ -1382,7 +1705,7 @@ public:
       return *(m_current = &m_function->setElse(condition));
     }
     void pushIfThen(VirtualExpression* expression)
-    {  IfInstruction* condition = new IfInstruction();
+    {  IfInstruction* condition = new (m_function->arena()) IfInstruction();
       m_function->addNewInstructionAfter(condition, *m_current);
       condition->setExpression(expression);
       m_states.push_back(ParseState());
@@ -1394,13 +1717,13 @@ public:
     }
     VirtualInstruction& closeIfThen(VirtualInstruction& last)
     {  assert(m_current == &last);
-      GotoInstruction* thenLabel = new GotoInstruction();
+      GotoInstruction* thenLabel = new (m_function->arena()) GotoInstruction();
       m_function->addNewInstructionAfter(thenLabel, *m_current);
       thenLabel->setBeforeLabel();
-      LabelInstruction* label = new LabelInstruction();
+      LabelInstruction* label = new (m_function->arena()) LabelInstruction();
       m_function->addNewInstructionAfter(label, *thenLabel);
       GotoInstruction& giElse = m_function->setElse(m_states.back().getCondition());
-      GotoInstruction* connectToLabel = new GotoInstruction();
+      GotoInstruction* connectToLabel = new (m_function->arena()) GotoInstruction();
       m_function->addNewInstructionAfter(connectToLabel, giElse);
       connectToLabel->setBeforeLabel();
       connectToLabel->connectToLabel(*label);
@@ -1410,12 +1733,12 @@ public:
     }
     VirtualInstruction& closeIfElse(VirtualInstruction& lastThen, VirtualInstruction& lastElse)
     {  assert(m_current == &lastElse && &m_states.back().getEndThen() == &lastThen);
-      GotoInstruction* elseLabel = new GotoInstruction();
+      GotoInstruction* elseLabel = new (m_function->arena()) GotoInstruction();
       m_function->addNewInstructionAfter(elseLabel, lastElse);
       elseLabel->setBeforeLabel();
-      LabelInstruction* label = new LabelInstruction();
+      LabelInstruction* label = new (m_function->arena()) LabelInstruction();
       m_function->addNewInstructionAfter(label, *elseLabel);
-      GotoInstruction* connectToLabel = new GotoInstruction();
+      GotoInstruction* connectToLabel = new (m_function->arena()) GotoInstruction();
       m_function->addNewInstructionAfter(connectToLabel, lastThen);
       connectToLabel->setBeforeLabel();
       connectToLabel->connectToLabel(*label);
@@ -1424,7 +1747,7 @@ public:
       return *label;
     }
     void pushBlock()
-    {  EnterBlockInstruction* block = new EnterBlockInstruction();
+    {  EnterBlockInstruction* block = new (m_function->arena()) EnterBlockInstruction();
       m_function->addNewInstructionAfter(block, *m_current);
       m_scope.push();
       block->setScope(m_scope);
@@ -1435,7 +1758,8 @@ public:
     {  assert(m_current == &last);
       EnterBlockInstruction& enter = m_states.back().getBlock();
       m_states.pop_back();
-      ExitBlockInstruction* pebiExit = new ExitBlockInstruction();
+      m_scope.pop();
+      ExitBlockInstruction* pebiExit = new (m_function->arena()) ExitBlockInstruction();
       pebiExit->setScope(enter.scope());
       m_function->addNewInstructionAfter(pebiExit, last);
       m_current = pebiExit;
@@ -1443,14 +1767,23 @@ public:
     }
     Function& addFunction(const std::string& functionName)
     {  assert(m_currentProgram);
-      return const_cast<Function&>(*(m_currentProgram->m_functions.insert(
+      Function& result = const_cast<Function&>(*(m_currentProgram->m_functions.insert(
         Function(functionName, m_currentProgram->m_globalScope)).first));
+      m_currentProgram->m_functionsByName.insert(Atoms::intern(functionName), &result);
+      return result;
+      }
+      Function* findFunction(Atom name) const
+      {  assert(m_currentProgram);
+        Function* const* result = m_currentProgram->m_functionsByName.find(name);
+        return result ? *result : NULL;
       }
-      void pushFunction(const std::string& functionName)
+      void pushFunction(const std::string& functionName, VirtualType* resultType)
       {  assert(m_currentProgram && !m_current);
-        m_function = &const_cast<Function&>(*(m_currentProgram->m_functions.find(Function(functionName, m_currentProgram->m_globalScope))));
+        m_function = findFunction(Atoms::intern(functionName));
+        assert(m_function);
+        m_function->signature().setResult(resultType);
         m_scope = m_currentProgram->m_globalScope;
-        EnterBlockInstruction* block = new EnterBlockInstruction();
+        EnterBlockInstruction* block = new (m_function->arena()) EnterBlockInstruction();
         m_function->addFirstInstruction(block);
         m_scope.push();
         block->setScope(m_scope);
@@ -1461,25 +1794,27 @@ public:
       {  assert(m_currentProgram && m_function);
         EnterBlockInstruction& enter = m_states.back().getBlock();
         m_states.pop_back();
-        ExitBlockInstruction* pebiExit = new ExitBlockInstruction();
+        ExitBlockInstruction* pebiExit = new (m_function->arena()) ExitBlockInstruction();
         pebiExit->setScope(enter.scope());
         m_function->addNewInstruction(pebiExit);
         m_function = NULL;
         m_scope = m_currentProgram->m_globalScope;
         m_current = NULL;
       }
-      void setEmptyFunction(const std::string& functionName)
+      void setEmptyFunction(const std::string& functionName, VirtualType* resultType)
       {  assert(m_currentProgram && !m_current);
-        m_function = &const_cast<Function&>(*(m_currentProgram->m_functions.find(Function(functionName, m_currentProgram->m_globalScope))));
-        EnterBlockInstruction* block = new EnterBlockInstruction();
+        m_function = findFunction(Atoms::intern(functionName));
+        assert(m_function);
+        m_function->signature().setResult(resultType);
+        EnterBlockInstruction* block = new (m_function->arena()) EnterBlockInstruction();
         m_function->addFirstInstruction(block);
-        ExitBlockInstruction* pebiExit = new ExitBlockInstruction();
+        ExitBlockInstruction* pebiExit = new (m_function->arena()) ExitBlockInstruction();
         m_function->addNewInstruction(pebiExit);
         m_function = NULL;
       }
       void addGlobalDeclarationStatement(VirtualType* type, const std::string& name)
       {  assert(m_currentProgram);
-        m_currentProgram->m_globalScope.addDeclaration(name, type);
+        m_currentProgram->m_globalScope.addDeclaration(Atoms::intern(name), type);
       }
       const std::set<Function>& functions() const { return m_currentProgram->m_functions; }
     };
@@ -0,0 +1,72 @@
+#ifndef ValueNumberingH
+#define ValueNumberingH
+
+#include "DefUse.h"
+
+/************************************/
+/* Numérotation globale des valeurs */
+/************************************/
+
+// Global value numbering on a function in SSA form. The int variables, the
+// constants and the parameters never assigned get a number, and an
+// arithmetic or a comparison on numbered operands is hash-consed in
+// m_numbers on its operator and the numbers of its operands, so two
+// computations of the same value share the same number whatever the names
+// they read. The commutative operators and the mirrored comparisons have
+// their operands ordered first.
+//
+// The blocks are visited in the preorder of the dominator tree: the first
+// variable assigned to a number becomes its leader in the subtree of its
+// block, and a later computation of this number is replaced by the leader.
+// The leaders are restored when the walk leaves a subtree. A phi function,
+// a call, a memory access or a global gets a fresh number.
+class ValueNumbering {
+public:
+  class Key {
+  public:
+    int type;
+    int operatorCode;
+    int fst;
+    int snd;
+
+    Key(int typeSource, int operatorSource, int fstSource, int sndSource)
+    :  type(typeSource), operatorCode(operatorSource), fst(fstSource), snd(sndSource) {}
+    bool operator<(const Key& source) const
+    {  return (type != source.type) ? (type < source.type)
+        : ((operatorCode != source.operatorCode) ? (operatorCode < source.operatorCode)
+        : ((fst != source.fst) ? (fst < source.fst) : (snd < source.snd)));
+    }
+  };
+
+private:
+  Function& m_function;
+  ControlFlowGraph& m_graph;
+  DefUseChains m_chains;
+  std::map<Key, int> m_numbers;
+  int m_count;
+  // number of the SSA variables, -1 before their definition
+  std::vector<int> m_variableNumbers;
+  // left value of the definition of the SSA variables
+  std::vector<const LocalVariableExpression*> m_variables;
+  // variable holding each number in the current subtree, -1 if none
+  std::vector<int> m_leaders;
+  std::vector<std::pair<int, int> > m_oldLeaders;
+  int m_redundantExpressions;
+
+  int newNumber();
+  int findNumber(const Key& key);
+  void setLeader(int number, int variable);
+  int number(const VirtualExpression& expression);
+  VirtualExpression* replace(VirtualExpression& expression);
+  void replaceOperands(VirtualExpression& expression);
+  void visit(VirtualInstruction& instruction);
+  void visitBlock(int block);
+
+public:
+  ValueNumbering(Function& function);
+
+  void apply();
+  int countRedundantExpressions() const { return m_redundantExpressions; }
+};
+
+#endif // ValueNumberingH
@@ -1,9 +1,5 @@
 %{
 #include "SyntaxTree.h"
-int yylex (void);
-void yyerror (char const * szError) { std::cerr << szError << std::endl; }
-
-Program::ParseContext parseContext;
 
 enum TokenType
    {  TEOF, TType=258, TIf, TElse, TReturn, TDo, TWhile, TOpenParen, TCloseParen, TOpenBrace,
@@ -14,6 +10,12 @@ enum TokenType
 
 %}
 
+/* the context of the parse and its scanner are given to yyparse, so that
+   several files can be parsed at the same time */
+%define api.pure full
+%parse-param { Program::ParseContext& parseContext } { void* scanner }
+%lex-param { void* scanner }
+
 %union {
   std::string* identifier;
   VirtualType* type;
@@ -22,6 +24,12 @@ enum TokenType
   Function* function;
 }
 
+%code {
+int yylex (YYSTYPE* value, void* scanner);
+void yyerror (Program::ParseContext& parseContext, void* scanner, char const * szError)
+{  std::cerr << szError << std::endl; }
+}
+
 %token <identifier> IDENT 285
 %token <type> TYPE 258
 %token <type> STAR 272
@@ -85,12 +93,12 @@ declaration_seq :   declaration {}
 ;
 
 declaration :   TYPE declarator SEMICOLON { parseContext.addGlobalDeclarationStatement($1, *$2); delete $2; $2 = NULL; }
-              | TYPE declarator OPENBRACE CLOSEBRACE { parseContext.setEmptyFunction(*$2); delete $2; $2 = NULL; }
-              | TYPE declarator OPENBRACE { parseContext.pushFunction(*$2); delete $2; $2 = NULL; } statement_seq CLOSEBRACE { parseContext.popFunction(); }
+              | TYPE declarator OPENBRACE CLOSEBRACE { parseContext.setEmptyFunction(*$2, $1); delete $2; $2 = NULL; }
+              | TYPE declarator OPENBRACE { parseContext.pushFunction(*$2, $1); delete $2; $2 = NULL; } statement_seq CLOSEBRACE { parseContext.popFunction(); }
 ;
 
 declarator :   direct_declarator { $$ = $1; }
-             | STAR { $<type>0 = new PointerType($<type>0); $1 = $<type>0; } declarator { $$ = $3; }
+             | STAR { $<type>0 = new PointerType($<type>0); $<type>$ = $<type>0; } declarator { $$ = $3; $<type>0 = $<type>2; }
 ;
 
 direct_declarator :   IDENT { $$ = $1; }
@@ -111,50 +119,50 @@ parameter_declaration_list :   TYPE declarator { $$ = $<function>-1; $$->signatu
 ;
 
 statement_seq :   statement { $$ = $1; }
-                | statement statement_seq { $$ = $2; }
+                | statement_seq statement { $$ = $2; }
 ;
 
 statement :   SEMICOLON { $$ = &parseContext.getLastInstruction(); }
-            | expression SEMICOLON { $$ = &(new ExpressionInstruction())->setExpression($1); parseContext.addNewInstruction($$); }
+            | expression SEMICOLON { $$ = &(new (parseContext.arena()) ExpressionInstruction())->setExpression($1); parseContext.addNewInstruction($$); }
             | OPENBRACE CLOSEBRACE { $$ = &parseContext.getLastInstruction(); }
             | OPENBRACE { parseContext.pushBlock(); } statement_seq CLOSEBRACE { $$ = &parseContext.closeBlock(*$3); }
             | IF OPENPAREN expression CLOSEPAREN { parseContext.pushIfThen($3); } end_if_statement { $$ = $6; }
             | WHILE OPENPAREN expression CLOSEPAREN { parseContext.pushWhileLoop($3); } statement { $$ = &parseContext.closeWhileLoop(*$6); }
             | DO { parseContext.pushDoLoop(); } statement WHILE OPENPAREN expression CLOSEPAREN SEMICOLON { $$ = &parseContext.closeDoLoop(*$3, $6); }
             | TYPE declarator SEMICOLON { parseContext.addDeclarationStatement($1, *$2); $$ = &parseContext.getLastInstruction(); delete $2; $2 = NULL; }
-            | RETURN expression SEMICOLON { $$ = &(new ReturnInstruction())->setResult($2); parseContext.addNewReturnInstruction((ReturnInstruction*) $$); }
+            | RETURN expression SEMICOLON { $$ = &(new (parseContext.arena()) ReturnInstruction())->setResult($2); parseContext.addNewReturnInstruction((ReturnInstruction*) $$); }
 ;
 
 end_if_statement :   statement ELSE { parseContext.setToIfElse(*$1); } statement { $$ = &parseContext.closeIfElse(*$1, *$4); }
                    | statement { $$ = &parseContext.closeIfThen(*$1); }
 
-expression :   pm_expression ASSIGN expression { $$ = &(new AssignExpression())->setLValue($1).setRValue($3); }
+expression :   pm_expression ASSIGN expression { $$ = &(new (parseContext.arena()) AssignExpression())->setLValue($1).setRValue($3); }
              | relational_expression { $$ = $1; }
 ;
 
 relational_expression :   additive_expression { $$ = $1; }
-                        | relational_expression LESS additive_expression { $$ = &(new ComparisonExpression())->setOperator(ComparisonExpression::OCompareLess).setFst($1).setSnd($3); }
-                        | relational_expression LESSOREQUAL additive_expression { $$ = &(new ComparisonExpression())->setOperator(ComparisonExpression::OCompareLessOrEqual).setFst($1).setSnd($3); }
-                        | relational_expression EQUAL additive_expression { $$ = &(new ComparisonExpression())->setOperator(ComparisonExpression::OCompareEqual).setFst($1).setSnd($3); }
-                        | relational_expression GREATEROREQUAL additive_expression { $$ = &(new ComparisonExpression())->setOperator(ComparisonExpression::OCompareGreaterOrEqual).setFst($1).setSnd($3); }
-                        | relational_expression GREATER additive_expression { $$ = &(new ComparisonExpression())->setOperator(ComparisonExpression::OCompareGreater).setFst($1).setSnd($3); }
+                        | relational_expression LESS additive_expression { $$ = &(new (parseContext.arena()) ComparisonExpression())->setOperator(ComparisonExpression::OCompareLess).setFst($1).setSnd($3); }
+                        | relational_expression LESSOREQUAL additive_expression { $$ = &(new (parseContext.arena()) ComparisonExpression())->setOperator(ComparisonExpression::OCompareLessOrEqual).setFst($1).setSnd($3); }
+                        | relational_expression EQUAL additive_expression { $$ = &(new (parseContext.arena()) ComparisonExpression())->setOperator(ComparisonExpression::OCompareEqual).setFst($1).setSnd($3); }
+                        | relational_expression GREATEROREQUAL additive_expression { $$ = &(new (parseContext.arena()) ComparisonExpression())->setOperator(ComparisonExpression::OCompareGreaterOrEqual).setFst($1).setSnd($3); }
+                        | relational_expression GREATER additive_expression { $$ = &(new (parseContext.arena()) ComparisonExpression())->setOperator(ComparisonExpression::OCompareGreater).setFst($1).setSnd($3); }
 ;
 
 additive_expression :   multiplicative_expression { $$ = $1; }
-                      | additive_expression PLUS multiplicative_expression { $$ = &(new BinaryOperatorExpression())->setOperator(BinaryOperatorExpression::OPlus).setFst($1).setSnd($3); }
-                      | additive_expression MINUS multiplicative_expression { $$ = &(new BinaryOperatorExpression())->setOperator(BinaryOperatorExpression::OMinus).setFst($1).setSnd($3); }
+                      | additive_expression PLUS multiplicative_expression { $$ = &(new (parseContext.arena()) BinaryOperatorExpression())->setOperator(BinaryOperatorExpression::OPlus).setFst($1).setSnd($3); }
+                      | additive_expression MINUS multiplicative_expression { $$ = &(new (parseContext.arena()) BinaryOperatorExpression())->setOperator(BinaryOperatorExpression::OMinus).setFst($1).setSnd($3); }
 ;
 
 multiplicative_expression :   pm_expression { $$ = $1; }
-                            | multiplicative_expression STAR pm_expression { $$ = &(new BinaryOperatorExpression())->setOperator(BinaryOperatorExpression::OTimes).setFst($1).setSnd($3); }
-                            | multiplicative_expression DIVIDE pm_expression { $$ = &(new BinaryOperatorExpression())->setOperator(BinaryOperatorExpression::ODivide).setFst($1).setSnd($3); }
+                            | multiplicative_expression STAR pm_expression { $$ = &(new (parseContext.arena()) BinaryOperatorExpression())->setOperator(BinaryOperatorExpression::OTimes).setFst($1).setSnd($3); }
+                            | multiplicative_expression DIVIDE pm_expression { $$ = &(new (parseContext.arena()) BinaryOperatorExpression())->setOperator(BinaryOperatorExpression::ODivide).setFst($1).setSnd($3); }
 ;
 
 pm_expression :   postfix_expression { $$ = $1; }
-                | STAR pm_expression { $$ = &(new DereferenceExpression())->setSubExpression($2); }
-                | AND pm_expression { $$ = &(new ReferenceExpression())->setSubExpression($2); }
+                | STAR pm_expression { $$ = &(new (parseContext.arena()) DereferenceExpression())->setSubExpression($2); }
+                | AND pm_expression { $$ = &(new (parseContext.arena()) ReferenceExpression())->setSubExpression($2); }
                 | PLUS pm_expression { $$ = $2; }
-                | MINUS pm_expression { $$ = &(new UnaryOperatorExpression())->setOperator(UnaryOperatorExpression::OMinus).setSubExpression($2); }
+                | MINUS pm_expression { $$ = &(new (parseContext.arena()) UnaryOperatorExpression())->setOperator(UnaryOperatorExpression::OMinus).setSubExpression($2); }
 ;
 
 postfix_expression :   primary_expression { $$ = $1; }
@@ -89,12 +89,12 @@ bool PhiInsertionTask::IsBefore::operator()(VirtualExpression* fst, VirtualExpre
 
 void LabelPhiFrontierAgenda::propagate(const LabelInstruction& label)
 {
-  assert(label.mark);
-  LabelResult& result = *(LabelResult*) label.mark;
+  assert(m_results.findLabelResult(label));
+  LabelResult& result = *m_results.findLabelResult(label);
   for (std::vector<GotoInstruction*>::const_iterator frontierIter = label.getDominationFrontier().begin(); frontierIter != label.getDominationFrontier().end(); ++frontierIter)
   {
     std::set<VirtualExpression*, IsBefore> modified;
-    LabelResult& receiver = *(LabelResult*) (*frontierIter)->getSNextInstruction()->mark;
+    LabelResult& receiver = m_results.labelResult(*(*frontierIter)->getSNextInstruction());
     for (LabelResult::iterator exprIter = result.map().begin(); exprIter != result.map().end(); ++exprIter)
     {
       LocalVariableExpression afterScope = receiver.getAfterScopeLocalVariable();
@@ -103,30 +103,16 @@ void LabelPhiFrontierAgenda::propagate(const LabelInstruction& label)
         LabelResult::iterator found = receiver.map().find(exprIter->first);
         if (found == receiver.map().end())
         {
-          std::pair<VirtualExpression*, std::pair<GotoInstruction*, GotoInstruction*> > insert;
-          insert.first = exprIter->first;
-          insert.second.first = *frontierIter;
-          insert.second.second = NULL;
-          found = receiver.map().insert(found, insert);
+          found = receiver.map().insert(found, std::make_pair(exprIter->first, Origins()));
+          found->second.push_back(*frontierIter);
           if (modified.find(exprIter->first) == modified.end())
           {
             modified.insert(exprIter->first);
           }
         }
-        else if ((found->second.first != *frontierIter) && (found->second.second != *frontierIter))
+        else
         {
-          if (found->second.first == NULL)
-          {
-            found->second.first = *frontierIter;
-          }
-          else if (found->second.second == NULL)
-          {
-            found->second.second = *frontierIter;
-          }
-          else
-          {
-            assert(false);
-          }
+          found->second.addNew(*frontierIter);
         }
       }
     }
@@ -142,7 +128,7 @@ void LabelPhiFrontierAgenda::propagateOn(const LabelInstruction& label, const st
   for (std::vector<GotoInstruction*>::const_iterator frontierIter = label.getDominationFrontier().begin(); frontierIter != label.getDominationFrontier().end(); ++frontierIter)
   {
     std::set<VirtualExpression*, IsBefore> modified;
-    LabelResult& receiver = *(LabelResult*) (*frontierIter)->getSNextInstruction()->mark;
+    LabelResult& receiver = m_results.labelResult(*(*frontierIter)->getSNextInstruction());
     for (std::set<VirtualExpression*, IsBefore>::iterator exprIter = originModified.begin(); exprIter != originModified.end(); ++exprIter)
     {
       LocalVariableExpression afterScope = receiver.getAfterScopeLocalVariable();
@@ -151,30 +137,16 @@ void LabelPhiFrontierAgenda::propagateOn(const LabelInstruction& label, const st
         LabelResult::iterator found = receiver.map().find(*exprIter);
         if (found == receiver.map().end())
         {
-          std::pair<VirtualExpression*, std::pair<GotoInstruction*, GotoInstruction*> > insert;
-          insert.first = *exprIter;
-          insert.second.first = *frontierIter;
-          insert.second.second = NULL;
-          found = receiver.map().insert(found, insert);
+          found = receiver.map().insert(found, std::make_pair(*exprIter, Origins()));
+          found->second.push_back(*frontierIter);
           if (modified.find(*exprIter) == modified.end())
           {
             modified.insert(*exprIter);
           }
         }
-        else if ((found->second.first != *frontierIter) && (found->second.second != *frontierIter))
+        else
         {
-          if (found->second.first == NULL)
-          {
-            found->second.first = *frontierIter;
-          }
-          else if (found->second.second == NULL)
-          {
-            found->second.second = *frontierIter;
-          }
-          else
-          {
-            assert(false);
-          }
+          found->second.addNew(*frontierIter);
         }
       }
     }
@@ -184,53 +156,3 @@ void LabelPhiFrontierAgenda::propagateOn(const LabelInstruction& label, const st
     }
   }
 }
-
-Comparison RenamingTask::VariableRenaming::compare(const VariableRenaming& source) const
-{
-  assert(m_function == source.m_function);
-  if (m_toReplace->type() == source.m_toReplace->type())
-  {
-    if (m_toReplace->type() == VirtualExpression::TLocalVariable)
-    {
-      assert(dynamic_cast<const LocalVariableExpression*>(m_toReplace) && dynamic_cast<const LocalVariableExpression*>(source.m_toReplace));
-      int thisIndex = ((const LocalVariableExpression&) *m_toReplace).getFunctionIndex(*m_function), sourceIndex = ((const LocalVariableExpression&) *source.m_toReplace).getFunctionIndex(*m_function);
-      return (thisIndex < sourceIndex) ? CLess : ((thisIndex > sourceIndex) ? CGreater : CEqual);
-    }
-    if (m_toReplace->type() == VirtualExpression::TParameter)
-    {
-      assert(dynamic_cast<const ParameterExpression*>(m_toReplace) && dynamic_cast<const ParameterExpression*>(source.m_toReplace));
-      int thisIndex = ((const ParameterExpression&) *m_toReplace).getIndex(), sourceIndex = ((const ParameterExpression&) *source.m_toReplace).getIndex();
-      return (thisIndex < sourceIndex) ? CLess : ((thisIndex > sourceIndex) ? CGreater : CEqual);
-    }
-    assert(dynamic_cast<const GlobalVariableExpression*>(m_toReplace) && dynamic_cast<const GlobalVariableExpression*>(source.m_toReplace));
-    int thisIndex = ((const GlobalVariableExpression&) *m_toReplace).getIndex(), sourceIndex = ((const GlobalVariableExpression&) *source.m_toReplace).getIndex();
-    return (thisIndex < sourceIndex) ? CLess : ((thisIndex > sourceIndex) ? CGreater : CEqual);
-  }
-  return (m_toReplace->type() < source.m_toReplace->type()) ? CGreater : CLess;
-}
-
-bool RenamingTask::VariableRenaming::setDominator(VirtualInstruction& dominator, GotoInstruction* previousLabel)
-{
-  assert(m_lastDominator || !m_parent.get());
-  if (m_lastDominator && m_lastDominator->getDominationHeight() >= dominator.getDominationHeight())
-  {
-    if (m_newValue && m_lastDominator != previousLabel)
-    {
-      delete m_newValue;
-      m_newValue = NULL;
-    }
-    m_lastDominator = &dominator;
-    while (m_parent.get() && m_parent->m_lastDominator && m_parent->m_lastDominator->getDominationHeight() >= dominator.getDominationHeight())
-    {
-      m_parent = m_parent->m_parent;
-    }
-  }
-  else if (m_newValue)
-  {
-    std::shared_ptr<VariableRenaming> newParent(new VariableRenaming(*this, Transfert()));
-    newParent->m_parent = m_parent;
-    m_parent = newParent;
-  }
-  m_lastDominator = &dominator;
-  return m_newValue || m_parent.get();
-}
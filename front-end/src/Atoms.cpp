@@ -0,0 +1,109 @@
+#include "Atoms.h"
+#include <assert.h>
+#include <pthread.h>
+#include <string.h>
+
+namespace {
+
+// Interning pool: the spellings in atom order and an open addressing table
+// of their atoms. The spellings are stored in chunks that never move and the
+// chunk array is allocated once, so Atoms::name reads without the lock: a
+// thread only holds an atom returned by intern, after the spelling is written.
+class AtomPool {
+private:
+  enum { ChunkBits = 10, ChunkSize = 1 << ChunkBits, MaxChunks = 1 << 16 };
+  pthread_mutex_t m_lock;
+  std::string** m_chunks;
+  int m_count;
+  std::vector<unsigned> m_hashes;
+  std::vector<Atom> m_table;
+
+  static unsigned hash(const char* text, size_t length)
+  {  unsigned result = 2166136261U;
+    for (size_t index = 0; index < length; ++index)
+      result = (result ^ (unsigned char) text[index]) * 16777619U;
+    return result;
+  }
+  void grow()
+  {  std::vector<Atom> table(m_table.empty() ? 256 : 2*m_table.size(), -1);
+    size_t mask = table.size()-1;
+    for (size_t atom = 0; atom < m_hashes.size(); ++atom) {
+      size_t probe = m_hashes[atom] & mask;
+      while (table[probe] >= 0)
+        probe = (probe+1) & mask;
+      table[probe] = atom;
+    };
+    m_table.swap(table);
+  }
+
+public:
+  AtomPool() : m_chunks(new std::string*[MaxChunks]), m_count(0)
+  {  pthread_mutex_init(&m_lock, NULL);
+    intern("", 0);
+  }
+  ~AtomPool()
+  {  for (int chunk = 0; chunk*ChunkSize < m_count; ++chunk)
+      delete [] m_chunks[chunk];
+    delete [] m_chunks;
+    pthread_mutex_destroy(&m_lock);
+  }
+
+  Atom intern(const char* text, size_t length)
+  {  unsigned code = hash(text, length);
+    pthread_mutex_lock(&m_lock);
+    if (2*(m_count+1) > (int) m_table.size())
+      grow();
+    size_t mask = m_table.size()-1;
+    size_t probe = code & mask;
+    Atom result;
+    while ((result = m_table[probe]) >= 0) {
+      if (m_hashes[result] == code && name(result).size() == length
+          && memcmp(name(result).data(), text, length) == 0)
+        break;
+      probe = (probe+1) & mask;
+    };
+    if (result < 0) {
+      result = m_count;
+      assert(result < MaxChunks*ChunkSize);
+      if ((result & (ChunkSize-1)) == 0)
+        m_chunks[result >> ChunkBits] = new std::string[ChunkSize];
+      m_chunks[result >> ChunkBits][result & (ChunkSize-1)].assign(text, length);
+      m_hashes.push_back(code);
+      ++m_count;
+      m_table[probe] = result;
+    };
+    pthread_mutex_unlock(&m_lock);
+    return result;
+  }
+  const std::string& name(Atom atom) const
+  {  return m_chunks[atom >> ChunkBits][atom & (ChunkSize-1)]; }
+  int count()
+  {  pthread_mutex_lock(&m_lock);
+    int result = m_count;
+    pthread_mutex_unlock(&m_lock);
+    return result;
+  }
+};
+
+AtomPool& pool()
+{  static AtomPool result;
+  return result;
+}
+
+}
+
+Atom
+Atoms::intern(const char* text, size_t length)
+{  return pool().intern(text, length); }
+
+Atom
+Atoms::intern(const char* text)
+{  return pool().intern(text, strlen(text)); }
+
+const std::string&
+Atoms::name(Atom atom)
+{  return pool().name(atom); }
+
+int
+Atoms::count()
+{  return pool().count(); }
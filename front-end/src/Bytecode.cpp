@@ -0,0 +1,597 @@
+#include "Bytecode.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const char* OperationNames[] = { "move", "exchange", "add", "subtract", "multiply", "divide",
+  "negate", "not", "less", "lessOrEqual", "equal", "different", "greaterOrEqual", "greater",
+  "addPointer", "subtractPointer", "pointerDifference", "extendChar", "extendInt",
+  "loadChar", "loadInt", "load", "storeChar", "storeInt", "store", "loadLocalChar", "loadLocalInt",
+  "address", "jump", "jumpIfTrue", "jumpIfLess", "jumpIfLessOrEqual", "jumpIfEqual",
+  "jumpIfDifferent", "jumpIfGreaterOrEqual", "jumpIfGreater", "call", "callNative", "return" };
+
+const char* OperationFormats[] = { "rr", "rr", "rrr", "rrr", "rrr", "rrr",
+  "rr", "rr", "rrr", "rrr", "rrr", "rrr", "rrr", "rrr",
+  "rrri", "rrri", "rrri", "rr", "rr",
+  "rr", "rr", "rr", "rr", "rr", "rr", "rr", "rr",
+  "rr", "t", "rt", "rrt", "rrt", "rrt",
+  "rrt", "rrt", "rrt", "rfn", "rfn", "r" };
+
+// functions of the C library callable from the programs; the integer
+// arguments are passed as long, which the x86-64 convention allows
+struct NativeEntry {
+  const char* name;
+  Bytecode::Native native;
+};
+
+const NativeEntry Natives[] = {
+  { "printf", (Bytecode::Native) &printf },
+  { "putchar", (Bytecode::Native) &putchar },
+  { "puts", (Bytecode::Native) &puts },
+  { "abs", (Bytecode::Native) &abs },
+  { "atoi", (Bytecode::Native) &atoi },
+  { "malloc", (Bytecode::Native) &malloc },
+  { "free", (Bytecode::Native) &free },
+  { "exit", (Bytecode::Native) &exit },
+  { "strlen", (Bytecode::Native) &strlen }
+};
+const int NativesCount = sizeof(Natives)/sizeof(Natives[0]);
+
+Bytecode::Operation
+jumpOf(ComparisonExpression::Operator comparison) {
+  switch (comparison) {
+    case ComparisonExpression::OCompareLess: return Bytecode::OJumpIfLess;
+    case ComparisonExpression::OCompareLessOrEqual: return Bytecode::OJumpIfLessOrEqual;
+    case ComparisonExpression::OCompareEqual: return Bytecode::OJumpIfEqual;
+    case ComparisonExpression::OCompareDifferent: return Bytecode::OJumpIfDifferent;
+    case ComparisonExpression::OCompareGreaterOrEqual: return Bytecode::OJumpIfGreaterOrEqual;
+    case ComparisonExpression::OCompareGreater: return Bytecode::OJumpIfGreater;
+    default: assert(false); return Bytecode::OJump;
+  };
+}
+
+// the locations of a ParallelCopy are the registers
+std::string
+location(int reg) {
+  std::ostringstream out;
+  out << '%' << reg;
+  return out.str();
+}
+
+}
+
+const char*
+Bytecode::name(Operation operation) {
+  assert(operation >= 0 && operation < ONumberOfOperations);
+  return OperationNames[operation];
+}
+
+const char*
+Bytecode::format(Operation operation) {
+  assert(operation >= 0 && operation < ONumberOfOperations);
+  return OperationFormats[operation];
+}
+
+int
+Bytecode::size(const long* code) {
+  const char* operands = format((Operation) code[0]);
+  int result = 1 + strlen(operands);
+  if (operands[0] && operands[strlen(operands)-1] == 'n')
+    result += code[result-1];
+  return result;
+}
+
+void
+Bytecode::Procedure::print(std::ostream& out) const {
+  out << name << ": " << parameters << " parameters, " << frameSize << " registers\n";
+  for (std::vector<std::pair<int, long> >::const_iterator constantIter = constants.begin();
+      constantIter != constants.end(); ++constantIter)
+    out << "\tr" << constantIter->first << " = " << constantIter->second << '\n';
+  for (int index = 0; index < (int) code.size(); index += size(&code[index])) {
+    Operation operation = (Operation) code[index];
+    out << index << ":\t" << Bytecode::name(operation);
+    const char* operands = format(operation);
+    int operand = index+1;
+    for (int formatIndex = 0; operands[formatIndex]; ++formatIndex, ++operand) {
+      out << (formatIndex ? ", " : "\t");
+      switch (operands[formatIndex]) {
+        case 'r': out << 'r' << code[operand]; break;
+        case 'n':
+          out << code[operand];
+          for (int argument = 0; argument < code[operand]; ++argument)
+            out << ", r" << code[operand+1+argument];
+          break;
+        default: out << code[operand]; break;
+      };
+    };
+    out << '\n';
+  };
+}
+
+int
+Bytecode::findProcedure(const Function& function) {
+  std::map<const Function*, int>::const_iterator found = m_procedureIndexes.find(&function);
+  if (found != m_procedureIndexes.end())
+    return found->second;
+  int result = m_procedures.size();
+  m_procedures.push_back(Procedure());
+  m_procedures.back().name = function.getName();
+  m_procedureIndexes[&function] = result;
+  return result;
+}
+
+int
+Bytecode::findProcedure(const std::string& name) const {
+  for (int index = 0; index < (int) m_procedures.size(); ++index)
+    if (m_procedures[index].name == name)
+      return index;
+  return -1;
+}
+
+int
+Bytecode::findNative(const std::string& name) {
+  std::map<std::string, int>::const_iterator found = m_nativeIndexes.find(name);
+  if (found != m_nativeIndexes.end())
+    return found->second;
+  for (int index = 0; index < NativesCount; ++index)
+    if (name == Natives[index].name) {
+      m_nativeIndexes[name] = m_natives.size();
+      m_natives.push_back(Natives[index].native);
+      return m_natives.size()-1;
+    };
+  std::cerr << "unknown external function " << name << std::endl;
+  exit(1);
+}
+
+long*
+Bytecode::findGlobal(Atom name) {
+  std::map<Atom, long*>::const_iterator found = m_globals.find(name);
+  if (found != m_globals.end())
+    return found->second;
+  m_globalWords.push_back(0);
+  return m_globals[name] = &m_globalWords.back();
+}
+
+const char*
+Bytecode::addString(const std::string& quotedValue) {
+  std::string value;
+  for (std::string::size_type index = 1; index+1 < quotedValue.size(); ++index) {
+    char character = quotedValue[index];
+    if (character == '\\' && index+2 < quotedValue.size()) {
+      character = quotedValue[++index];
+      switch (character) {
+        case 'n': character = '\n'; break;
+        case 't': character = '\t'; break;
+        case 'r': character = '\r'; break;
+        case '0': character = '\0'; break;
+        default: break;
+      };
+    };
+    value += character;
+  };
+  m_strings.push_back(value);
+  return m_strings.back().c_str();
+}
+
+void
+Bytecode::compile(Function& function) {
+  int index = findProcedure(function);
+  if (CodeGenerator::isExternal(function)) {
+    std::cerr << "external function " << function.getName() << " has no bytecode" << std::endl;
+    exit(1);
+  };
+  ControlFlowGraph& graph = function.controlFlow();
+  std::vector<int> blocks;
+  for (int block = 0; block < graph.countBlocks(); ++block)
+    if (graph.isReachable(block))
+      blocks.push_back(block);
+  RegisterAllocation allocation(graph, blocks);
+  allocation.allocate(0);
+  // the compilation adds the procedures it calls
+  Procedure procedure;
+  procedure.name = function.getName();
+  BytecodeCompiler compiler(*this, function, graph, allocation, procedure);
+  compiler.compile(blocks);
+  m_procedures[index] = procedure;
+}
+
+void
+Bytecode::print(std::ostream& out) const {
+  for (std::vector<Procedure>::const_iterator procedureIter = m_procedures.begin();
+      procedureIter != m_procedures.end(); ++procedureIter)
+    if (!procedureIter->code.empty())
+      procedureIter->print(out);
+}
+
+BytecodeCompiler::BytecodeCompiler(Bytecode& bytecode, const Function& function, const ControlFlowGraph& graph,
+    const RegisterAllocation& allocation, Bytecode::Procedure& procedure)
+  :  m_bytecode(bytecode), m_function(function), m_graph(graph), m_allocation(allocation),
+    m_procedure(procedure), m_variables(allocation.chains().countVariables()) {
+  m_procedure.parameters = function.signature().size();
+  m_firstTemporary = m_temporary = m_maxTemporary = m_procedure.parameters + m_variables;
+}
+
+int
+BytecodeCompiler::registerOf(const VirtualExpression& variable) const {
+  if (variable.type() == VirtualExpression::TParameter) {
+    assert(dynamic_cast<const ParameterExpression*>(&variable));
+    return ((const ParameterExpression&) variable).getIndex();
+  };
+  // the variables of a coalesced class share their register
+  int variableClass = m_allocation.findClass(variable);
+  if (variableClass < 0)
+    variableClass = m_allocation.chains().findVariable(variable);
+  assert(variableClass >= 0);
+  return m_procedure.parameters + variableClass;
+}
+
+int
+BytecodeCompiler::constant(long value) {
+  std::map<long, int>::const_iterator found = m_constants.find(value);
+  if (found != m_constants.end())
+    return found->second;
+  int result = -1-(int) m_constants.size();
+  m_constants[value] = result;
+  return result;
+}
+
+int
+BytecodeCompiler::temporary() {
+  int result = m_temporary++;
+  if (m_temporary > m_maxTemporary)
+    m_maxTemporary = m_temporary;
+  return result;
+}
+
+int
+BytecodeCompiler::normalize(const ValueType& type, const ValueType& valueType, int value, int target) {
+  // a value is already extended from its own size
+  if (type.getSize() >= valueType.getSize() || (type.getSize() != 1 && type.getSize() != 4))
+    return value;
+  int result = destination(target);
+  emit((type.getSize() == 1) ? Bytecode::OExtendChar : Bytecode::OExtendInt, result, value);
+  return result;
+}
+
+int
+BytecodeCompiler::compileInto(const VirtualExpression& expression, int target) {
+  int result = compile(expression, target);
+  if (result != target)
+    emit(Bytecode::OMove, target, result);
+  return target;
+}
+
+int
+BytecodeCompiler::compileBinary(const BinaryOperatorExpression& binary, int target) {
+  ValueType fstType = typeOf(binary.getFst()), sndType = typeOf(binary.getSnd());
+  int fst = compile(binary.getFst()), snd = compile(binary.getSnd());
+  int result = destination(target);
+  BinaryOperatorExpression::Operator operatorCode = binary.getOperator();
+  if (fstType.isPointer() && sndType.isPointer()) {
+    assert(operatorCode == BinaryOperatorExpression::OMinus);
+    emit(Bytecode::OPointerDifference, result, fst, snd);
+    m_procedure.code.push_back(fstType.getPointedSize());
+  }
+  else if (fstType.isPointer() || sndType.isPointer()) {
+    // the integer operand is scaled by the size of the pointed values
+    assert(operatorCode == BinaryOperatorExpression::OPlus || operatorCode == BinaryOperatorExpression::OMinus);
+    if (!fstType.isPointer()) {
+      std::swap(fst, snd);
+      std::swap(fstType, sndType);
+    };
+    emit((operatorCode == BinaryOperatorExpression::OPlus) ? Bytecode::OAddPointer : Bytecode::OSubtractPointer,
+        result, fst, snd);
+    m_procedure.code.push_back(fstType.getPointedSize());
+  }
+  else {
+    Bytecode::Operation operation = Bytecode::OAdd;
+    switch (operatorCode) {
+      case BinaryOperatorExpression::OPlus: operation = Bytecode::OAdd; break;
+      case BinaryOperatorExpression::OMinus: operation = Bytecode::OSubtract; break;
+      case BinaryOperatorExpression::OTimes: operation = Bytecode::OMultiply; break;
+      case BinaryOperatorExpression::ODivide: operation = Bytecode::ODivide; break;
+      default: assert(false);
+    };
+    emit(operation, result, fst, snd);
+  };
+  return result;
+}
+
+int
+BytecodeCompiler::compileCall(const FunctionCallExpression& call, int target) {
+  const Function& function = call.getFunction();
+  bool isNative = CodeGenerator::isExternal(function);
+  // a procedure receives its parameters extended from their type
+  std::vector<int> arguments;
+  for (int index = 0; index < call.countArguments(); ++index) {
+    const VirtualExpression& argument = call.getArgument(index);
+    int value = compile(argument);
+    if (!isNative && index < function.signature().size())
+      value = normalize(ValueType(&function.signature().getTypeParameter(index)), typeOf(argument), value, -1);
+    arguments.push_back(value);
+  };
+  int result = destination(target);
+  if (isNative) {
+    if (call.countArguments() > Bytecode::MaxNativeArguments) {
+      std::cerr << "too many arguments for the external function " << function.getName() << std::endl;
+      exit(1);
+    };
+    emit(Bytecode::OCallNative, result, m_bytecode.findNative(function.getName()), arguments.size());
+  }
+  else
+    emit(Bytecode::OCall, result, m_bytecode.findProcedure(function), arguments.size());
+  m_procedure.code.insert(m_procedure.code.end(), arguments.begin(), arguments.end());
+  // the C library leaves the upper bits undefined
+  if (isNative)
+    normalize(ValueType(function.signature().getSResultType()), ValueType(8, 0), result, result);
+  return result;
+}
+
+int
+BytecodeCompiler::compileAssign(const AssignExpression& assign, int target) {
+  const VirtualExpression& lvalue = assign.getLValue();
+  ValueType type = typeOf(lvalue);
+  if (lvalue.type() == VirtualExpression::TLocalVariable || lvalue.type() == VirtualExpression::TParameter) {
+    int reg = registerOf(lvalue);
+    const VirtualExpression& rvalue = assign.getRValue();
+    int value = normalize(type, typeOf(rvalue), compile(rvalue, reg), reg);
+    if (value != reg)
+      emit(Bytecode::OMove, reg, value);
+    return reg;
+  };
+  int address;
+  if (lvalue.type() == VirtualExpression::TGlobalVariable) {
+    assert(dynamic_cast<const GlobalVariableExpression*>(&lvalue));
+    address = constant((long) m_bytecode.findGlobal(((const GlobalVariableExpression&) lvalue).getName()));
+  }
+  else {
+    assert(dynamic_cast<const DereferenceExpression*>(&lvalue));
+    address = compile(((const DereferenceExpression&) lvalue).getSubExpression());
+  };
+  int value = normalize(type, typeOf(assign.getRValue()), compile(assign.getRValue()), -1);
+  emit((type.getSize() == 8) ? Bytecode::OStore : ((type.getSize() == 1) ? Bytecode::OStoreChar : Bytecode::OStoreInt),
+      address, value);
+  if (target >= 0 && target != value)
+    emit(Bytecode::OMove, target, value);
+  return (target >= 0) ? target : value;
+}
+
+int
+BytecodeCompiler::compile(const VirtualExpression& expression, int target) {
+  switch (expression.type()) {
+    case VirtualExpression::TConstant:
+      assert(dynamic_cast<const ConstantExpression*>(&expression));
+      return constant(((const ConstantExpression&) expression).value());
+    case VirtualExpression::TChar:
+      assert(dynamic_cast<const CharExpression*>(&expression));
+      return constant(((const CharExpression&) expression).value());
+    case VirtualExpression::TString:
+      assert(dynamic_cast<const StringExpression*>(&expression));
+      return constant((long) m_bytecode.addString(((const StringExpression&) expression).getValue()));
+    case VirtualExpression::TLocalVariable:
+    case VirtualExpression::TParameter:
+      {  int reg = registerOf(expression);
+        ValueType type = typeOf(expression);
+        // a variable whose address is taken may be partly written
+        bool isExtended = (expression.type() == VirtualExpression::TLocalVariable)
+          ? (m_allocation.findClass(expression) >= 0)
+          : !m_allocation.chains().isAssignedParameter(((const ParameterExpression&) expression).getIndex());
+        if (isExtended || type.getSize() == 8)
+          return reg;
+        int result = destination(target);
+        emit((type.getSize() == 1) ? Bytecode::OLoadLocalChar : Bytecode::OLoadLocalInt, result, reg);
+        return result;
+      };
+    case VirtualExpression::TGlobalVariable:
+      {  assert(dynamic_cast<const GlobalVariableExpression*>(&expression));
+        ValueType type = typeOf(expression);
+        int address = constant((long) m_bytecode.findGlobal(((const GlobalVariableExpression&) expression).getName()));
+        int result = destination(target);
+        emit((type.getSize() == 8) ? Bytecode::OLoad : ((type.getSize() == 1) ? Bytecode::OLoadChar : Bytecode::OLoadInt),
+            result, address);
+        return result;
+      };
+    case VirtualExpression::TComparison:
+      {  assert(dynamic_cast<const ComparisonExpression*>(&expression));
+        const ComparisonExpression& comparison = (const ComparisonExpression&) expression;
+        int fst = compile(comparison.getFst()), snd = compile(comparison.getSnd());
+        int result = destination(target);
+        // the comparisons come in the order of the jumps
+        emit((Bytecode::Operation) (Bytecode::OLess + (jumpOf(comparison.getOperator()) - Bytecode::OJumpIfLess)),
+            result, fst, snd);
+        return result;
+      };
+    case VirtualExpression::TUnaryOperator:
+      {  assert(dynamic_cast<const UnaryOperatorExpression*>(&expression));
+        const UnaryOperatorExpression& unary = (const UnaryOperatorExpression&) expression;
+        int value = compile(unary.getSubExpression());
+        int result = destination(target);
+        emit((unary.getOperator() == UnaryOperatorExpression::ONeg) ? Bytecode::ONot : Bytecode::ONegate, result, value);
+        return result;
+      };
+    case VirtualExpression::TBinaryOperator:
+      assert(dynamic_cast<const BinaryOperatorExpression*>(&expression));
+      return compileBinary((const BinaryOperatorExpression&) expression, target);
+    case VirtualExpression::TDereference:
+      // ReferenceExpression shares the type of DereferenceExpression
+      if (dynamic_cast<const ReferenceExpression*>(&expression)) {
+        const VirtualExpression& lvalue = ((const ReferenceExpression&) expression).getSubExpression();
+        if (lvalue.type() == VirtualExpression::TGlobalVariable) {
+          assert(dynamic_cast<const GlobalVariableExpression*>(&lvalue));
+          return constant((long) m_bytecode.findGlobal(((const GlobalVariableExpression&) lvalue).getName()));
+        };
+        if (lvalue.type() == VirtualExpression::TDereference) {
+          assert(dynamic_cast<const DereferenceExpression*>(&lvalue));
+          return compile(((const DereferenceExpression&) lvalue).getSubExpression(), target);
+        };
+        int result = destination(target);
+        emit(Bytecode::OAddress, result, registerOf(lvalue));
+        return result;
+      }
+      else {
+        assert(dynamic_cast<const DereferenceExpression*>(&expression));
+        const VirtualExpression& pointer = ((const DereferenceExpression&) expression).getSubExpression();
+        int size = typeOf(pointer).pointed().getSize();
+        int address = compile(pointer);
+        int result = destination(target);
+        emit((size == 8) ? Bytecode::OLoad : ((size == 1) ? Bytecode::OLoadChar : Bytecode::OLoadInt), result, address);
+        return result;
+      };
+    case VirtualExpression::TCast:
+      {  assert(dynamic_cast<const CastExpression*>(&expression));
+        const CastExpression& cast = (const CastExpression&) expression;
+        return normalize(ValueType(&cast.getCastType()), typeOf(cast.getSubExpression()),
+            compile(cast.getSubExpression(), target), target);
+      };
+    case VirtualExpression::TFunctionCall:
+      assert(dynamic_cast<const FunctionCallExpression*>(&expression));
+      return compileCall((const FunctionCallExpression&) expression, target);
+    case VirtualExpression::TAssign:
+      assert(dynamic_cast<const AssignExpression*>(&expression));
+      return compileAssign((const AssignExpression&) expression, target);
+    default:
+      // the phi functions are copied on the edges
+      assert(false);
+      return constant(0);
+  };
+}
+
+void
+BytecodeCompiler::compileBranch(const VirtualExpression& condition, int target) {
+  if (condition.type() == VirtualExpression::TComparison) {
+    assert(dynamic_cast<const ComparisonExpression*>(&condition));
+    const ComparisonExpression& comparison = (const ComparisonExpression&) condition;
+    int fst = compile(comparison.getFst()), snd = compile(comparison.getSnd());
+    emit(jumpOf(comparison.getOperator()), fst, snd);
+  }
+  else
+    emit(Bytecode::OJumpIfTrue, compile(condition));
+  emitJump(target);
+}
+
+void
+BytecodeCompiler::compileEdge(const VirtualInstruction& last, int target) {
+  VirtualInstruction* label = &m_graph.first(target);
+  if (label->type() != VirtualInstruction::TLabel)
+    return;
+  // the edge is named by its goto, NULL when the label is reached by falling
+  const GotoInstruction* origin = NULL;
+  if (last.type() == VirtualInstruction::TGoto) {
+    assert(dynamic_cast<const GotoInstruction*>(&last));
+    origin = (const GotoInstruction*) &last;
+  };
+  ParallelCopy copy;
+  std::vector<std::pair<const VirtualExpression*, const VirtualExpression*> > copies;
+  for (VirtualInstruction* instruction = label->getSNextInstruction();
+      instruction && instruction->type() == VirtualInstruction::TExpression
+        && ((const ExpressionInstruction&) *instruction).isPhi();
+      instruction = instruction->getSNextInstruction()) {
+    const AssignExpression& assign = (const AssignExpression&) ((const ExpressionInstruction&) *instruction).getExpression();
+    assert(dynamic_cast<const PhiExpression*>(&assign.getRValue()));
+    const PhiExpression& phi = (const PhiExpression&) assign.getRValue();
+    int index = phi.findOrigin(origin);
+    if (index < 0)
+      continue;
+    // only the SSA variables are locations, the other operands are
+    // computed after the copies
+    const VirtualExpression& operand = phi.getOperand(index);
+    copy.add(location(registerOf(assign.getLValue())),
+        (m_allocation.findClass(operand) >= 0) ? location(registerOf(operand)) : std::string());
+    copies.push_back(std::make_pair(&assign.getLValue(), &operand));
+  };
+  if (copy.isEmpty())
+    return;
+  std::vector<ParallelCopy::Move> moves;
+  int saved = temporary();
+  copy.sequentialize(location(saved), moves);
+  for (std::vector<ParallelCopy::Move>::const_iterator moveIter = moves.begin(); moveIter != moves.end(); ++moveIter) {
+    int destination = atoi(moveIter->destination.c_str()+1);
+    if (moveIter->source.empty())
+      compileInto(*copies[moveIter->copy].second, destination);
+    else
+      emit(moveIter->isExchange ? Bytecode::OExchange : Bytecode::OMove, destination,
+          atoi(moveIter->source.c_str()+1));
+  };
+}
+
+void
+BytecodeCompiler::compileBlock(int block, int nextBlock) {
+  m_blockStarts[block] = m_procedure.code.size();
+  VirtualInstruction* last = &m_graph.last(block);
+  // the edges only copy the phi functions that follow their label, up to
+  // the first other instruction: no phi function may come after it
+  bool isPhiGroup = true;
+  for (VirtualInstruction* instruction = &m_graph.first(block); ;
+      instruction = instruction->getSNextInstruction()) {
+    m_temporary = m_firstTemporary;
+    if (instruction->type() == VirtualInstruction::TExpression) {
+      assert(dynamic_cast<const ExpressionInstruction*>(instruction));
+      const ExpressionInstruction& expressionInstruction = (const ExpressionInstruction&) *instruction;
+      if (!expressionInstruction.isPhi()) {
+        isPhiGroup = false;
+        compile(expressionInstruction.getExpression());
+      }
+      else
+        assert(isPhiGroup);
+    }
+    else if (instruction->type() == VirtualInstruction::TReturn) {
+      assert(dynamic_cast<const ReturnInstruction*>(instruction));
+      const VirtualExpression& result = ((const ReturnInstruction&) *instruction).getResult();
+      emit(Bytecode::OReturn, normalize(ValueType(m_function.signature().getSResultType()), typeOf(result),
+          compile(result), -1));
+    };
+    if (instruction == last)
+      break;
+  };
+
+  m_temporary = m_firstTemporary;
+  if (last->type() == VirtualInstruction::TReturn)
+    return;
+  int elseBlock = last->getSNextInstruction() ? m_graph.blockOf(*last->getSNextInstruction()) : -1;
+  if (last->type() == VirtualInstruction::TIf) {
+    assert(dynamic_cast<const IfInstruction*>(last));
+    const IfInstruction& condition = (const IfInstruction&) *last;
+    if (condition.getSThenInstruction())
+      compileBranch(condition.getExpression(), m_graph.blockOf(*condition.getSThenInstruction()));
+    else
+      compile(condition.getExpression());
+  }
+  else if (elseBlock >= 0)
+    compileEdge(*last, elseBlock);
+  if (elseBlock < 0)
+    emit(Bytecode::OReturn, constant(0));
+  else if (elseBlock != nextBlock) {
+    emit(Bytecode::OJump);
+    emitJump(elseBlock);
+  };
+}
+
+void
+BytecodeCompiler::compile(const std::vector<int>& layout) {
+  m_blockStarts.assign(m_graph.countBlocks(), -1);
+  for (int index = 0; index < (int) layout.size(); ++index)
+    compileBlock(layout[index], (index+1 < (int) layout.size()) ? layout[index+1] : -1);
+  for (std::vector<std::pair<int, int> >::const_iterator jumpIter = m_jumps.begin(); jumpIter != m_jumps.end(); ++jumpIter)
+    m_procedure.code[jumpIter->first] = m_blockStarts[jumpIter->second];
+
+  // the constants follow the temporaries
+  std::vector<long>& code = m_procedure.code;
+  for (int index = 0; index < (int) code.size(); index += Bytecode::size(&code[index])) {
+    const char* operands = Bytecode::format((Bytecode::Operation) code[index]);
+    int operand = index+1;
+    for (int formatIndex = 0; operands[formatIndex]; ++formatIndex, ++operand) {
+      if (operands[formatIndex] == 'r' && code[operand] < 0)
+        code[operand] = m_maxTemporary-1-code[operand];
+      else if (operands[formatIndex] == 'n')
+        for (int argument = operand+1; argument <= operand+code[operand]; ++argument)
+          if (code[argument] < 0)
+            code[argument] = m_maxTemporary-1-code[argument];
+    };
+  };
+  for (std::map<long, int>::const_iterator constantIter = m_constants.begin(); constantIter != m_constants.end(); ++constantIter)
+    m_procedure.constants.push_back(std::make_pair(m_maxTemporary-1-constantIter->second, constantIter->first));
+  m_procedure.frameSize = m_maxTemporary + m_constants.size();
+}
@@ -0,0 +1,603 @@
+#include "CodeGenerator.h"
+#include <algorithm>
+
+namespace {
+
+const char* ArgumentRegisters[] = { "%rdi", "%rsi", "%rdx", "%rcx", "%r8", "%r9" };
+const int ArgumentRegistersCount = 6;
+// preserved by the calls, %rbp keeps the frame
+const char* AllocatedRegisters[] = { "%rbx", "%r12", "%r13", "%r14", "%r15" };
+const int AllocatedRegistersCount = 5;
+// breaks the cycles of the phi copies
+const char* CopyRegister = "%r11";
+
+bool
+isRegister(const std::string& operand) {
+  return operand[0] == '%';
+}
+
+const char*
+conditionSuffix(ComparisonExpression::Operator comparison) {
+  switch (comparison) {
+    case ComparisonExpression::OCompareLess: return "l";
+    case ComparisonExpression::OCompareLessOrEqual: return "le";
+    case ComparisonExpression::OCompareEqual: return "e";
+    case ComparisonExpression::OCompareDifferent: return "ne";
+    case ComparisonExpression::OCompareGreaterOrEqual: return "ge";
+    case ComparisonExpression::OCompareGreater: return "g";
+    default: assert(false); return "";
+  };
+}
+
+}
+
+CodeGenerator::ValueType::ValueType(const VirtualType* type)
+  :  baseSize(0), indirections(0) {
+  while (type && dynamic_cast<const PointerType*>(type)) {
+    ++indirections;
+    type = ((const PointerType*) type)->getSSubType();
+  };
+  if (type) {
+    assert(dynamic_cast<const BaseType*>(type));
+    baseSize = type->getSize();
+  };
+}
+
+int
+CodeGenerator::countRegisters() {
+  return AllocatedRegistersCount;
+}
+
+bool
+CodeGenerator::isExternal(const Function& function) {
+  // the block of an empty body is not linked to its end
+  if (function.countInstructions() == 0)
+    return true;
+  const VirtualInstruction* next = function.getFirstInstruction().getSNextInstruction();
+  return !next || next->type() == VirtualInstruction::TExitBlock;
+}
+
+std::string
+CodeGenerator::blockLabel(int block) const {
+  std::ostringstream out;
+  out << ".L" << m_function->getName() << '_' << block;
+  return out.str();
+}
+
+std::string
+CodeGenerator::slot(const VirtualExpression& variable) {
+  std::ostringstream out;
+  if (variable.type() == VirtualExpression::TParameter) {
+    assert(dynamic_cast<const ParameterExpression*>(&variable));
+    int index = ((const ParameterExpression&) variable).getIndex();
+    // the first parameters are stored by the prologue, the others are
+    // above the return address
+    if (index < ArgumentRegistersCount)
+      out << -8*(index+1) << "(%rbp)";
+    else
+      out << 16+8*(index-ArgumentRegistersCount) << "(%rbp)";
+    return out.str();
+  };
+  if (variable.type() == VirtualExpression::TGlobalVariable) {
+    assert(dynamic_cast<const GlobalVariableExpression*>(&variable));
+    const GlobalVariableExpression& global = (const GlobalVariableExpression&) variable;
+    m_globals[global.getName()] = ValueType(&m_function->globalScope().getType(global.getIndex())).getSize();
+    out << Atoms::name(global.getName()) << "(%rip)";
+    return out.str();
+  };
+  assert(dynamic_cast<const LocalVariableExpression*>(&variable));
+  int reg = m_allocation->findRegister(variable);
+  if (reg >= 0)
+    return AllocatedRegisters[reg];
+  const LocalVariableExpression& local = (const LocalVariableExpression&) variable;
+  // the variables of a coalesced class share their slot
+  int variableClass = m_allocation->findClass(variable);
+  std::pair<const SymbolTable*, int> key = (variableClass >= 0)
+    ? std::make_pair((const SymbolTable*) NULL, variableClass)
+    : std::make_pair(&local.scope().symbolTable(), local.getLocalScope());
+  std::map<std::pair<const SymbolTable*, int>, int>::iterator found = m_slots.find(key);
+  if (found == m_slots.end()) {
+    int parameters = std::min(m_function->signature().size(), ArgumentRegistersCount);
+    found = m_slots.insert(std::make_pair(key, -8*(parameters+countSavedRegisters()+(int) m_slots.size()+1))).first;
+  };
+  out << found->second << "(%rbp)";
+  return out.str();
+}
+
+CodeGenerator::ValueType
+CodeGenerator::typeOf(const VirtualExpression& expression, const Function& function) {
+  switch (expression.type()) {
+    case VirtualExpression::TConstant:
+    case VirtualExpression::TComparison:
+      return ValueType(4, 0);
+    case VirtualExpression::TChar:
+      return ValueType(1, 0);
+    case VirtualExpression::TString:
+      return ValueType(1, 1);
+    case VirtualExpression::TLocalVariable:
+      assert(dynamic_cast<const LocalVariableExpression*>(&expression));
+      {  const LocalVariableExpression& local = (const LocalVariableExpression&) expression;
+        return ValueType(&local.scope().getType(local.getLocalScope()));
+      };
+    case VirtualExpression::TParameter:
+      assert(dynamic_cast<const ParameterExpression*>(&expression));
+      return ValueType(&function.signature().getTypeParameter(((const ParameterExpression&) expression).getIndex()));
+    case VirtualExpression::TGlobalVariable:
+      assert(dynamic_cast<const GlobalVariableExpression*>(&expression));
+      return ValueType(&function.globalScope().getType(((const GlobalVariableExpression&) expression).getIndex()));
+    case VirtualExpression::TUnaryOperator:
+      {  assert(dynamic_cast<const UnaryOperatorExpression*>(&expression));
+        const UnaryOperatorExpression& unary = (const UnaryOperatorExpression&) expression;
+        if (unary.getOperator() == UnaryOperatorExpression::ONeg)
+          return ValueType(4, 0);
+        ValueType result = typeOf(unary.getSubExpression(), function);
+        return result.isPointer() ? result : ValueType(4, 0);
+      };
+    case VirtualExpression::TBinaryOperator:
+      {  assert(dynamic_cast<const BinaryOperatorExpression*>(&expression));
+        const BinaryOperatorExpression& binary = (const BinaryOperatorExpression&) expression;
+        ValueType fst = typeOf(binary.getFst(), function), snd = typeOf(binary.getSnd(), function);
+        if (fst.isPointer() && snd.isPointer())
+          return ValueType(4, 0);
+        return fst.isPointer() ? fst : (snd.isPointer() ? snd : ValueType(4, 0));
+      };
+    case VirtualExpression::TDereference:
+      // ReferenceExpression shares the type of DereferenceExpression
+      if (dynamic_cast<const ReferenceExpression*>(&expression))
+        return typeOf(((const ReferenceExpression&) expression).getSubExpression(), function).address();
+      assert(dynamic_cast<const DereferenceExpression*>(&expression));
+      return typeOf(((const DereferenceExpression&) expression).getSubExpression(), function).pointed();
+    case VirtualExpression::TCast:
+      assert(dynamic_cast<const CastExpression*>(&expression));
+      return ValueType(&((const CastExpression&) expression).getCastType());
+    case VirtualExpression::TFunctionCall:
+      assert(dynamic_cast<const FunctionCallExpression*>(&expression));
+      return ValueType(((const FunctionCallExpression&) expression).getFunction().signature().getSResultType());
+    case VirtualExpression::TAssign:
+      assert(dynamic_cast<const AssignExpression*>(&expression));
+      return typeOf(((const AssignExpression&) expression).getLValue(), function);
+    default:
+      assert(false);
+      return ValueType();
+  };
+}
+
+void
+CodeGenerator::push() {
+  m_code << "\tpushq\t%rax\n";
+  ++m_depth;
+}
+
+void
+CodeGenerator::pop(const char* reg) {
+  m_code << "\tpopq\t" << reg << '\n';
+  --m_depth;
+}
+
+int
+CodeGenerator::countSavedRegisters() const {
+  return m_allocation->countUsedRegisters();
+}
+
+void
+CodeGenerator::load(const ValueType& type, const std::string& operand, const char* reg) {
+  // a register holds a value already extended
+  if (type.getSize() == 8 || isRegister(operand))
+    m_code << "\tmovq\t" << operand << ", " << reg << '\n';
+  else
+    m_code << ((type.getSize() == 1) ? "\tmovsbq\t" : "\tmovslq\t") << operand << ", " << reg << '\n';
+}
+
+void
+CodeGenerator::store(const ValueType& type, const std::string& operand) {
+  if (type.getSize() == 8 || isRegister(operand))
+    m_code << "\tmovq\t%rax, " << operand << '\n';
+  else if (type.getSize() == 1)
+    m_code << "\tmovb\t%al, " << operand << '\n';
+  else
+    m_code << "\tmovl\t%eax, " << operand << '\n';
+}
+
+void
+CodeGenerator::normalize(const ValueType& type, const ValueType& valueType) {
+  // a value is already extended from its own size
+  if (type.getSize() >= valueType.getSize())
+    return;
+  if (type.getSize() == 1)
+    m_code << "\tmovsbq\t%al, %rax\n";
+  else if (type.getSize() == 4)
+    m_code << "\tcltq\n";
+}
+
+CodeGenerator::ValueType
+CodeGenerator::generateOperands(const VirtualExpression& fst, const VirtualExpression& snd,
+    ValueType& sndType) {
+  // the first operand is left in %rax, the second one in %rcx
+  ValueType result;
+  if (snd.type() == VirtualExpression::TConstant || snd.type() == VirtualExpression::TChar) {
+    result = generate(fst);
+    sndType = typeOf(snd);
+    m_code << "\tmovq\t$" << ((snd.type() == VirtualExpression::TConstant)
+        ? ((const ConstantExpression&) snd).value() : (int) ((const CharExpression&) snd).value())
+      << ", %rcx\n";
+    return result;
+  };
+  if (snd.type() == VirtualExpression::TLocalVariable || snd.type() == VirtualExpression::TParameter
+      || snd.type() == VirtualExpression::TGlobalVariable) {
+    // a variable is read after the first operand
+    result = generate(fst);
+    sndType = typeOf(snd);
+    load(sndType, slot(snd), "%rcx");
+    return result;
+  };
+  result = generate(fst);
+  push();
+  sndType = generate(snd);
+  m_code << "\tmovq\t%rax, %rcx\n";
+  pop("%rax");
+  return result;
+}
+
+void
+CodeGenerator::generateAddress(const VirtualExpression& lvalue) {
+  if (lvalue.type() == VirtualExpression::TDereference) {
+    assert(dynamic_cast<const DereferenceExpression*>(&lvalue));
+    generate(((const DereferenceExpression&) lvalue).getSubExpression());
+  }
+  else
+    m_code << "\tleaq\t" << slot(lvalue) << ", %rax\n";
+}
+
+CodeGenerator::ValueType
+CodeGenerator::generateAssign(const AssignExpression& assign) {
+  const VirtualExpression& lvalue = assign.getLValue();
+  ValueType type = typeOf(lvalue);
+  if (lvalue.type() == VirtualExpression::TDereference) {
+    generateAddress(lvalue);
+    push();
+    ValueType valueType = generate(assign.getRValue());
+    pop("%rcx");
+    normalize(type, valueType);
+    store(type, "(%rcx)");
+  }
+  else {
+    normalize(type, generate(assign.getRValue()));
+    store(type, slot(lvalue));
+  };
+  return type;
+}
+
+CodeGenerator::ValueType
+CodeGenerator::generateCall(const FunctionCallExpression& call) {
+  int arguments = call.countArguments();
+  int stackArguments = std::max(arguments-ArgumentRegistersCount, 0);
+  // %rsp is aligned on 16 bytes at the call
+  bool hasPadding = ((m_depth + stackArguments) % 2) != 0;
+  if (hasPadding) {
+    m_code << "\tsubq\t$8, %rsp\n";
+    ++m_depth;
+  };
+  for (int index = arguments-1; index >= 0; --index) {
+    generate(call.getArgument(index));
+    push();
+  };
+  for (int index = 0; index < std::min(arguments, ArgumentRegistersCount); ++index)
+    pop(ArgumentRegisters[index]);
+  const Function& function = call.getFunction();
+  m_code << "\txorl\t%eax, %eax\n";
+  m_code << "\tcall\t" << function.getName() << (isExternal(function) ? "@PLT\n" : "\n");
+  int removed = stackArguments + (hasPadding ? 1 : 0);
+  if (removed > 0) {
+    m_code << "\taddq\t$" << 8*removed << ", %rsp\n";
+    m_depth -= removed;
+  };
+  // the callee leaves the upper bits of %rax undefined
+  ValueType result(function.signature().getSResultType());
+  normalize(result, ValueType(8, 0));
+  return result;
+}
+
+CodeGenerator::ValueType
+CodeGenerator::generateBinary(const BinaryOperatorExpression& binary) {
+  ValueType sndType;
+  ValueType fstType = generateOperands(binary.getFst(), binary.getSnd(), sndType);
+  BinaryOperatorExpression::Operator operatorCode = binary.getOperator();
+  if (fstType.isPointer() && sndType.isPointer()) {
+    assert(operatorCode == BinaryOperatorExpression::OMinus);
+    m_code << "\tsubq\t%rcx, %rax\n";
+    if (fstType.getPointedSize() > 1) {
+      m_code << "\tmovq\t$" << fstType.getPointedSize() << ", %rcx\n";
+      m_code << "\tcqto\n\tidivq\t%rcx\n";
+    };
+    return ValueType(4, 0);
+  };
+  if (fstType.isPointer() || sndType.isPointer()) {
+    // the integer operand is scaled by the size of the pointed values
+    const char* integer = fstType.isPointer() ? "%rcx" : "%rax";
+    ValueType result = fstType.isPointer() ? fstType : sndType;
+    if (result.getPointedSize() > 1)
+      m_code << "\timulq\t$" << result.getPointedSize() << ", " << integer << ", " << integer << '\n';
+    assert(operatorCode == BinaryOperatorExpression::OPlus || operatorCode == BinaryOperatorExpression::OMinus);
+    m_code << ((operatorCode == BinaryOperatorExpression::OPlus) ? "\taddq\t" : "\tsubq\t") << "%rcx, %rax\n";
+    return result;
+  };
+  switch (operatorCode) {
+    case BinaryOperatorExpression::OPlus:
+      m_code << "\taddl\t%ecx, %eax\n";
+      break;
+    case BinaryOperatorExpression::OMinus:
+      m_code << "\tsubl\t%ecx, %eax\n";
+      break;
+    case BinaryOperatorExpression::OTimes:
+      m_code << "\timull\t%ecx, %eax\n";
+      break;
+    case BinaryOperatorExpression::ODivide:
+      m_code << "\tcltd\n\tidivl\t%ecx\n";
+      break;
+    default:
+      assert(false);
+  };
+  m_code << "\tcltq\n";
+  return ValueType(4, 0);
+}
+
+CodeGenerator::ValueType
+CodeGenerator::generate(const VirtualExpression& expression) {
+  switch (expression.type()) {
+    case VirtualExpression::TConstant:
+      assert(dynamic_cast<const ConstantExpression*>(&expression));
+      m_code << "\tmovq\t$" << ((const ConstantExpression&) expression).value() << ", %rax\n";
+      return ValueType(4, 0);
+    case VirtualExpression::TChar:
+      assert(dynamic_cast<const CharExpression*>(&expression));
+      m_code << "\tmovq\t$" << (int) ((const CharExpression&) expression).value() << ", %rax\n";
+      return ValueType(1, 0);
+    case VirtualExpression::TString:
+      assert(dynamic_cast<const StringExpression*>(&expression));
+      m_code << "\tleaq\t.LS" << m_strings.size() << "(%rip), %rax\n";
+      m_strings.push_back(((const StringExpression&) expression).getValue());
+      return ValueType(1, 1);
+    case VirtualExpression::TLocalVariable:
+    case VirtualExpression::TParameter:
+    case VirtualExpression::TGlobalVariable:
+      {  ValueType result = typeOf(expression);
+        load(result, slot(expression));
+        return result;
+      };
+    case VirtualExpression::TComparison:
+      {  assert(dynamic_cast<const ComparisonExpression*>(&expression));
+        const ComparisonExpression& comparison = (const ComparisonExpression&) expression;
+        ValueType sndType;
+        generateOperands(comparison.getFst(), comparison.getSnd(), sndType);
+        m_code << "\tcmpq\t%rcx, %rax\n";
+        m_code << "\tset" << conditionSuffix(comparison.getOperator()) << "\t%al\n";
+        m_code << "\tmovzbl\t%al, %eax\n";
+        return ValueType(4, 0);
+      };
+    case VirtualExpression::TUnaryOperator:
+      {  assert(dynamic_cast<const UnaryOperatorExpression*>(&expression));
+        const UnaryOperatorExpression& unary = (const UnaryOperatorExpression&) expression;
+        generate(unary.getSubExpression());
+        if (unary.getOperator() == UnaryOperatorExpression::ONeg) {
+          m_code << "\tcmpq\t$0, %rax\n\tsete\t%al\n\tmovzbl\t%al, %eax\n";
+          return ValueType(4, 0);
+        };
+        m_code << "\tnegl\t%eax\n\tcltq\n";
+        return ValueType(4, 0);
+      };
+    case VirtualExpression::TBinaryOperator:
+      assert(dynamic_cast<const BinaryOperatorExpression*>(&expression));
+      return generateBinary((const BinaryOperatorExpression&) expression);
+    case VirtualExpression::TDereference:
+      // ReferenceExpression shares the type of DereferenceExpression
+      if (dynamic_cast<const ReferenceExpression*>(&expression)) {
+        const ReferenceExpression& reference = (const ReferenceExpression&) expression;
+        generateAddress(reference.getSubExpression());
+        return typeOf(reference.getSubExpression()).address();
+      }
+      else {
+        assert(dynamic_cast<const DereferenceExpression*>(&expression));
+        ValueType result = generate(((const DereferenceExpression&) expression).getSubExpression()).pointed();
+        load(result, "(%rax)");
+        return result;
+      };
+    case VirtualExpression::TCast:
+      {  assert(dynamic_cast<const CastExpression*>(&expression));
+        const CastExpression& cast = (const CastExpression&) expression;
+        ValueType result(&cast.getCastType());
+        normalize(result, generate(cast.getSubExpression()));
+        return result;
+      };
+    case VirtualExpression::TFunctionCall:
+      assert(dynamic_cast<const FunctionCallExpression*>(&expression));
+      return generateCall((const FunctionCallExpression&) expression);
+    case VirtualExpression::TAssign:
+      assert(dynamic_cast<const AssignExpression*>(&expression));
+      return generateAssign((const AssignExpression&) expression);
+    default:
+      // the phi functions are copied on the edges
+      assert(false);
+      return ValueType();
+  };
+}
+
+void
+CodeGenerator::generateBranch(const VirtualExpression& condition, int target) {
+  if (condition.type() == VirtualExpression::TComparison) {
+    assert(dynamic_cast<const ComparisonExpression*>(&condition));
+    const ComparisonExpression& comparison = (const ComparisonExpression&) condition;
+    ValueType sndType;
+    generateOperands(comparison.getFst(), comparison.getSnd(), sndType);
+    m_code << "\tcmpq\t%rcx, %rax\n";
+    m_code << "\tj" << conditionSuffix(comparison.getOperator()) << '\t' << blockLabel(target) << '\n';
+  }
+  else {
+    generate(condition);
+    m_code << "\ttestq\t%rax, %rax\n";
+    m_code << "\tjne\t" << blockLabel(target) << '\n';
+  };
+}
+
+void
+CodeGenerator::generateEdge(const VirtualInstruction& last, int target) {
+  VirtualInstruction* label = &m_graph->first(target);
+  if (label->type() != VirtualInstruction::TLabel)
+    return;
+  // the edge is named by its goto, NULL when the label is reached by falling
+  const GotoInstruction* origin = NULL;
+  if (last.type() == VirtualInstruction::TGoto) {
+    assert(dynamic_cast<const GotoInstruction*>(&last));
+    origin = (const GotoInstruction*) &last;
+  };
+  // copies of the phi functions, with their variable and operand
+  ParallelCopy copy;
+  std::vector<std::pair<const VirtualExpression*, const VirtualExpression*> > copies;
+  for (VirtualInstruction* instruction = label->getSNextInstruction();
+      instruction && instruction->type() == VirtualInstruction::TExpression
+        && ((const ExpressionInstruction&) *instruction).isPhi();
+      instruction = instruction->getSNextInstruction()) {
+    const AssignExpression& assign = (const AssignExpression&) ((const ExpressionInstruction&) *instruction).getExpression();
+    assert(dynamic_cast<const PhiExpression*>(&assign.getRValue()));
+    const PhiExpression& phi = (const PhiExpression&) assign.getRValue();
+    int index = phi.findOrigin(origin);
+    if (index < 0)
+      continue;
+    const VirtualExpression& operand = phi.getOperand(index);
+    copy.add(slot(assign.getLValue()), DefUseChains::isVariable(operand) ? slot(operand) : std::string());
+    copies.push_back(std::make_pair(&assign.getLValue(), &operand));
+  };
+  if (copy.isEmpty())
+    return;
+  std::vector<ParallelCopy::Move> moves;
+  copy.sequentialize(CopyRegister, moves);
+  for (std::vector<ParallelCopy::Move>::const_iterator moveIter = moves.begin(); moveIter != moves.end(); ++moveIter) {
+    ValueType type = typeOf(*copies[moveIter->copy].first);
+    if (moveIter->isExchange)
+      m_code << "\txchgq\t" << moveIter->source << ", " << moveIter->destination << '\n';
+    else if (moveIter->destination == CopyRegister)
+      load(type, moveIter->source, CopyRegister);
+    else {
+      // the operands other than variables are constants
+      if (moveIter->source.empty())
+        generate(*copies[moveIter->copy].second);
+      else
+        load(type, moveIter->source);
+      store(type, moveIter->destination);
+    };
+  };
+  m_phiMoves += moves.size();
+}
+
+void
+CodeGenerator::generateReturn() {
+  int parameters = std::min(m_function->signature().size(), ArgumentRegistersCount);
+  for (int reg = 0; reg < countSavedRegisters(); ++reg)
+    m_code << "\tmovq\t" << -8*(parameters+reg+1) << "(%rbp), " << AllocatedRegisters[reg] << '\n';
+  m_code << "\tleave\n\tret\n";
+}
+
+void
+CodeGenerator::generateBlock(int block, int nextBlock) {
+  m_code << blockLabel(block) << ":\n";
+  VirtualInstruction* last = &m_graph->last(block);
+  // the edges only copy the phi functions that follow their label, up to
+  // the first other instruction: no phi function may come after it
+  bool isPhiGroup = true;
+  for (VirtualInstruction* instruction = &m_graph->first(block); ;
+      instruction = instruction->getSNextInstruction()) {
+    if (instruction->type() == VirtualInstruction::TExpression) {
+      assert(dynamic_cast<const ExpressionInstruction*>(instruction));
+      const ExpressionInstruction& expressionInstruction = (const ExpressionInstruction&) *instruction;
+      if (!expressionInstruction.isPhi()) {
+        isPhiGroup = false;
+        generate(expressionInstruction.getExpression());
+      }
+      else
+        assert(isPhiGroup);
+    }
+    else if (instruction->type() == VirtualInstruction::TReturn) {
+      assert(dynamic_cast<const ReturnInstruction*>(instruction));
+      generate(((const ReturnInstruction&) *instruction).getResult());
+      generateReturn();
+    };
+    if (instruction == last)
+      break;
+  };
+
+  if (last->type() == VirtualInstruction::TReturn)
+    return;
+  int elseBlock = last->getSNextInstruction() ? m_graph->blockOf(*last->getSNextInstruction()) : -1;
+  if (last->type() == VirtualInstruction::TIf) {
+    assert(dynamic_cast<const IfInstruction*>(last));
+    const IfInstruction& condition = (const IfInstruction&) *last;
+    if (condition.getSThenInstruction())
+      generateBranch(condition.getExpression(), m_graph->blockOf(*condition.getSThenInstruction()));
+    else
+      generate(condition.getExpression());
+  }
+  else if (elseBlock >= 0)
+    generateEdge(*last, elseBlock);
+  if (elseBlock < 0) {
+    m_code << "\txorl\t%eax, %eax\n";
+    generateReturn();
+  }
+  else if (elseBlock != nextBlock)
+    m_code << "\tjmp\t" << blockLabel(elseBlock) << '\n';
+}
+
+void
+CodeGenerator::generate(Function& function) {
+  if (isExternal(function))
+    return;
+  m_function = &function;
+  ControlFlowGraph& graph = function.controlFlow();
+  m_graph = &graph;
+  m_code.str("");
+  m_slots.clear();
+  m_depth = 0;
+  m_phiMoves = 0;
+
+  std::vector<int> blocks;
+  for (int block = 0; block < m_graph->countBlocks(); ++block)
+    if (m_graph->isReachable(block))
+      blocks.push_back(block);
+  RegisterAllocation allocation(graph, blocks);
+  allocation.allocate(std::min(m_registers, AllocatedRegistersCount));
+  m_allocation = &allocation;
+  for (int index = 0; index < (int) blocks.size(); ++index)
+    generateBlock(blocks[index], (index+1 < (int) blocks.size()) ? blocks[index+1] : -1);
+  function.addStatistic("variables in registers", allocation.countAllocatedVariables());
+  function.addStatistic("spilled variables", allocation.countSpilledVariables());
+  function.addStatistic("phi copies coalesced", allocation.countCoalescedCopies());
+  function.addStatistic("phi moves", m_phiMoves);
+
+  int parameters = std::min(function.signature().size(), ArgumentRegistersCount);
+  int frameSize = 8*(parameters + countSavedRegisters() + (int) m_slots.size());
+  frameSize = (frameSize + 15) & ~15;
+  const std::string& name = function.getName();
+  m_out << "\t.text\n\t.globl\t" << name << "\n\t.type\t" << name << ", @function\n";
+  m_out << name << ":\n\tpushq\t%rbp\n\tmovq\t%rsp, %rbp\n";
+  if (frameSize > 0)
+    m_out << "\tsubq\t$" << frameSize << ", %rsp\n";
+  for (int index = 0; index < parameters; ++index)
+    m_out << "\tmovq\t" << ArgumentRegisters[index] << ", " << -8*(index+1) << "(%rbp)\n";
+  for (int reg = 0; reg < countSavedRegisters(); ++reg)
+    m_out << "\tmovq\t" << AllocatedRegisters[reg] << ", " << -8*(parameters+reg+1) << "(%rbp)\n";
+  m_out << m_code.str();
+  m_out << "\t.size\t" << name << ", .-" << name << '\n';
+  m_function = NULL;
+  m_graph = NULL;
+  m_allocation = NULL;
+}
+
+void
+CodeGenerator::generateData() {
+  if (!m_strings.empty()) {
+    m_out << "\t.section\t.rodata\n";
+    for (int index = 0; index < (int) m_strings.size(); ++index)
+      m_out << ".LS" << index << ":\n\t.string\t" << m_strings[index] << '\n';
+  };
+  for (std::map<Atom, int>::const_iterator globalIter = m_globals.begin(); globalIter != m_globals.end(); ++globalIter)
+    m_out << "\t.comm\t" << Atoms::name(globalIter->first) << ',' << globalIter->second << ',' << globalIter->second << '\n';
+  m_out << "\t.section\t.note.GNU-stack,\"\",@progbits\n";
+}
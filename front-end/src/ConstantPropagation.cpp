@@ -0,0 +1,407 @@
+#include "ConstantPropagation.h"
+#include <limits.h>
+
+ConstantPropagation::ConstantPropagation(Function& function)
+  :  m_function(function), m_graph(function.controlFlow()), m_chains(m_graph),
+    m_foldedExpressions(0), m_prunedBranches(0) {
+  m_values.resize(m_chains.countVariables());
+  m_isExecutable.assign(m_graph.countBlocks(), false);
+  m_isExecutableEdge.assign(2*m_graph.countBlocks(), false);
+}
+
+bool
+ConstantPropagation::isExecutableEdge(int from, int to) const {
+  for (int index = 0; index < m_graph.countSuccessors(from); ++index)
+    if (m_graph.successor(from, index) == to && m_isExecutableEdge[2*from+index])
+      return true;
+  return false;
+}
+
+void
+ConstantPropagation::setExecutableEdge(int from, int index) {
+  if (m_isExecutableEdge[2*from+index])
+    return;
+  m_isExecutableEdge[2*from+index] = true;
+  int to = m_graph.successor(from, index);
+  if (!m_isExecutable[to]) {
+    m_isExecutable[to] = true;
+    m_blocksToVisit.push_back(to);
+    return;
+  };
+  // a block already visited only has its phi functions to reconsider
+  VirtualInstruction* instruction = &m_graph.first(to);
+  while (true) {
+    if (instruction->type() == VirtualInstruction::TExpression) {
+      assert(dynamic_cast<const ExpressionInstruction*>(instruction));
+      if (((const ExpressionInstruction&) *instruction).isPhi())
+        visit(*instruction, to);
+    };
+    if (instruction == &m_graph.last(to))
+      break;
+    instruction = instruction->getSNextInstruction();
+  };
+}
+
+void
+ConstantPropagation::define(const VirtualExpression& variable, const Value& value) {
+  int number = m_chains.findVariable(variable);
+  if (number < 0)
+    return;
+  Value oldValue = m_values[number];
+  m_values[number].meet((m_chains.isSSA(number) && DefUseChains::isInteger(variable)) ? value : Value::unknown());
+  if (m_values[number] != oldValue)
+    m_variablesToPropagate.push_back(number);
+}
+
+ConstantPropagation::Value
+ConstantPropagation::evaluate(const VirtualExpression& expression) {
+  switch (expression.type()) {
+    case VirtualExpression::TConstant:
+      assert(dynamic_cast<const ConstantExpression*>(&expression));
+      return Value(((const ConstantExpression&) expression).value());
+    case VirtualExpression::TChar:
+      assert(dynamic_cast<const CharExpression*>(&expression));
+      return Value((int) ((const CharExpression&) expression).value());
+    case VirtualExpression::TLocalVariable:
+      {  int number = m_chains.findVariable(expression);
+        return (number >= 0 && m_chains.isSSA(number)) ? m_values[number] : Value::unknown();
+      };
+    case VirtualExpression::TComparison:
+      {  assert(dynamic_cast<const ComparisonExpression*>(&expression));
+        const ComparisonExpression& comparison = (const ComparisonExpression&) expression;
+        Value fst = evaluate(comparison.getFst()), snd = evaluate(comparison.getSnd());
+        if (fst.state() == Value::SUnknown || snd.state() == Value::SUnknown)
+          return Value::unknown();
+        if (!fst.isConstant() || !snd.isConstant())
+          return Value();
+        switch (comparison.getOperator()) {
+          case ComparisonExpression::OCompareLess: return Value(fst.constant() < snd.constant());
+          case ComparisonExpression::OCompareLessOrEqual: return Value(fst.constant() <= snd.constant());
+          case ComparisonExpression::OCompareEqual: return Value(fst.constant() == snd.constant());
+          case ComparisonExpression::OCompareDifferent: return Value(fst.constant() != snd.constant());
+          case ComparisonExpression::OCompareGreaterOrEqual: return Value(fst.constant() >= snd.constant());
+          case ComparisonExpression::OCompareGreater: return Value(fst.constant() > snd.constant());
+          default: return Value::unknown();
+        };
+      };
+    case VirtualExpression::TUnaryOperator:
+      {  assert(dynamic_cast<const UnaryOperatorExpression*>(&expression));
+        const UnaryOperatorExpression& unary = (const UnaryOperatorExpression&) expression;
+        Value sub = evaluate(unary.getSubExpression());
+        if (!sub.isConstant())
+          return sub;
+        if (unary.getOperator() == UnaryOperatorExpression::OMinus)
+          return Value((int) (0U - (unsigned) sub.constant()));
+        if (unary.getOperator() == UnaryOperatorExpression::ONeg)
+          return Value(!sub.constant());
+        return Value::unknown();
+      };
+    case VirtualExpression::TBinaryOperator:
+      {  assert(dynamic_cast<const BinaryOperatorExpression*>(&expression));
+        const BinaryOperatorExpression& binary = (const BinaryOperatorExpression&) expression;
+        Value fst = evaluate(binary.getFst()), snd = evaluate(binary.getSnd());
+        if (fst.state() == Value::SUnknown || snd.state() == Value::SUnknown)
+          return Value::unknown();
+        if (!fst.isConstant() || !snd.isConstant())
+          return Value();
+        // the arithmetic wraps as the one of the target
+        unsigned fstValue = fst.constant(), sndValue = snd.constant();
+        switch (binary.getOperator()) {
+          case BinaryOperatorExpression::OPlus: return Value((int) (fstValue + sndValue));
+          case BinaryOperatorExpression::OMinus: return Value((int) (fstValue - sndValue));
+          case BinaryOperatorExpression::OTimes: return Value((int) (fstValue * sndValue));
+          case BinaryOperatorExpression::ODivide:
+            if (snd.constant() == 0 || (fst.constant() == INT_MIN && snd.constant() == -1))
+              return Value::unknown();
+            return Value(fst.constant() / snd.constant());
+          default: return Value::unknown();
+        };
+      };
+    case VirtualExpression::TAssign:
+      {  assert(dynamic_cast<const AssignExpression*>(&expression));
+        const AssignExpression& assign = (const AssignExpression&) expression;
+        Value value = evaluate(assign.getRValue());
+        if (assign.getLValue().type() == VirtualExpression::TLocalVariable)
+          define(assign.getLValue(), value);
+        else if (!DefUseChains::isVariable(assign.getLValue()))
+          evaluate(assign.getLValue());
+        return Value::unknown();
+      };
+    case VirtualExpression::TDereference:
+      // the nested assignments are still to be seen
+      if (!dynamic_cast<const ReferenceExpression*>(&expression)) {
+        assert(dynamic_cast<const DereferenceExpression*>(&expression));
+        evaluate(((const DereferenceExpression&) expression).getSubExpression());
+      };
+      return Value::unknown();
+    case VirtualExpression::TCast:
+      assert(dynamic_cast<const CastExpression*>(&expression));
+      evaluate(((const CastExpression&) expression).getSubExpression());
+      return Value::unknown();
+    case VirtualExpression::TFunctionCall:
+      {  assert(dynamic_cast<const FunctionCallExpression*>(&expression));
+        const FunctionCallExpression& call = (const FunctionCallExpression&) expression;
+        for (int index = 0; index < call.countArguments(); ++index)
+          evaluate(call.getArgument(index));
+      };
+      return Value::unknown();
+    default:
+      return Value::unknown();
+  };
+}
+
+ConstantPropagation::Value
+ConstantPropagation::evaluatePhi(const PhiExpression& phi, int block) {
+  // only the operands coming through an executable edge count
+  Value result;
+  for (int index = 0; index < phi.countOperands(); ++index) {
+    GotoInstruction* origin = phi.getOrigin(index);
+    if (!origin)
+      result.meet(Value::unknown());
+    else if (isExecutableEdge(m_graph.blockOf(*origin), block))
+      result.meet(evaluate(phi.getOperand(index)));
+  };
+  return result;
+}
+
+void
+ConstantPropagation::visit(VirtualInstruction& instruction, int block) {
+  if (instruction.type() == VirtualInstruction::TExpression) {
+    assert(dynamic_cast<const ExpressionInstruction*>(&instruction));
+    const ExpressionInstruction& expressionInstruction = (const ExpressionInstruction&) instruction;
+    if (expressionInstruction.isPhi()) {
+      const AssignExpression& assign = (const AssignExpression&) expressionInstruction.getExpression();
+      assert(dynamic_cast<const PhiExpression*>(&assign.getRValue()));
+      define(assign.getLValue(), evaluatePhi((const PhiExpression&) assign.getRValue(), block));
+    }
+    else
+      evaluate(expressionInstruction.getExpression());
+  }
+  else if (instruction.type() == VirtualInstruction::TIf) {
+    assert(dynamic_cast<const IfInstruction*>(&instruction));
+    const IfInstruction& ifInstruction = (const IfInstruction&) instruction;
+    // a condition still undefined lets both branches go
+    Value condition = evaluate(ifInstruction.getExpression());
+    int thenBlock = ifInstruction.getSThenInstruction()
+      ? m_graph.blockOf(*ifInstruction.getSThenInstruction()) : -1;
+    for (int index = 0; index < m_graph.countSuccessors(block); ++index) {
+      bool isThen = (m_graph.successor(block, index) == thenBlock);
+      if (!condition.isConstant() || ((condition.constant() != 0) == isThen))
+        setExecutableEdge(block, index);
+    };
+  }
+  else if (instruction.type() == VirtualInstruction::TReturn) {
+    assert(dynamic_cast<const ReturnInstruction*>(&instruction));
+    evaluate(((const ReturnInstruction&) instruction).getResult());
+  };
+}
+
+void
+ConstantPropagation::visitBlock(int block) {
+  VirtualInstruction* instruction = &m_graph.first(block);
+  while (true) {
+    visit(*instruction, block);
+    if (instruction == &m_graph.last(block))
+      break;
+    instruction = instruction->getSNextInstruction();
+  };
+  if (instruction->type() != VirtualInstruction::TIf)
+    for (int index = 0; index < m_graph.countSuccessors(block); ++index)
+      setExecutableEdge(block, index);
+}
+
+void
+ConstantPropagation::propagate() {
+  m_isExecutable[m_graph.entry()] = true;
+  m_blocksToVisit.push_back(m_graph.entry());
+  while (!m_blocksToVisit.empty() || !m_variablesToPropagate.empty()) {
+    while (!m_blocksToVisit.empty()) {
+      int block = m_blocksToVisit.back();
+      m_blocksToVisit.pop_back();
+      visitBlock(block);
+    };
+    while (!m_variablesToPropagate.empty()) {
+      int variable = m_variablesToPropagate.back();
+      m_variablesToPropagate.pop_back();
+      for (int index = 0; index < m_chains.countUses(variable); ++index) {
+        VirtualInstruction& use = m_chains.use(variable, index);
+        int block = m_graph.blockOf(use);
+        if (m_isExecutable[block])
+          visit(use, block);
+      };
+    };
+  };
+}
+
+VirtualExpression*
+ConstantPropagation::fold(VirtualExpression& expression) {
+  // returns the constant replacing expression, NULL to keep it
+  if (expression.type() == VirtualExpression::TConstant || expression.type() == VirtualExpression::TChar)
+    return NULL;
+  Value value = evaluate(expression);
+  if (value.isConstant()) {
+    ++m_foldedExpressions;
+    return new (m_function.arena()) ConstantExpression(value.constant());
+  };
+  foldOperands(expression);
+  return NULL;
+}
+
+void
+ConstantPropagation::foldOperands(VirtualExpression& expression) {
+  VirtualExpression* replacement;
+  switch (expression.type()) {
+    case VirtualExpression::TComparison:
+      {  assert(dynamic_cast<const ComparisonExpression*>(&expression));
+        ComparisonExpression& comparison = (ComparisonExpression&) expression;
+        if ((replacement = fold(comparison.getFst())) != NULL)
+          comparison.setFst(replacement);
+        if ((replacement = fold(comparison.getSnd())) != NULL)
+          comparison.setSnd(replacement);
+      };
+      break;
+    case VirtualExpression::TBinaryOperator:
+      {  assert(dynamic_cast<const BinaryOperatorExpression*>(&expression));
+        BinaryOperatorExpression& binary = (BinaryOperatorExpression&) expression;
+        if ((replacement = fold(binary.getFst())) != NULL)
+          binary.setFst(replacement);
+        if ((replacement = fold(binary.getSnd())) != NULL)
+          binary.setSnd(replacement);
+      };
+      break;
+    case VirtualExpression::TUnaryOperator:
+      assert(dynamic_cast<const UnaryOperatorExpression*>(&expression));
+      if ((replacement = fold(((UnaryOperatorExpression&) expression).getSubExpression())) != NULL)
+        ((UnaryOperatorExpression&) expression).setSubExpression(replacement);
+      break;
+    case VirtualExpression::TCast:
+      assert(dynamic_cast<const CastExpression*>(&expression));
+      if ((replacement = fold(((CastExpression&) expression).getSubExpression())) != NULL)
+        ((CastExpression&) expression).setSubExpression(replacement);
+      break;
+    case VirtualExpression::TDereference:
+      // the variable of a reference keeps its address
+      if (!dynamic_cast<const ReferenceExpression*>(&expression)) {
+        assert(dynamic_cast<const DereferenceExpression*>(&expression));
+        if ((replacement = fold(((DereferenceExpression&) expression).getSubExpression())) != NULL)
+          ((DereferenceExpression&) expression).setSubExpression(replacement);
+      };
+      break;
+    case VirtualExpression::TFunctionCall:
+      {  assert(dynamic_cast<const FunctionCallExpression*>(&expression));
+        FunctionCallExpression& call = (FunctionCallExpression&) expression;
+        for (int index = 0; index < call.countArguments(); ++index)
+          if ((replacement = fold(call.getArgument(index))) != NULL)
+            call.setArgument(index, replacement);
+      };
+      break;
+    case VirtualExpression::TAssign:
+      {  assert(dynamic_cast<const AssignExpression*>(&expression));
+        AssignExpression& assign = (AssignExpression&) expression;
+        if ((replacement = fold(assign.getRValue())) != NULL)
+          assign.setRValue(replacement);
+        if (!DefUseChains::isVariable(assign.getLValue()))
+          foldOperands(assign.getLValue());
+      };
+      break;
+    default:
+      break;
+  };
+}
+
+void
+ConstantPropagation::apply() {
+  // the folded phi functions and the instruction each one goes after: the
+  // backends take the phi functions of a label up to the first other
+  // instruction, so the copies leave the group once the traversal is done
+  std::vector<std::pair<VirtualInstruction*, VirtualInstruction*> > foldedPhis;
+  const std::vector<int>& order = m_graph.reversePostorder();
+  for (std::vector<int>::const_iterator blockIter = order.begin(); blockIter != order.end(); ++blockIter) {
+    int block = *blockIter;
+    if (!m_isExecutable[block])
+      continue;
+    VirtualInstruction* lastPhi = NULL;
+    std::vector<VirtualInstruction*> blockFoldedPhis;
+    VirtualInstruction* instruction = &m_graph.first(block);
+    if (instruction->type() == VirtualInstruction::TLabel) {
+      // the label forgets its predecessors that are never executed
+      assert(dynamic_cast<const LabelInstruction*>(instruction));
+      LabelInstruction& label = (LabelInstruction&) *instruction;
+      if (label.getSGotoInstruction() && !isExecutableEdge(m_graph.blockOf(*label.getSGotoInstruction()), block))
+        label.disconnectGoto();
+      VirtualInstruction* previous = label.getSPreviousInstruction();
+      if (previous && !isExecutableEdge(m_graph.blockOf(*previous), block))
+        previous->disconnectNext();
+    };
+    while (true) {
+      VirtualInstruction* next = (instruction == &m_graph.last(block)) ? NULL : instruction->getSNextInstruction();
+      if (instruction->type() == VirtualInstruction::TExpression) {
+        assert(dynamic_cast<const ExpressionInstruction*>(instruction));
+        ExpressionInstruction& expressionInstruction = (ExpressionInstruction&) *instruction;
+        VirtualExpression* replacement;
+        if (expressionInstruction.isPhi()) {
+          AssignExpression& assign = (AssignExpression&) expressionInstruction.getExpression();
+          assert(dynamic_cast<const PhiExpression*>(&assign.getRValue()));
+          PhiExpression& phi = (PhiExpression&) assign.getRValue();
+          for (int index = phi.countOperands()-1; index >= 0; --index)
+            if (phi.getOrigin(index) && !isExecutableEdge(m_graph.blockOf(*phi.getOrigin(index)), block))
+              phi.removeOperand(index);
+          lastPhi = instruction;
+          int number = m_chains.findVariable(assign.getLValue());
+          if (number >= 0 && m_values[number].isConstant()) {
+            assign.setRValue(new (m_function.arena()) ConstantExpression(m_values[number].constant()));
+            blockFoldedPhis.push_back(instruction);
+            ++m_foldedExpressions;
+          }
+          else if (phi.countOperands() == 1) {
+            // the operand reaches the label from its only executable
+            // predecessor, no phi function of the group defines it
+            assign.setRValue(phi.getOperand(0).clone());
+            blockFoldedPhis.push_back(instruction);
+          };
+        }
+        else if ((replacement = fold(expressionInstruction.getExpression())) != NULL)
+          expressionInstruction.setExpression(replacement);
+      }
+      else if (instruction->type() == VirtualInstruction::TIf) {
+        assert(dynamic_cast<const IfInstruction*>(instruction));
+        IfInstruction& ifInstruction = (IfInstruction&) *instruction;
+        VirtualExpression* replacement = fold(ifInstruction.getExpression());
+        if (replacement)
+          ifInstruction.setExpression(replacement);
+        GotoInstruction* thenPoint = ifInstruction.getSThenInstruction();
+        if (thenPoint && !isExecutableEdge(block, m_graph.blockOf(*thenPoint))) {
+          ifInstruction.disconnectThen();
+          ++m_prunedBranches;
+        };
+        VirtualInstruction* elsePoint = ifInstruction.getSNextInstruction();
+        if (elsePoint && !isExecutableEdge(block, m_graph.blockOf(*elsePoint))) {
+          ifInstruction.disconnectNext();
+          ++m_prunedBranches;
+        };
+      }
+      else if (instruction->type() == VirtualInstruction::TReturn) {
+        assert(dynamic_cast<const ReturnInstruction*>(instruction));
+        ReturnInstruction& returnInstruction = (ReturnInstruction&) *instruction;
+        VirtualExpression* replacement = fold(returnInstruction.getResult());
+        if (replacement)
+          returnInstruction.setResult(replacement);
+      };
+      if (!next)
+        break;
+      instruction = next;
+    };
+    VirtualInstruction* previous = lastPhi;
+    for (std::vector<VirtualInstruction*>::const_iterator phiIter = blockFoldedPhis.begin();
+        phiIter != blockFoldedPhis.end(); ++phiIter)
+      if (*phiIter != lastPhi) {
+        foldedPhis.push_back(std::make_pair(*phiIter, previous));
+        previous = *phiIter;
+      };
+  };
+  // the copies read values defined before the label, in any order
+  for (std::vector<std::pair<VirtualInstruction*, VirtualInstruction*> >::const_iterator phiIter = foldedPhis.begin();
+      phiIter != foldedPhis.end(); ++phiIter)
+    m_function.moveInstructionAfter(*phiIter->first, *phiIter->second);
+  m_function.invalidateControlFlow();
+}
@@ -0,0 +1,245 @@
+#include "ControlFlow.h"
+
+bool
+ControlFlowGraph::isLeader(const VirtualInstruction& instruction) {
+  VirtualInstruction* previous = instruction.getSPreviousInstruction();
+  return !previous || (instruction.type() == VirtualInstruction::TLabel)
+    || (instruction.type() == VirtualInstruction::TGoto && previous->type() == VirtualInstruction::TIf);
+}
+
+void
+ControlFlowGraph::addBlock(VirtualInstruction& first) {
+  int block = m_firsts.size();
+  VirtualInstruction* last = &first;
+  m_blockOf[first.getRegistrationIndex()] = block;
+  while (last->getSNextInstruction() && !isLeader(*last->getSNextInstruction())) {
+    last = last->getSNextInstruction();
+    m_blockOf[last->getRegistrationIndex()] = block;
+  };
+  m_firsts.push_back(&first);
+  m_lasts.push_back(last);
+}
+
+ControlFlowGraph::ControlFlowGraph(const Function& function) {
+  // the blocks are cut in the registration order, which follows the memory
+  // of the instructions, rather than by following the control flow
+  int count = function.countInstructions();
+  m_blockOf.assign(count, -1);
+  for (int index = 0; index < count; ++index) {
+    VirtualInstruction& instruction = function.getInstruction(index);
+    if (isLeader(instruction))
+      addBlock(instruction);
+  };
+  int blocks = m_firsts.size();
+  assert(blocks > 0 && m_firsts[0] == &function.getFirstInstruction());
+
+  m_successors.assign(2*blocks, -1);
+  m_predecessorStarts.reserve(blocks+1);
+  m_predecessorStarts.push_back(0);
+  for (int block = 0; block < blocks; ++block) {
+    VirtualInstruction& last = *m_lasts[block];
+    if (last.getSNextInstruction())
+      m_successors[2*block] = blockOf(*last.getSNextInstruction());
+    if (last.type() == VirtualInstruction::TIf) {
+      // a branch cut by the constant propagation is absent
+      assert(dynamic_cast<const IfInstruction*>(&last));
+      const GotoInstruction* thenPoint = ((const IfInstruction&) last).getSThenInstruction();
+      if (thenPoint)
+        m_successors[2*block+1] = blockOf(*thenPoint);
+    };
+    VirtualInstruction& first = *m_firsts[block];
+    if (first.type() == VirtualInstruction::TLabel) {
+      assert(dynamic_cast<const LabelInstruction*>(&first));
+      addPredecessor(((const LabelInstruction&) first).getSGotoInstruction());
+    };
+    addPredecessor(first.getSPreviousInstruction());
+    m_predecessorStarts.push_back(m_predecessors.size());
+  };
+
+  // depth first traversal of the blocks reachable from the entry, the
+  // postorder being reversed at the end
+  m_orderIndexes.assign(blocks, -1);
+  std::vector<bool> isVisited(blocks, false);
+  std::vector<std::pair<int, int> > stack;
+  stack.push_back(std::make_pair(entry(), 0));
+  isVisited[entry()] = true;
+  while (!stack.empty()) {
+    int block = stack.back().first;
+    int& successorIndex = stack.back().second;
+    while (successorIndex < 2 && (m_successors[2*block+successorIndex] < 0
+          || isVisited[m_successors[2*block+successorIndex]]))
+      ++successorIndex;
+    if (successorIndex < 2) {
+      int successor = m_successors[2*block+successorIndex++];
+      isVisited[successor] = true;
+      stack.push_back(std::make_pair(successor, 0));
+    }
+    else {
+      m_order.push_back(block);
+      stack.pop_back();
+    };
+  };
+  std::reverse(m_order.begin(), m_order.end());
+  for (int index = 0; index < (int) m_order.size(); ++index)
+    m_orderIndexes[m_order[index]] = index;
+}
+
+int
+ControlFlowGraph::intersect(int fstBlock, int sndBlock) const {
+  while (fstBlock != sndBlock) {
+    while (m_orderIndexes[fstBlock] > m_orderIndexes[sndBlock])
+      fstBlock = m_dominators[fstBlock];
+    while (m_orderIndexes[sndBlock] > m_orderIndexes[fstBlock])
+      sndBlock = m_dominators[sndBlock];
+  };
+  return fstBlock;
+}
+
+void
+ControlFlowGraph::computeDominators() {
+  m_dominators.assign(countBlocks(), -1);
+  m_dominators[entry()] = entry();
+  bool hasChanged = true;
+  while (hasChanged) {
+    hasChanged = false;
+    for (std::vector<int>::const_iterator blockIter = m_order.begin()+1; blockIter != m_order.end(); ++blockIter) {
+      int newDominator = -1;
+      for (int index = m_predecessorStarts[*blockIter]; index < m_predecessorStarts[*blockIter+1]; ++index) {
+        int predecessor = m_predecessors[index];
+        if (m_dominators[predecessor] < 0)
+          continue;
+        newDominator = (newDominator < 0) ? predecessor : intersect(predecessor, newDominator);
+      };
+      if (m_dominators[*blockIter] != newDominator) {
+        m_dominators[*blockIter] = newDominator;
+        hasChanged = true;
+      };
+    };
+  };
+  numberDominatorTree();
+}
+
+void
+ControlFlowGraph::numberDominatorTree() {
+  int blocks = countBlocks();
+  m_childStarts.assign(blocks+1, 0);
+  for (std::vector<int>::const_iterator blockIter = m_order.begin()+1; blockIter != m_order.end(); ++blockIter)
+    ++m_childStarts[m_dominators[*blockIter]+1];
+  for (int block = 0; block < blocks; ++block)
+    m_childStarts[block+1] += m_childStarts[block];
+  m_children.resize(m_childStarts[blocks]);
+  std::vector<int> fills(m_childStarts.begin(), m_childStarts.end()-1);
+  for (std::vector<int>::const_iterator blockIter = m_order.begin()+1; blockIter != m_order.end(); ++blockIter)
+    m_children[fills[m_dominators[*blockIter]]++] = *blockIter;
+
+  // the block a dominates b when the subtree of a encloses b
+  m_preorderIndexes.assign(blocks, -1);
+  m_postorderIndexes.assign(blocks, -1);
+  int preorder = 0, postorder = 0;
+  std::vector<std::pair<int, int> > stack;
+  stack.push_back(std::make_pair(entry(), 0));
+  m_preorderIndexes[entry()] = preorder++;
+  while (!stack.empty()) {
+    int block = stack.back().first;
+    int& childIndex = stack.back().second;
+    if (childIndex < countChildren(block)) {
+      int next = child(block, childIndex++);
+      m_preorderIndexes[next] = preorder++;
+      stack.push_back(std::make_pair(next, 0));
+    }
+    else {
+      m_postorderIndexes[block] = postorder++;
+      stack.pop_back();
+    };
+  };
+}
+
+void
+ControlFlowGraph::applyDominators() const {
+  assert(hasDominators());
+  // the reverse postorder visits a block after its dominator
+  for (std::vector<int>::const_iterator blockIter = m_order.begin(); blockIter != m_order.end(); ++blockIter) {
+    VirtualInstruction* instruction = m_firsts[*blockIter];
+    int height = 1;
+    if (*blockIter != entry()) {
+      VirtualInstruction& dominator = *m_lasts[m_dominators[*blockIter]];
+      height = dominator.getDominationHeight()+1;
+      if (instruction->type() == VirtualInstruction::TLabel) {
+        assert(dynamic_cast<const LabelInstruction*>(instruction));
+        ((LabelInstruction*) instruction)->setDominator(dominator);
+      };
+    };
+    instruction->setDominationHeight(height);
+    while (instruction != m_lasts[*blockIter]) {
+      instruction = instruction->getSNextInstruction();
+      instruction->setDominationHeight(++height);
+    };
+  };
+}
+
+void
+ControlFlowGraph::computeDominationFrontiers() {
+  // the runner of Cooper, Harvey and Kennedy climbs from each predecessor of
+  // a block up to its immediate dominator. A block gets one entry by edge:
+  // a join can appear twice if both its incoming edges come through it.
+  assert(hasDominators());
+  int blocks = countBlocks();
+  std::vector<int> runners, joins;
+  std::vector<GotoInstruction*> edges;
+  for (int block = 0; block < blocks; ++block) {
+    if (!isReachable(block))
+      continue;
+    for (int index = m_predecessorStarts[block]; index < m_predecessorStarts[block+1]; ++index) {
+      int runner = m_predecessors[index];
+      if (!isReachable(runner))
+        continue;
+      GotoInstruction* edge = NULL;
+      while (runner != m_dominators[block]) {
+        if (!edge) {
+          assert(dynamic_cast<const GotoInstruction*>(m_lasts[m_predecessors[index]]));
+          edge = (GotoInstruction*) m_lasts[m_predecessors[index]];
+        };
+        runners.push_back(runner);
+        joins.push_back(block);
+        edges.push_back(edge);
+        runner = m_dominators[runner];
+      };
+    };
+  };
+
+  // grouped by block, the entries of a block keep their order
+  m_frontierStarts.assign(blocks+1, 0);
+  for (std::vector<int>::const_iterator runnerIter = runners.begin(); runnerIter != runners.end(); ++runnerIter)
+    ++m_frontierStarts[*runnerIter+1];
+  for (int block = 0; block < blocks; ++block)
+    m_frontierStarts[block+1] += m_frontierStarts[block];
+  m_frontiers.resize(runners.size());
+  m_frontierEdges.resize(runners.size());
+  std::vector<int> fills(m_frontierStarts.begin(), m_frontierStarts.end()-1);
+  for (int index = 0; index < (int) runners.size(); ++index) {
+    int position = fills[runners[index]]++;
+    m_frontiers[position] = joins[index];
+    m_frontierEdges[position] = edges[index];
+  };
+}
+
+void
+ControlFlowGraph::applyDominationFrontiers() const {
+  // the frontier of a block is held by its first instruction, a label or
+  // the goto following an if
+  for (int block = 0; block < countBlocks(); ++block) {
+    if (countFrontiers(block) == 0)
+      continue;
+    VirtualInstruction& first = *m_firsts[block];
+    for (int index = m_frontierStarts[block]; index < m_frontierStarts[block+1]; ++index) {
+      if (first.type() == VirtualInstruction::TLabel) {
+        assert(dynamic_cast<const LabelInstruction*>(&first));
+        ((LabelInstruction&) first).addDominationFrontier(*m_frontierEdges[index]);
+      }
+      else {
+        assert(dynamic_cast<const GotoInstruction*>(&first));
+        ((GotoInstruction&) first).addDominationFrontier(*m_frontierEdges[index]);
+      };
+    };
+  };
+}
@@ -0,0 +1,111 @@
+#include "DeadCode.h"
+
+DeadCodeElimination::DeadCodeElimination(Function& function)
+  :  m_function(function), m_graph(function.controlFlow()), m_chains(m_graph),
+    m_removedAssignments(0), m_removedPhis(0) {
+  m_isLive.assign(m_graph.countInstructions(), false);
+}
+
+bool
+DeadCodeElimination::hasSideEffect(const VirtualExpression& expression) const {
+  switch (expression.type()) {
+    case VirtualExpression::TComparison:
+      assert(dynamic_cast<const ComparisonExpression*>(&expression));
+      return hasSideEffect(((const ComparisonExpression&) expression).getFst())
+        || hasSideEffect(((const ComparisonExpression&) expression).getSnd());
+    case VirtualExpression::TBinaryOperator:
+      assert(dynamic_cast<const BinaryOperatorExpression*>(&expression));
+      return hasSideEffect(((const BinaryOperatorExpression&) expression).getFst())
+        || hasSideEffect(((const BinaryOperatorExpression&) expression).getSnd());
+    case VirtualExpression::TUnaryOperator:
+      assert(dynamic_cast<const UnaryOperatorExpression*>(&expression));
+      return hasSideEffect(((const UnaryOperatorExpression&) expression).getSubExpression());
+    case VirtualExpression::TCast:
+      assert(dynamic_cast<const CastExpression*>(&expression));
+      return hasSideEffect(((const CastExpression&) expression).getSubExpression());
+    case VirtualExpression::TDereference:
+      // ReferenceExpression shares the type of DereferenceExpression
+      if (dynamic_cast<const ReferenceExpression*>(&expression))
+        return hasSideEffect(((const ReferenceExpression&) expression).getSubExpression());
+      assert(dynamic_cast<const DereferenceExpression*>(&expression));
+      return hasSideEffect(((const DereferenceExpression&) expression).getSubExpression());
+    case VirtualExpression::TFunctionCall:
+      return true;
+    case VirtualExpression::TAssign:
+      {  assert(dynamic_cast<const AssignExpression*>(&expression));
+        const AssignExpression& assign = (const AssignExpression&) expression;
+        int variable = m_chains.findVariable(assign.getLValue());
+        return variable < 0 || !m_chains.isSSA(variable) || hasSideEffect(assign.getRValue());
+      };
+    default:
+      // the variables, the constants and the phi functions
+      return false;
+  };
+}
+
+bool
+DeadCodeElimination::isCritical(const VirtualInstruction& instruction) const {
+  if (instruction.type() != VirtualInstruction::TExpression)
+    return true;
+  assert(dynamic_cast<const ExpressionInstruction*>(&instruction));
+  return hasSideEffect(((const ExpressionInstruction&) instruction).getExpression());
+}
+
+void
+DeadCodeElimination::setLive(VirtualInstruction& instruction) {
+  if (m_isLive[instruction.getRegistrationIndex()])
+    return;
+  m_isLive[instruction.getRegistrationIndex()] = true;
+  m_liveToPropagate.push_back(&instruction);
+}
+
+void
+DeadCodeElimination::mark() {
+  const std::vector<int>& order = m_graph.reversePostorder();
+  for (std::vector<int>::const_iterator blockIter = order.begin(); blockIter != order.end(); ++blockIter) {
+    VirtualInstruction* instruction = &m_graph.first(*blockIter);
+    while (true) {
+      if (isCritical(*instruction))
+        setLive(*instruction);
+      if (instruction == &m_graph.last(*blockIter))
+        break;
+      instruction = instruction->getSNextInstruction();
+    };
+  };
+
+  // the definitions of the variables read by a live instruction are live
+  while (!m_liveToPropagate.empty()) {
+    VirtualInstruction& instruction = *m_liveToPropagate.back();
+    m_liveToPropagate.pop_back();
+    for (int index = 0; index < m_chains.countReads(instruction); ++index) {
+      VirtualInstruction* definition = m_chains.getDefinition(m_chains.read(instruction, index));
+      if (definition)
+        setLive(*definition);
+    };
+  };
+}
+
+void
+DeadCodeElimination::sweep() {
+  std::vector<VirtualInstruction*> deadInstructions;
+  const std::vector<int>& order = m_graph.reversePostorder();
+  for (std::vector<int>::const_iterator blockIter = order.begin(); blockIter != order.end(); ++blockIter) {
+    VirtualInstruction* instruction = &m_graph.first(*blockIter);
+    while (true) {
+      if (!m_isLive[instruction->getRegistrationIndex()]) {
+        assert(dynamic_cast<const ExpressionInstruction*>(instruction));
+        if (((const ExpressionInstruction&) *instruction).isPhi())
+          ++m_removedPhis;
+        else
+          ++m_removedAssignments;
+        deadInstructions.push_back(instruction);
+      };
+      if (instruction == &m_graph.last(*blockIter))
+        break;
+      instruction = instruction->getSNextInstruction();
+    };
+  };
+  // the graph is dropped by the removal
+  if (!deadInstructions.empty())
+    m_function.removeInstructions(deadInstructions);
+}
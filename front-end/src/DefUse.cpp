@@ -0,0 +1,170 @@
+#include "DefUse.h"
+
+bool
+DefUseChains::isInteger(const VirtualExpression& variable, Function* function) {
+  std::auto_ptr<VirtualType> type = variable.newType(function);
+  const BaseType* baseType = dynamic_cast<const BaseType*>(type.get());
+  return baseType && baseType->getValue() == BaseType::VInt;
+}
+
+int
+DefUseChains::findVariable(const VirtualExpression& variable) const {
+  if (variable.type() != VirtualExpression::TLocalVariable)
+    return -1;
+  assert(dynamic_cast<const LocalVariableExpression*>(&variable));
+  const LocalVariableExpression& local = (const LocalVariableExpression&) variable;
+  return findVariable(local.scope().symbolTable(), local.getLocalScope());
+}
+
+int
+DefUseChains::findVariable(const SymbolTable& table, int localIndex) const {
+  std::map<const SymbolTable*, std::pair<int, int> >::const_iterator found = m_tables.find(&table);
+  assert(localIndex >= 0);
+  // a declaration added to the table after the chains, as by the reduction
+  // of the induction variables, would otherwise be a variable of the next one
+  if (found == m_tables.end() || localIndex >= found->second.second)
+    return -1;
+  return found->second.first + localIndex;
+}
+
+int
+DefUseChains::addVariable(const VirtualExpression& variable) {
+  assert(dynamic_cast<const LocalVariableExpression*>(&variable));
+  const LocalVariableExpression& local = (const LocalVariableExpression&) variable;
+  const SymbolTable& table = local.scope().symbolTable();
+  if (m_tables.find(&table) == m_tables.end()) {
+    m_tables.insert(std::make_pair(&table, std::make_pair(m_count, table.count())));
+    m_count += table.count();
+    m_definitions.resize(m_count, NULL);
+    m_definitionCounts.resize(m_count, 0);
+    m_isAddressTaken.resize(m_count, false);
+  };
+  return findVariable(table, local.getLocalScope());
+}
+
+void
+DefUseChains::collect(const VirtualExpression& expression, VirtualInstruction& instruction,
+    std::vector<std::pair<int, VirtualInstruction*> >& uses) {
+  switch (expression.type()) {
+    case VirtualExpression::TLocalVariable:
+      uses.push_back(std::make_pair(addVariable(expression), &instruction));
+      break;
+    case VirtualExpression::TComparison:
+      assert(dynamic_cast<const ComparisonExpression*>(&expression));
+      collect(((const ComparisonExpression&) expression).getFst(), instruction, uses);
+      collect(((const ComparisonExpression&) expression).getSnd(), instruction, uses);
+      break;
+    case VirtualExpression::TBinaryOperator:
+      assert(dynamic_cast<const BinaryOperatorExpression*>(&expression));
+      collect(((const BinaryOperatorExpression&) expression).getFst(), instruction, uses);
+      collect(((const BinaryOperatorExpression&) expression).getSnd(), instruction, uses);
+      break;
+    case VirtualExpression::TUnaryOperator:
+      assert(dynamic_cast<const UnaryOperatorExpression*>(&expression));
+      collect(((const UnaryOperatorExpression&) expression).getSubExpression(), instruction, uses);
+      break;
+    case VirtualExpression::TCast:
+      assert(dynamic_cast<const CastExpression*>(&expression));
+      collect(((const CastExpression&) expression).getSubExpression(), instruction, uses);
+      break;
+    case VirtualExpression::TDereference:
+      // ReferenceExpression shares the type of DereferenceExpression
+      if (dynamic_cast<const ReferenceExpression*>(&expression)) {
+        const VirtualExpression& subExpression = ((const ReferenceExpression&) expression).getSubExpression();
+        if (subExpression.type() == VirtualExpression::TLocalVariable)
+          m_isAddressTaken[addVariable(subExpression)] = true;
+        else if (subExpression.type() == VirtualExpression::TParameter) {
+          assert(dynamic_cast<const ParameterExpression*>(&subExpression));
+          m_assignedParameters.insert(((const ParameterExpression&) subExpression).getIndex());
+        };
+        collect(subExpression, instruction, uses);
+      }
+      else {
+        assert(dynamic_cast<const DereferenceExpression*>(&expression));
+        collect(((const DereferenceExpression&) expression).getSubExpression(), instruction, uses);
+      };
+      break;
+    case VirtualExpression::TFunctionCall:
+      {  assert(dynamic_cast<const FunctionCallExpression*>(&expression));
+        const FunctionCallExpression& call = (const FunctionCallExpression&) expression;
+        for (int index = 0; index < call.countArguments(); ++index)
+          collect(call.getArgument(index), instruction, uses);
+      };
+      break;
+    case VirtualExpression::TAssign:
+      {  assert(dynamic_cast<const AssignExpression*>(&expression));
+        const AssignExpression& assign = (const AssignExpression&) expression;
+        collect(assign.getRValue(), instruction, uses);
+        const VirtualExpression& lvalue = assign.getLValue();
+        if (lvalue.type() == VirtualExpression::TLocalVariable) {
+          int variable = addVariable(lvalue);
+          m_definitions[variable] = &instruction;
+          ++m_definitionCounts[variable];
+        }
+        else if (lvalue.type() == VirtualExpression::TParameter) {
+          assert(dynamic_cast<const ParameterExpression*>(&lvalue));
+          m_assignedParameters.insert(((const ParameterExpression&) lvalue).getIndex());
+        }
+        else if (!isVariable(lvalue))
+          collect(lvalue, instruction, uses);
+      };
+      break;
+    case VirtualExpression::TPhi:
+      {  assert(dynamic_cast<const PhiExpression*>(&expression));
+        const PhiExpression& phi = (const PhiExpression&) expression;
+        for (int index = 0; index < phi.countOperands(); ++index)
+          collect(phi.getOperand(index), instruction, uses);
+      };
+      break;
+    default:
+      break;
+  };
+}
+
+DefUseChains::DefUseChains(const ControlFlowGraph& graph)
+  :  m_count(0) {
+  std::vector<std::pair<int, VirtualInstruction*> > uses;
+  const std::vector<int>& order = graph.reversePostorder();
+  for (std::vector<int>::const_iterator blockIter = order.begin(); blockIter != order.end(); ++blockIter) {
+    VirtualInstruction* instruction = &graph.first(*blockIter);
+    while (true) {
+      if (instruction->type() == VirtualInstruction::TExpression) {
+        assert(dynamic_cast<const ExpressionInstruction*>(instruction));
+        collect(((const ExpressionInstruction&) *instruction).getExpression(), *instruction, uses);
+      }
+      else if (instruction->type() == VirtualInstruction::TIf) {
+        assert(dynamic_cast<const IfInstruction*>(instruction));
+        collect(((const IfInstruction&) *instruction).getExpression(), *instruction, uses);
+      }
+      else if (instruction->type() == VirtualInstruction::TReturn) {
+        assert(dynamic_cast<const ReturnInstruction*>(instruction));
+        collect(((const ReturnInstruction&) *instruction).getResult(), *instruction, uses);
+      };
+      if (instruction == &graph.last(*blockIter))
+        break;
+      instruction = instruction->getSNextInstruction();
+    };
+  };
+
+  // the uses grouped by variable, in the order of the reverse postorder
+  m_useStarts.assign(m_count+1, 0);
+  for (std::vector<std::pair<int, VirtualInstruction*> >::const_iterator useIter = uses.begin(); useIter != uses.end(); ++useIter)
+    ++m_useStarts[useIter->first+1];
+  for (int variable = 0; variable < m_count; ++variable)
+    m_useStarts[variable+1] += m_useStarts[variable];
+  m_uses.resize(uses.size());
+  std::vector<int> fills(m_useStarts.begin(), m_useStarts.end()-1);
+  for (std::vector<std::pair<int, VirtualInstruction*> >::const_iterator useIter = uses.begin(); useIter != uses.end(); ++useIter)
+    m_uses[fills[useIter->first]++] = useIter->second;
+
+  // the variables read, grouped by instruction
+  m_readStarts.assign(graph.countInstructions()+1, 0);
+  for (std::vector<std::pair<int, VirtualInstruction*> >::const_iterator useIter = uses.begin(); useIter != uses.end(); ++useIter)
+    ++m_readStarts[useIter->second->getRegistrationIndex()+1];
+  for (int index = 0; index < graph.countInstructions(); ++index)
+    m_readStarts[index+1] += m_readStarts[index];
+  m_reads.resize(uses.size());
+  fills.assign(m_readStarts.begin(), m_readStarts.end()-1);
+  for (std::vector<std::pair<int, VirtualInstruction*> >::const_iterator useIter = uses.begin(); useIter != uses.end(); ++useIter)
+    m_reads[fills[useIter->second->getRegistrationIndex()]++] = useIter->first;
+}
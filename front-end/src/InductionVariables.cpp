@@ -0,0 +1,458 @@
+#include "InductionVariables.h"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+// a < b is b > a
+ComparisonExpression::Operator
+mirror(ComparisonExpression::Operator operatorCode) {
+  switch (operatorCode) {
+    case ComparisonExpression::OCompareLess: return ComparisonExpression::OCompareGreater;
+    case ComparisonExpression::OCompareLessOrEqual: return ComparisonExpression::OCompareGreaterOrEqual;
+    case ComparisonExpression::OCompareGreaterOrEqual: return ComparisonExpression::OCompareLessOrEqual;
+    case ComparisonExpression::OCompareGreater: return ComparisonExpression::OCompareLess;
+    default: return operatorCode;
+  };
+}
+
+// !(a < b) is a >= b
+ComparisonExpression::Operator
+negate(ComparisonExpression::Operator operatorCode) {
+  switch (operatorCode) {
+    case ComparisonExpression::OCompareLess: return ComparisonExpression::OCompareGreaterOrEqual;
+    case ComparisonExpression::OCompareLessOrEqual: return ComparisonExpression::OCompareGreater;
+    case ComparisonExpression::OCompareEqual: return ComparisonExpression::OCompareDifferent;
+    case ComparisonExpression::OCompareDifferent: return ComparisonExpression::OCompareEqual;
+    case ComparisonExpression::OCompareGreaterOrEqual: return ComparisonExpression::OCompareLess;
+    case ComparisonExpression::OCompareGreater: return ComparisonExpression::OCompareLessOrEqual;
+    default: return operatorCode;
+  };
+}
+
+// products and sums wrap like the int operations of the program
+int
+multiply(int fst, int snd) { return (int) ((unsigned) fst * (unsigned) snd); }
+
+int
+add(int fst, int snd) { return (int) ((unsigned) fst + (unsigned) snd); }
+
+}
+
+InductionVariables::InductionVariables(Function& function)
+  :  m_function(function), m_graph(function), m_chains(m_graph), m_loops(m_graph),
+    m_reducedMultiplications(0), m_tripCounts(0) {
+  m_isInLoop.assign(m_graph.countBlocks(), false);
+}
+
+void
+InductionVariables::markLoop(const NaturalLoops::Loop& loop, bool isInLoop) {
+  for (std::vector<int>::const_iterator blockIter = loop.blocks.begin(); blockIter != loop.blocks.end(); ++blockIter)
+    m_isInLoop[*blockIter] = isInLoop;
+}
+
+bool
+InductionVariables::findConstant(const VirtualExpression& expression, int& value) const {
+  // a constant or a SSA variable assigned a constant
+  const VirtualExpression* constant = &expression;
+  if (expression.type() == VirtualExpression::TLocalVariable) {
+    int variable = m_chains.findVariable(expression);
+    const VirtualInstruction* definition = (variable >= 0) ? m_chains.getDefinition(variable) : NULL;
+    if (!definition || definition->type() != VirtualInstruction::TExpression)
+      return false;
+    assert(dynamic_cast<const ExpressionInstruction*>(definition));
+    const VirtualExpression& assign = ((const ExpressionInstruction&) *definition).getExpression();
+    if (assign.type() != VirtualExpression::TAssign)
+      return false;
+    assert(dynamic_cast<const AssignExpression*>(&assign));
+    constant = &((const AssignExpression&) assign).getRValue();
+  };
+  if (constant->type() == VirtualExpression::TConstant) {
+    assert(dynamic_cast<const ConstantExpression*>(constant));
+    value = ((const ConstantExpression&) *constant).value();
+    return true;
+  };
+  if (constant->type() == VirtualExpression::TChar) {
+    assert(dynamic_cast<const CharExpression*>(constant));
+    value = ((const CharExpression&) *constant).value();
+    return true;
+  };
+  return false;
+}
+
+bool
+InductionVariables::findStep(int variable, int phiVariable, int& step) const {
+  // climbs the additions of constants from variable up to phiVariable
+  int result = 0;
+  while (variable != phiVariable) {
+    const VirtualInstruction* definition = (variable >= 0) ? m_chains.getDefinition(variable) : NULL;
+    if (!definition || definition->type() != VirtualInstruction::TExpression
+        || !m_isInLoop[m_graph.blockOf(*definition)])
+      return false;
+    assert(dynamic_cast<const ExpressionInstruction*>(definition));
+    const ExpressionInstruction& instruction = (const ExpressionInstruction&) *definition;
+    if (instruction.isPhi() || instruction.getExpression().type() != VirtualExpression::TAssign)
+      return false;
+    assert(dynamic_cast<const AssignExpression*>(&instruction.getExpression()));
+    const VirtualExpression& rvalue = ((const AssignExpression&) instruction.getExpression()).getRValue();
+    if (rvalue.type() != VirtualExpression::TBinaryOperator)
+      return false;
+    assert(dynamic_cast<const BinaryOperatorExpression*>(&rvalue));
+    const BinaryOperatorExpression& binary = (const BinaryOperatorExpression&) rvalue;
+    int constant;
+    if (binary.getOperator() == BinaryOperatorExpression::OPlus) {
+      if (findConstant(binary.getSnd(), constant))
+        variable = m_chains.findVariable(binary.getFst());
+      else if (findConstant(binary.getFst(), constant))
+        variable = m_chains.findVariable(binary.getSnd());
+      else
+        return false;
+      result = add(result, constant);
+    }
+    else if (binary.getOperator() == BinaryOperatorExpression::OMinus) {
+      if (!findConstant(binary.getSnd(), constant))
+        return false;
+      variable = m_chains.findVariable(binary.getFst());
+      result = add(result, multiply(constant, -1));
+    }
+    else
+      return false;
+  };
+  step = result;
+  return true;
+}
+
+void
+InductionVariables::findInductions(int loopIndex) {
+  const NaturalLoops::Loop& loop = m_loops.loop(loopIndex);
+  if (loop.latches.size() != 1)
+    return;
+  assert(dynamic_cast<const GotoInstruction*>(&m_graph.last(loop.latches[0])));
+  const GotoInstruction& latch = (const GotoInstruction&) m_graph.last(loop.latches[0]);
+
+  // the phi functions follow the label of the header
+  VirtualInstruction* instruction = &m_graph.first(loop.header);
+  while (instruction != &m_graph.last(loop.header)) {
+    instruction = instruction->getSNextInstruction();
+    if (instruction->type() != VirtualInstruction::TExpression)
+      break;
+    assert(dynamic_cast<const ExpressionInstruction*>(instruction));
+    ExpressionInstruction& phiInstruction = *(ExpressionInstruction*) instruction;
+    if (!phiInstruction.isPhi())
+      break;
+    const AssignExpression& assign = (const AssignExpression&) phiInstruction.getExpression();
+    int variable = m_chains.findVariable(assign.getLValue());
+    if (variable < 0 || !m_chains.isSSA(variable) || !DefUseChains::isInteger(assign.getLValue()))
+      continue;
+    Induction induction(loopIndex, variable, phiInstruction);
+    const PhiExpression& phi = induction.getPhi();
+    if (phi.countOperands() != 2 || (induction.latchIndex = phi.findOrigin(&latch)) < 0)
+      continue;
+    induction.entryIndex = 1 - induction.latchIndex;
+    const GotoInstruction* entry = phi.getOrigin(induction.entryIndex);
+    if (entry && m_isInLoop[m_graph.blockOf(*entry)])
+      continue;
+    induction.nextVariable = m_chains.findVariable(phi.getOperand(induction.latchIndex));
+    if (induction.nextVariable < 0 || !findStep(induction.nextVariable, variable, induction.step)
+        || induction.step == 0)
+      continue;
+    induction.increment = m_chains.getDefinition(induction.nextVariable);
+    m_inductions.push_back(induction);
+  };
+}
+
+const InductionVariables::Induction*
+InductionVariables::findInduction(int loopIndex, const VirtualExpression& expression, int& offset) const {
+  // offset is the step for the value coming from the latch
+  int variable = m_chains.findVariable(expression);
+  if (variable < 0)
+    return NULL;
+  for (std::vector<Induction>::const_iterator inductionIter = m_inductions.begin(); inductionIter != m_inductions.end(); ++inductionIter) {
+    if (inductionIter->loop != loopIndex)
+      continue;
+    if (inductionIter->variable == variable) {
+      offset = 0;
+      return &*inductionIter;
+    };
+    if (inductionIter->nextVariable == variable) {
+      offset = inductionIter->step;
+      return &*inductionIter;
+    };
+  };
+  return NULL;
+}
+
+int
+InductionVariables::findExitingBlock(int loopIndex) const {
+  // the only block of the loop with an edge out of it, -1 if none or many
+  const NaturalLoops::Loop& loop = m_loops.loop(loopIndex);
+  int result = -1;
+  for (std::vector<int>::const_iterator blockIter = loop.blocks.begin(); blockIter != loop.blocks.end(); ++blockIter) {
+    if (m_graph.last(*blockIter).type() == VirtualInstruction::TReturn)
+      return -1;
+    for (int index = 0; index < m_graph.countSuccessors(*blockIter); ++index) {
+      if (m_isInLoop[m_graph.successor(*blockIter, index)])
+        continue;
+      if (result >= 0)
+        return -1;
+      result = *blockIter;
+    };
+  };
+  return result;
+}
+
+void
+InductionVariables::computeTripCount(int loopIndex) {
+  const NaturalLoops::Loop& loop = m_loops.loop(loopIndex);
+  int exiting = findExitingBlock(loopIndex);
+  if (loop.latches.size() != 1 || exiting < 0 || !m_graph.dominates(exiting, loop.latches[0]))
+    return;
+  // the test is executed once per iteration when it is out of the nested loops
+  for (int index = 0; index < m_loops.count(); ++index) {
+    const NaturalLoops::Loop& nested = m_loops.loop(index);
+    if (index != loopIndex && m_isInLoop[nested.header]
+        && std::find(nested.blocks.begin(), nested.blocks.end(), exiting) != nested.blocks.end())
+      return;
+  };
+  if (m_graph.last(exiting).type() != VirtualInstruction::TIf)
+    return;
+  assert(dynamic_cast<const IfInstruction*>(&m_graph.last(exiting)));
+  const IfInstruction& test = (const IfInstruction&) m_graph.last(exiting);
+  if (!test.getSThenInstruction() || !test.getSNextInstruction()
+      || test.getExpression().type() != VirtualExpression::TComparison)
+    return;
+  bool doesThenStay = m_isInLoop[m_graph.blockOf(*test.getSThenInstruction())];
+  if (doesThenStay == m_isInLoop[m_graph.blockOf(*test.getSNextInstruction())])
+    return;
+  assert(dynamic_cast<const ComparisonExpression*>(&test.getExpression()));
+  const ComparisonExpression& comparison = (const ComparisonExpression&) test.getExpression();
+  ComparisonExpression::Operator operatorCode = comparison.getOperator();
+  int offset = 0, bound = 0, start = 0;
+  const Induction* induction = findInduction(loopIndex, comparison.getFst(), offset);
+  if (!induction || !findConstant(comparison.getSnd(), bound)) {
+    induction = findInduction(loopIndex, comparison.getSnd(), offset);
+    if (!induction || !findConstant(comparison.getFst(), bound))
+      return;
+    operatorCode = mirror(operatorCode);
+  };
+  if (!findConstant(induction->getPhi().getOperand(induction->entryIndex), start))
+    return;
+  if (!doesThenStay)
+    operatorCode = negate(operatorCode);
+
+  // the loop goes on while first + n*step operatorCode limit, n counting
+  // the iterations, and exitIteration is the first n failing it
+  long first = (long) start + offset, step = induction->step, limit = bound;
+  if (operatorCode == ComparisonExpression::OCompareGreater
+      || operatorCode == ComparisonExpression::OCompareGreaterOrEqual) {
+    first = -first;
+    step = -step;
+    limit = -limit;
+    operatorCode = mirror(operatorCode);
+  };
+  if (operatorCode == ComparisonExpression::OCompareLessOrEqual) {
+    ++limit;
+    operatorCode = ComparisonExpression::OCompareLess;
+  };
+  long exitIteration;
+  if (operatorCode == ComparisonExpression::OCompareLess) {
+    if (first >= limit)
+      exitIteration = 0;
+    else if (step <= 0)
+      return;
+    else
+      exitIteration = (limit - first + step - 1) / step;
+  }
+  else if (operatorCode == ComparisonExpression::OCompareEqual)
+    exitIteration = (first == limit) ? 1 : 0;
+  else if (operatorCode == ComparisonExpression::OCompareDifferent) {
+    if ((limit - first) % step != 0 || (limit - first) / step < 0)
+      return;
+    exitIteration = (limit - first) / step;
+  }
+  else
+    return;
+  // the values reached must not wrap
+  long last = first + exitIteration * step;
+  if (exitIteration >= INT_MAX || last > INT_MAX || last < -INT_MAX)
+    return;
+  m_loops.header(loop).setTripCount((int) exitIteration + 1);
+  ++m_tripCounts;
+}
+
+LocalVariableExpression*
+InductionVariables::newVariable(const Induction& induction) {
+  // declared with the induction variable, from which it takes the name
+  const LocalVariableExpression& model = induction.getVariable();
+  Scope scope(model.scope());
+  int ident = scope.count();
+  int localIndex = scope.addSSADeclaration(model.getLocalScope(), ident);
+  return new (m_function.arena()) LocalVariableExpression(model.getName(), localIndex, scope);
+}
+
+const InductionVariables::Reduction&
+InductionVariables::findReduction(const Induction& induction, int factor, std::map<int, Reduction>& reductions) {
+  std::map<int, Reduction>::const_iterator found = reductions.find(factor);
+  if (found != reductions.end())
+    return found->second;
+  Reduction reduction(newVariable(induction), newVariable(induction));
+  Arena& arena = m_function.arena();
+
+  // entry value, computed in the preheader when it is not a constant
+  VirtualExpression* entry;
+  int start;
+  const VirtualExpression& entryValue = induction.getPhi().getOperand(induction.entryIndex);
+  if (findConstant(entryValue, start))
+    entry = new (arena) ConstantExpression(multiply(start, factor));
+  else {
+    LocalVariableExpression* entryVariable = newVariable(induction);
+    BinaryOperatorExpression* entryProduct = new (arena) BinaryOperatorExpression();
+    entryProduct->setOperator(BinaryOperatorExpression::OTimes)
+      .setFst(entryValue.clone()).setSnd(new (arena) ConstantExpression(factor));
+    AssignExpression* entryAssign = new (arena) AssignExpression();
+    entryAssign->setLValue(entryVariable).setRValue(entryProduct);
+    ExpressionInstruction* entryInstruction = new (arena) ExpressionInstruction();
+    entryInstruction->setExpression(entryAssign);
+    m_function.insertNewInstructionAfter(entryInstruction, m_loops.preheader(m_loops.loop(induction.loop)));
+    entry = entryVariable->clone();
+  };
+
+  // phi function next to the one of the induction variable
+  PhiExpression* phi = new (arena) PhiExpression();
+  for (int index = 0; index < 2; ++index)
+    phi->addOperand((index == induction.entryIndex) ? entry : reduction.second->clone(),
+        induction.getPhi().getOrigin(index));
+  AssignExpression* phiAssign = new (arena) AssignExpression();
+  phiAssign->setLValue(reduction.first).setRValue(phi);
+  ExpressionInstruction* phiInstruction = new (arena) ExpressionInstruction();
+  phiInstruction->setExpression(phiAssign);
+  m_function.insertNewInstructionAfter(phiInstruction, *induction.phi);
+
+  // increment next to the one of the induction variable
+  BinaryOperatorExpression* sum = new (arena) BinaryOperatorExpression();
+  sum->setOperator(BinaryOperatorExpression::OPlus).setFst(reduction.first->clone())
+    .setSnd(new (arena) ConstantExpression(multiply(induction.step, factor)));
+  AssignExpression* incrementAssign = new (arena) AssignExpression();
+  incrementAssign->setLValue(reduction.second->clone()).setRValue(sum);
+  ExpressionInstruction* incrementInstruction = new (arena) ExpressionInstruction();
+  incrementInstruction->setExpression(incrementAssign);
+  m_function.insertNewInstructionAfter(incrementInstruction, *induction.increment);
+  return reductions.insert(std::make_pair(factor, reduction)).first->second;
+}
+
+VirtualExpression*
+InductionVariables::reduceProducts(VirtualExpression& expression, const Induction& induction,
+    std::map<int, Reduction>& reductions) {
+  // returns the variable replacing expression, NULL to keep it
+  VirtualExpression* replacement;
+  switch (expression.type()) {
+    case VirtualExpression::TComparison:
+      {  assert(dynamic_cast<const ComparisonExpression*>(&expression));
+        ComparisonExpression& comparison = (ComparisonExpression&) expression;
+        if ((replacement = reduceProducts(comparison.getFst(), induction, reductions)) != NULL)
+          comparison.setFst(replacement);
+        if ((replacement = reduceProducts(comparison.getSnd(), induction, reductions)) != NULL)
+          comparison.setSnd(replacement);
+      };
+      break;
+    case VirtualExpression::TBinaryOperator:
+      {  assert(dynamic_cast<const BinaryOperatorExpression*>(&expression));
+        BinaryOperatorExpression& binary = (BinaryOperatorExpression&) expression;
+        if (binary.getOperator() == BinaryOperatorExpression::OTimes) {
+          int factor;
+          int variable = m_chains.findVariable(binary.getFst());
+          if (!findConstant(binary.getSnd(), factor)) {
+            variable = m_chains.findVariable(binary.getSnd());
+            if (!findConstant(binary.getFst(), factor))
+              variable = -1;
+          };
+          if (variable >= 0 && (variable == induction.variable || variable == induction.nextVariable)) {
+            const Reduction& reduction = findReduction(induction, factor, reductions);
+            ++m_reducedMultiplications;
+            return ((variable == induction.variable) ? reduction.first : reduction.second)->clone();
+          };
+        };
+        if ((replacement = reduceProducts(binary.getFst(), induction, reductions)) != NULL)
+          binary.setFst(replacement);
+        if ((replacement = reduceProducts(binary.getSnd(), induction, reductions)) != NULL)
+          binary.setSnd(replacement);
+      };
+      break;
+    case VirtualExpression::TUnaryOperator:
+      assert(dynamic_cast<const UnaryOperatorExpression*>(&expression));
+      if ((replacement = reduceProducts(((UnaryOperatorExpression&) expression).getSubExpression(), induction, reductions)) != NULL)
+        ((UnaryOperatorExpression&) expression).setSubExpression(replacement);
+      break;
+    case VirtualExpression::TCast:
+      assert(dynamic_cast<const CastExpression*>(&expression));
+      if ((replacement = reduceProducts(((CastExpression&) expression).getSubExpression(), induction, reductions)) != NULL)
+        ((CastExpression&) expression).setSubExpression(replacement);
+      break;
+    case VirtualExpression::TFunctionCall:
+      {  assert(dynamic_cast<const FunctionCallExpression*>(&expression));
+        FunctionCallExpression& call = (FunctionCallExpression&) expression;
+        for (int index = 0; index < call.countArguments(); ++index)
+          if ((replacement = reduceProducts(call.getArgument(index), induction, reductions)) != NULL)
+            call.setArgument(index, replacement);
+      };
+      break;
+    case VirtualExpression::TAssign:
+      {  assert(dynamic_cast<const AssignExpression*>(&expression));
+        AssignExpression& assign = (AssignExpression&) expression;
+        if ((replacement = reduceProducts(assign.getRValue(), induction, reductions)) != NULL)
+          assign.setRValue(replacement);
+      };
+      break;
+    default:
+      break;
+  };
+  return NULL;
+}
+
+void
+InductionVariables::reduce(const Induction& induction) {
+  std::map<int, Reduction> reductions;
+  const int variables[2] = { induction.variable, induction.nextVariable };
+  for (int variableIndex = 0; variableIndex < 2; ++variableIndex) {
+    for (int index = 0; index < m_chains.countUses(variables[variableIndex]); ++index) {
+      VirtualInstruction& use = m_chains.use(variables[variableIndex], index);
+      if (!m_isInLoop[m_graph.blockOf(use)])
+        continue;
+      if (use.type() == VirtualInstruction::TExpression) {
+        assert(dynamic_cast<const ExpressionInstruction*>(&use));
+        ExpressionInstruction& instruction = (ExpressionInstruction&) use;
+        VirtualExpression* replacement;
+        if (!instruction.isPhi()
+            && (replacement = reduceProducts(instruction.getExpression(), induction, reductions)) != NULL)
+          instruction.setExpression(replacement);
+      }
+      else if (use.type() == VirtualInstruction::TIf) {
+        assert(dynamic_cast<const IfInstruction*>(&use));
+        IfInstruction& test = (IfInstruction&) use;
+        VirtualExpression* replacement = reduceProducts(test.getExpression(), induction, reductions);
+        if (replacement)
+          test.setExpression(replacement);
+      };
+    };
+  };
+}
+
+void
+InductionVariables::analyze() {
+  for (int index = 0; index < m_loops.count(); ++index) {
+    markLoop(m_loops.loop(index), true);
+    findInductions(index);
+    computeTripCount(index);
+    markLoop(m_loops.loop(index), false);
+  };
+}
+
+void
+InductionVariables::reduceStrength() {
+  for (std::vector<Induction>::const_iterator inductionIter = m_inductions.begin(); inductionIter != m_inductions.end(); ++inductionIter) {
+    const NaturalLoops::Loop& loop = m_loops.loop(inductionIter->loop);
+    markLoop(loop, true);
+    reduce(*inductionIter);
+    markLoop(loop, false);
+  };
+}
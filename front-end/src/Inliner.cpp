@@ -0,0 +1,595 @@
+#include "Inliner.h"
+#include "Loops.h"
+#include "CodeGenerator.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+// beyond, the loops do not scale the threshold any more
+const int MaxWeightedDepth = 4;
+// growth saved by a constant argument
+const int ConstantArgumentBonus = 2;
+
+// operand of a dereference or of a reference, which share their type
+VirtualExpression&
+operandOf(VirtualExpression& expression) {
+  if (dynamic_cast<const ReferenceExpression*>(&expression))
+    return ((ReferenceExpression&) expression).getSubExpression();
+  assert(dynamic_cast<const DereferenceExpression*>(&expression));
+  return ((DereferenceExpression&) expression).getSubExpression();
+}
+
+// expression of an instruction evaluating one, NULL for the other ones
+VirtualExpression*
+expressionOf(VirtualInstruction& instruction) {
+  if (instruction.type() == VirtualInstruction::TExpression) {
+    assert(dynamic_cast<const ExpressionInstruction*>(&instruction));
+    return &((ExpressionInstruction&) instruction).getExpression();
+  };
+  if (instruction.type() == VirtualInstruction::TReturn) {
+    assert(dynamic_cast<const ReturnInstruction*>(&instruction));
+    return &((ReturnInstruction&) instruction).getResult();
+  };
+  if (instruction.type() == VirtualInstruction::TIf) {
+    assert(dynamic_cast<const IfInstruction*>(&instruction));
+    return &((IfInstruction&) instruction).getExpression();
+  };
+  return NULL;
+}
+
+void
+setExpressionOf(VirtualInstruction& instruction, VirtualExpression* expression) {
+  if (instruction.type() == VirtualInstruction::TExpression)
+    ((ExpressionInstruction&) instruction).setExpression(expression);
+  else if (instruction.type() == VirtualInstruction::TReturn)
+    ((ReturnInstruction&) instruction).setResult(expression);
+  else {
+    assert(instruction.type() == VirtualInstruction::TIf);
+    ((IfInstruction&) instruction).setExpression(expression);
+  };
+}
+
+// calls of expression in the order of the evaluation, each one after its
+// arguments and with the number of calls in its arguments
+void
+listCalls(VirtualExpression& expression, std::vector<std::pair<FunctionCallExpression*, int> >& calls) {
+  switch (expression.type()) {
+    case VirtualExpression::TComparison:
+      {  ComparisonExpression& comparison = (ComparisonExpression&) expression;
+        listCalls(comparison.getFst(), calls);
+        listCalls(comparison.getSnd(), calls);
+      };
+      break;
+    case VirtualExpression::TBinaryOperator:
+      {  BinaryOperatorExpression& binary = (BinaryOperatorExpression&) expression;
+        listCalls(binary.getFst(), calls);
+        listCalls(binary.getSnd(), calls);
+      };
+      break;
+    case VirtualExpression::TUnaryOperator:
+      listCalls(((UnaryOperatorExpression&) expression).getSubExpression(), calls);
+      break;
+    case VirtualExpression::TDereference:
+      listCalls(operandOf(expression), calls);
+      break;
+    case VirtualExpression::TCast:
+      listCalls(((CastExpression&) expression).getSubExpression(), calls);
+      break;
+    case VirtualExpression::TFunctionCall:
+      {  FunctionCallExpression& call = (FunctionCallExpression&) expression;
+        int start = calls.size();
+        // the arguments are evaluated from the last one
+        for (int index = call.countArguments()-1; index >= 0; --index)
+          listCalls(call.getArgument(index), calls);
+        calls.push_back(std::make_pair(&call, (int) calls.size()-start));
+      };
+      break;
+    case VirtualExpression::TAssign:
+      {  AssignExpression& assign = (AssignExpression&) expression;
+        // the address of a dereference is computed before the value
+        if (assign.getLValue().type() == VirtualExpression::TDereference)
+          listCalls(assign.getLValue(), calls);
+        listCalls(assign.getRValue(), calls);
+      };
+      break;
+    default:
+      break;
+  };
+}
+
+// replaces the operand old of expression, or of its operands, by replacement
+bool
+replace(VirtualExpression& expression, const VirtualExpression& old, VirtualExpression* replacement) {
+  switch (expression.type()) {
+    case VirtualExpression::TComparison:
+      {  ComparisonExpression& comparison = (ComparisonExpression&) expression;
+        if (&comparison.getFst() == &old)
+          comparison.setFst(replacement);
+        else if (&comparison.getSnd() == &old)
+          comparison.setSnd(replacement);
+        else
+          return replace(comparison.getFst(), old, replacement) || replace(comparison.getSnd(), old, replacement);
+        return true;
+      };
+    case VirtualExpression::TBinaryOperator:
+      {  BinaryOperatorExpression& binary = (BinaryOperatorExpression&) expression;
+        if (&binary.getFst() == &old)
+          binary.setFst(replacement);
+        else if (&binary.getSnd() == &old)
+          binary.setSnd(replacement);
+        else
+          return replace(binary.getFst(), old, replacement) || replace(binary.getSnd(), old, replacement);
+        return true;
+      };
+    case VirtualExpression::TUnaryOperator:
+      {  UnaryOperatorExpression& unary = (UnaryOperatorExpression&) expression;
+        if (&unary.getSubExpression() != &old)
+          return replace(unary.getSubExpression(), old, replacement);
+        unary.setSubExpression(replacement);
+        return true;
+      };
+    case VirtualExpression::TDereference:
+      if (&operandOf(expression) != &old)
+        return replace(operandOf(expression), old, replacement);
+      if (dynamic_cast<const ReferenceExpression*>(&expression))
+        ((ReferenceExpression&) expression).setSubExpression(replacement);
+      else
+        ((DereferenceExpression&) expression).setSubExpression(replacement);
+      return true;
+    case VirtualExpression::TCast:
+      {  CastExpression& cast = (CastExpression&) expression;
+        if (&cast.getSubExpression() != &old)
+          return replace(cast.getSubExpression(), old, replacement);
+        cast.setSubExpression(replacement);
+        return true;
+      };
+    case VirtualExpression::TFunctionCall:
+      {  FunctionCallExpression& call = (FunctionCallExpression&) expression;
+        for (int index = 0; index < call.countArguments(); ++index) {
+          if (&call.getArgument(index) == &old) {
+            call.setArgument(index, replacement);
+            return true;
+          };
+          if (replace(call.getArgument(index), old, replacement))
+            return true;
+        };
+        return false;
+      };
+    case VirtualExpression::TAssign:
+      {  AssignExpression& assign = (AssignExpression&) expression;
+        if (&assign.getLValue() == &old)
+          assign.setLValue(replacement);
+        else if (&assign.getRValue() == &old)
+          assign.setRValue(replacement);
+        else
+          return replace(assign.getLValue(), old, replacement) || replace(assign.getRValue(), old, replacement);
+        return true;
+      };
+    default:
+      return false;
+  };
+}
+
+}
+
+Inliner::Inliner(Function& function, int threshold)
+  :  m_function(function), m_threshold(threshold), m_size(size(function)),
+    m_maxSize(2*m_size + threshold), m_copies(0), m_inlinedCalls(0), m_callee(NULL),
+    m_scope(NULL), m_parameters(0) {}
+
+int
+Inliner::countNodes(const VirtualExpression& expression) {
+  VirtualExpression& operand = const_cast<VirtualExpression&>(expression);
+  switch (expression.type()) {
+    case VirtualExpression::TComparison:
+      return 1 + countNodes(((const ComparisonExpression&) expression).getFst())
+        + countNodes(((const ComparisonExpression&) expression).getSnd());
+    case VirtualExpression::TBinaryOperator:
+      return 1 + countNodes(((const BinaryOperatorExpression&) expression).getFst())
+        + countNodes(((const BinaryOperatorExpression&) expression).getSnd());
+    case VirtualExpression::TUnaryOperator:
+      return 1 + countNodes(((const UnaryOperatorExpression&) expression).getSubExpression());
+    case VirtualExpression::TDereference:
+      return 1 + countNodes(operandOf(operand));
+    case VirtualExpression::TCast:
+      return 1 + countNodes(((const CastExpression&) expression).getSubExpression());
+    case VirtualExpression::TFunctionCall:
+      {  const FunctionCallExpression& call = (const FunctionCallExpression&) expression;
+        int result = 1;
+        for (int index = 0; index < call.countArguments(); ++index)
+          result += countNodes(call.getArgument(index));
+        return result;
+      };
+    case VirtualExpression::TAssign:
+      return 1 + countNodes(((const AssignExpression&) expression).getLValue())
+        + countNodes(((const AssignExpression&) expression).getRValue());
+    default:
+      return 1;
+  };
+}
+
+int
+Inliner::size(const Function& function) {
+  int result = 0;
+  for (int index = 0; index < function.countInstructions(); ++index) {
+    VirtualExpression* expression = expressionOf(function.getInstruction(index));
+    if (expression)
+      result += countNodes(*expression);
+  };
+  return result;
+}
+
+void
+Inliner::findCallees(const Function& function, std::vector<Function*>& callees) {
+  for (int index = 0; index < function.countInstructions(); ++index) {
+    VirtualExpression* expression = expressionOf(function.getInstruction(index));
+    if (!expression)
+      continue;
+    std::vector<std::pair<FunctionCallExpression*, int> > calls;
+    listCalls(*expression, calls);
+    for (std::vector<std::pair<FunctionCallExpression*, int> >::const_iterator callIter = calls.begin();
+        callIter != calls.end(); ++callIter) {
+      Function* callee = &const_cast<Function&>(callIter->first->getFunction());
+      if (std::find(callees.begin(), callees.end(), callee) == callees.end())
+        callees.push_back(callee);
+    };
+  };
+}
+
+void
+Inliner::findScopes(const Function& function, std::vector<Scope>& scopes, std::vector<bool>& isReachable) {
+  // the scope of a block is the one it opens, or the one it closes
+  scopes.assign(function.countInstructions(), function.globalScope());
+  isReachable.assign(function.countInstructions(), false);
+  std::vector<std::pair<VirtualInstruction*, Scope> > toVisit;
+  toVisit.push_back(std::make_pair(&function.getFirstInstruction(), function.globalScope()));
+  while (!toVisit.empty()) {
+    VirtualInstruction& instruction = *toVisit.back().first;
+    Scope scope = toVisit.back().second;
+    toVisit.pop_back();
+    int index = instruction.getRegistrationIndex();
+    if (isReachable[index])
+      continue;
+    isReachable[index] = true;
+    if (instruction.type() == VirtualInstruction::TEnterBlock) {
+      assert(dynamic_cast<const EnterBlockInstruction*>(&instruction));
+      scope = ((const EnterBlockInstruction&) instruction).scope();
+    };
+    scopes[index] = scope;
+    if (instruction.type() == VirtualInstruction::TExitBlock)
+      scope.pop();
+    if (instruction.getSNextInstruction())
+      toVisit.push_back(std::make_pair(instruction.getSNextInstruction(), scope));
+    if (instruction.type() == VirtualInstruction::TIf && ((IfInstruction&) instruction).getSThenInstruction())
+      toVisit.push_back(std::make_pair((VirtualInstruction*) ((IfInstruction&) instruction).getSThenInstruction(), scope));
+  };
+}
+
+int
+Inliner::growth(const FunctionCallExpression& call) const {
+  int result = size(call.getFunction()) - 1 - call.countArguments();
+  for (int index = 0; index < call.countArguments(); ++index) {
+    VirtualExpression::Type type = call.getArgument(index).type();
+    if (type == VirtualExpression::TConstant || type == VirtualExpression::TChar)
+      result -= ConstantArgumentBonus;
+  };
+  return result;
+}
+
+bool
+Inliner::isInlinable(const FunctionCallExpression& call, bool isValueUsed, int depth,
+    const std::set<const Function*>& keptCallees) const {
+  const Function& callee = call.getFunction();
+  if (keptCallees.find(&callee) != keptCallees.end() || CodeGenerator::isExternal(callee)
+      || call.countArguments() != callee.signature().size()
+      || (isValueUsed && !callee.signature().getSResultType()))
+    return false;
+  int result = growth(call);
+  return result <= m_threshold*(1 + std::min(depth, MaxWeightedDepth))
+    && m_size + std::max(result, 0) <= m_maxSize;
+}
+
+int
+Inliner::declare(Scope& scope, const std::string& name, VirtualType* type) {
+  int result = scope.count();
+  scope.addDeclaration(Atoms::intern(name), type);
+  return result;
+}
+
+LocalVariableExpression*
+Inliner::variable(const Scope& scope, int localIndex) {
+  return new (m_function.arena()) LocalVariableExpression(scope.getName(localIndex), localIndex, scope);
+}
+
+Scope
+Inliner::copyTable(const Scope& calleeScope) {
+  TableCopies::const_iterator found = m_tables.find(&calleeScope.symbolTable());
+  if (found != m_tables.end())
+    return found->second.first;
+  // the top table of the callee is already copied, the inner ones are
+  // declared again in the copy of their parent
+  Scope parent(calleeScope);
+  parent.pop();
+  Scope result = copyTable(parent);
+  result.push();
+  std::ostringstream prefix;
+  prefix << m_callee->getName() << '.' << m_copies << '.';
+  for (int index = 0; index < calleeScope.count(); ++index) {
+    std::ostringstream name;
+    name << prefix.str();
+    calleeScope.printName(name, index);
+    declare(result, name.str(), calleeScope.getType(index).clone());
+  };
+  m_tables.insert(std::make_pair(&calleeScope.symbolTable(), std::make_pair(result, 0)));
+  return result;
+}
+
+VirtualExpression*
+Inliner::copy(const VirtualExpression& expression) {
+  Arena& arena = m_function.arena();
+  switch (expression.type()) {
+    case VirtualExpression::TString:
+      return new (arena) StringExpression(((const StringExpression&) expression).getValue());
+    case VirtualExpression::TLocalVariable:
+      {  const LocalVariableExpression& local = (const LocalVariableExpression&) expression;
+        if (!m_callee)
+          return local.clone();
+        Scope scope = copyTable(local.scope());
+        return variable(scope, m_tables[&local.scope().symbolTable()].second + local.getLocalScope());
+      };
+    case VirtualExpression::TParameter:
+      if (!m_callee)
+        return expression.clone();
+      return variable(*m_scope, m_parameters + ((const ParameterExpression&) expression).getIndex());
+    case VirtualExpression::TComparison:
+      {  const ComparisonExpression& comparison = (const ComparisonExpression&) expression;
+        return &(new (arena) ComparisonExpression())->setOperator(comparison.getOperator())
+          .setFst(copy(comparison.getFst())).setSnd(copy(comparison.getSnd()));
+      };
+    case VirtualExpression::TUnaryOperator:
+      {  const UnaryOperatorExpression& unary = (const UnaryOperatorExpression&) expression;
+        return &(new (arena) UnaryOperatorExpression())->setOperator(unary.getOperator())
+          .setSubExpression(copy(unary.getSubExpression()));
+      };
+    case VirtualExpression::TBinaryOperator:
+      {  const BinaryOperatorExpression& binary = (const BinaryOperatorExpression&) expression;
+        return &(new (arena) BinaryOperatorExpression())->setOperator(binary.getOperator())
+          .setFst(copy(binary.getFst())).setSnd(copy(binary.getSnd()));
+      };
+    case VirtualExpression::TDereference:
+      {  VirtualExpression* operand = copy(operandOf(const_cast<VirtualExpression&>(expression)));
+        if (dynamic_cast<const ReferenceExpression*>(&expression))
+          return &(new (arena) ReferenceExpression())->setSubExpression(operand);
+        return &(new (arena) DereferenceExpression())->setSubExpression(operand);
+      };
+    case VirtualExpression::TCast:
+      {  const CastExpression& cast = (const CastExpression&) expression;
+        return &(new (arena) CastExpression())->setType(cast.getCastType().clone())
+          .setSubExpression(copy(cast.getSubExpression()));
+      };
+    case VirtualExpression::TFunctionCall:
+      {  const FunctionCallExpression& call = (const FunctionCallExpression&) expression;
+        FunctionCallExpression* result = new (arena) FunctionCallExpression(const_cast<Function&>(call.getFunction()));
+        for (int index = 0; index < call.countArguments(); ++index)
+          result->addArgument(copy(call.getArgument(index)));
+        return result;
+      };
+    case VirtualExpression::TAssign:
+      {  const AssignExpression& assign = (const AssignExpression&) expression;
+        return &(new (arena) AssignExpression())->setLValue(copy(assign.getLValue()))
+          .setRValue(copy(assign.getRValue()));
+      };
+    default:
+      // the constants and the globals, the phi functions come later
+      assert(expression.type() != VirtualExpression::TPhi);
+      return expression.clone();
+  };
+}
+
+VirtualInstruction*
+Inliner::copy(const VirtualInstruction& instruction, const Scope& calleeScope, int result,
+    std::vector<VirtualInstruction*>& copies) {
+  Arena& arena = m_function.arena();
+  VirtualInstruction* copyInstruction = NULL;
+  switch (instruction.type()) {
+    case VirtualInstruction::TExpression:
+      copyInstruction = &(new (arena) ExpressionInstruction())->setExpression(
+          copy(((const ExpressionInstruction&) instruction).getExpression()));
+      break;
+    case VirtualInstruction::TReturn:
+      {  // the returned value is assigned to the result
+        VirtualExpression* value = copy(((const ReturnInstruction&) instruction).getResult());
+        if (result >= 0)
+          value = &(new (arena) AssignExpression())->setLValue(variable(*m_scope, result)).setRValue(value);
+        copyInstruction = &(new (arena) ExpressionInstruction())->setExpression(value);
+      };
+      break;
+    case VirtualInstruction::TIf:
+      {  const IfInstruction& condition = (const IfInstruction&) instruction;
+        IfInstruction* copyCondition = new (arena) IfInstruction();
+        copyCondition->setExpression(copy(condition.getExpression()));
+        m_function.addNewInstruction(copyCondition);
+        // the gotos of the branches are created with the if
+        if (condition.getSThenInstruction())
+          copies[condition.getSThenInstruction()->getRegistrationIndex()] = &m_function.setThen(*copyCondition);
+        if (condition.getSNextInstruction())
+          copies[condition.getSNextInstruction()->getRegistrationIndex()] = &m_function.setElse(*copyCondition);
+        return copyCondition;
+      };
+    case VirtualInstruction::TGoto:
+      {  GotoInstruction* gotoPoint = new (arena) GotoInstruction();
+        GotoInstruction::Context context = ((const GotoInstruction&) instruction).getContext();
+        if (context == GotoInstruction::CLoop)
+          gotoPoint->setLoop();
+        else if (context == GotoInstruction::CBeforeLabel)
+          gotoPoint->setBeforeLabel();
+        copyInstruction = gotoPoint;
+      };
+      break;
+    case VirtualInstruction::TLabel:
+      copyInstruction = new (arena) LabelInstruction();
+      break;
+    case VirtualInstruction::TEnterBlock:
+      copyInstruction = &(new (arena) EnterBlockInstruction())->setScope(copyTable(calleeScope));
+      break;
+    case VirtualInstruction::TExitBlock:
+      copyInstruction = &(new (arena) ExitBlockInstruction())->setScope(copyTable(calleeScope));
+      break;
+    default:
+      assert(false);
+  };
+  m_function.addNewInstruction(copyInstruction);
+  return copyInstruction;
+}
+
+bool
+Inliner::expand(Site& site, FunctionCallExpression& call) {
+  const Function& callee = call.getFunction();
+  std::vector<Scope> calleeScopes;
+  std::vector<bool> isReachable;
+  findScopes(callee, calleeScopes, isReachable);
+  const VirtualInstruction* exit = NULL;
+  for (int index = 0; index < callee.countInstructions(); ++index)
+    if (isReachable[index] && callee.getInstruction(index).countNexts() == 0) {
+      if (exit)
+        return false;
+      exit = &callee.getInstruction(index);
+    };
+  if (!exit)
+    return false;
+
+  ++m_copies;
+  std::ostringstream prefixOut;
+  prefixOut << callee.getName() << '.' << m_copies;
+  std::string prefix = prefixOut.str();
+  Arena& arena = m_function.arena();
+  VirtualInstruction& instruction = *site.instruction;
+  VirtualInstruction* last = instruction.getSPreviousInstruction();
+  assert(last && last->getSNextInstruction() == &instruction);
+  int first = m_function.countInstructions();
+
+  // the parameters take the arguments, the last one first as for a call
+  m_callee = NULL;
+  m_scope = &site.scope;
+  m_parameters = site.scope.count();
+  const FunctionSignature& signature = callee.signature();
+  for (int index = 0; index < signature.size(); ++index)
+    declare(site.scope, prefix + '.' + Atoms::name(signature.getParameterName(index)),
+        signature.getTypeParameter(index).clone());
+  for (int index = signature.size()-1; index >= 0; --index) {
+    AssignExpression* assign = new (arena) AssignExpression();
+    assign->setLValue(variable(site.scope, m_parameters+index)).setRValue(copy(call.getArgument(index)));
+    ExpressionInstruction* assignInstruction = &(new (arena) ExpressionInstruction())->setExpression(assign);
+    m_function.addNewInstruction(assignInstruction);
+    last->connectTo(*assignInstruction);
+    last = assignInstruction;
+  };
+
+  // the variables of the callee follow, then its result
+  m_callee = &callee;
+  m_tables.clear();
+  const VirtualInstruction& calleeEntry = callee.getFirstInstruction();
+  const Scope& calleeTop = calleeScopes[calleeEntry.getRegistrationIndex()];
+  m_tables.insert(std::make_pair(&calleeTop.symbolTable(), std::make_pair(site.scope, site.scope.count())));
+  for (int index = 0; index < calleeTop.count(); ++index) {
+    std::ostringstream name;
+    name << prefix << '.';
+    calleeTop.printName(name, index);
+    declare(site.scope, name.str(), calleeTop.getType(index).clone());
+  };
+  int result = signature.getSResultType()
+    ? declare(site.scope, prefix, signature.getResultType().clone()) : -1;
+
+  std::vector<VirtualInstruction*> copies(callee.countInstructions(), (VirtualInstruction*) NULL);
+  for (int index = 0; index < callee.countInstructions(); ++index) {
+    const VirtualInstruction& calleeInstruction = callee.getInstruction(index);
+    if (isReachable[index] && &calleeInstruction != &calleeEntry && !copies[index])
+      copies[index] = copy(calleeInstruction, calleeScopes[index], result, copies);
+  };
+  for (int index = 0; index < callee.countInstructions(); ++index) {
+    const VirtualInstruction& calleeInstruction = callee.getInstruction(index);
+    const VirtualInstruction* next = calleeInstruction.getSNextInstruction();
+    if (!copies[index] || !next || calleeInstruction.type() == VirtualInstruction::TIf)
+      continue;
+    VirtualInstruction& copyNext = *copies[next->getRegistrationIndex()];
+    if (next->type() == VirtualInstruction::TLabel
+        && ((const LabelInstruction*) next)->getSGotoInstruction() == &calleeInstruction)
+      ((GotoInstruction*) copies[index])->connectToLabel((LabelInstruction&) copyNext);
+    else
+      copies[index]->connectTo(copyNext);
+  };
+  last->connectTo(*copies[calleeEntry.getSNextInstruction()->getRegistrationIndex()]);
+  last = copies[exit->getRegistrationIndex()];
+  if (exit->type() != VirtualInstruction::TReturn && result >= 0) {
+    // the value of a function ending without return is 0, as in the assembly
+    AssignExpression* assign = new (arena) AssignExpression();
+    assign->setLValue(variable(site.scope, result)).setRValue(new (arena) ConstantExpression(0));
+    ExpressionInstruction* assignInstruction = &(new (arena) ExpressionInstruction())->setExpression(assign);
+    m_function.addNewInstruction(assignInstruction);
+    last->connectTo(*assignInstruction);
+    last = assignInstruction;
+  };
+  last->connectTo(instruction);
+  m_function.registerBefore(first, instruction);
+
+  // the call becomes its result, an instruction only calling is removed
+  VirtualExpression& expression = *expressionOf(instruction);
+  if (&expression != &call)
+    replace(expression, call, variable(site.scope, result));
+  else if (instruction.type() != VirtualInstruction::TExpression)
+    setExpressionOf(instruction, variable(site.scope, result));
+  else
+    m_function.removeInstructions(std::vector<VirtualInstruction*>(1, &instruction));
+  m_callee = NULL;
+  m_scope = NULL;
+  m_tables.clear();
+  return true;
+}
+
+void
+Inliner::apply(const std::set<const Function*>& keptCallees) {
+  if (CodeGenerator::isExternal(m_function))
+    return;
+  ControlFlowGraph graph(m_function);
+  NaturalLoops loops(graph);
+  std::vector<int> depths(graph.countBlocks(), 0);
+  for (int loopIndex = 0; loopIndex < loops.count(); ++loopIndex) {
+    const std::vector<int>& blocks = loops.loop(loopIndex).blocks;
+    for (std::vector<int>::const_iterator blockIter = blocks.begin(); blockIter != blocks.end(); ++blockIter)
+      ++depths[*blockIter];
+  };
+  std::vector<Scope> scopes;
+  std::vector<bool> isReachable;
+  findScopes(m_function, scopes, isReachable);
+  std::vector<Site> sites;
+  for (int index = 0; index < m_function.countInstructions(); ++index) {
+    VirtualInstruction& instruction = m_function.getInstruction(index);
+    if (isReachable[index] && expressionOf(instruction))
+      sites.push_back(Site(instruction, depths[graph.blockOf(instruction)], scopes[index]));
+  };
+  // the graph is left before the registration indexes change
+  std::stable_sort(sites.begin(), sites.end(), Site::isDeeper);
+
+  for (std::vector<Site>::iterator siteIter = sites.begin(); siteIter != sites.end(); ++siteIter) {
+    VirtualInstruction& instruction = *siteIter->instruction;
+    std::vector<std::pair<FunctionCallExpression*, int> > calls;
+    listCalls(*expressionOf(instruction), calls);
+    // calls before firstKept have been expanded, or are in the arguments of
+    // the current call
+    int firstKept = calls.size();
+    for (int index = 0; index < (int) calls.size(); ++index) {
+      FunctionCallExpression& call = *calls[index].first;
+      bool isValueUsed = (index+1 < (int) calls.size()) || instruction.type() != VirtualInstruction::TExpression
+        || expressionOf(instruction) != &call;
+      int callGrowth = growth(call);
+      if (firstKept >= index - calls[index].second
+          && isInlinable(call, isValueUsed, siteIter->depth, keptCallees) && expand(*siteIter, call)) {
+        m_size += std::max(callGrowth, 0);
+        ++m_inlinedCalls;
+      }
+      else
+        firstKept = std::min(firstKept, index);
+    };
+  };
+}
@@ -0,0 +1,169 @@
+#include "Interpreter.h"
+#include <pthread.h>
+
+Interpreter::Interpreter(const Bytecode& bytecode, int stackSize)
+  :  m_bytecode(bytecode), m_stack(stackSize), m_overflow(-1), m_nativeLimit(0) {
+  // the stack of the thread, main or not, grows down to its lowest address;
+  // the calls may use half of what is left below this frame
+  char top;
+  size_t nativeTop = (size_t) &top;
+  pthread_attr_t attributes;
+  void* lowest = NULL;
+  size_t size = 0;
+  if (pthread_getattr_np(pthread_self(), &attributes) == 0) {
+    if (pthread_attr_getstack(&attributes, &lowest, &size) != 0)
+      lowest = NULL;
+    pthread_attr_destroy(&attributes);
+  };
+  if (lowest && (size_t) lowest < nativeTop)
+    m_nativeLimit = nativeTop - (nativeTop - (size_t) lowest) / 2;
+  else if (nativeTop > NativeFallbackSize)
+    m_nativeLimit = nativeTop - NativeFallbackSize;
+#ifdef FEATHER_THREADED_DISPATCH
+  void* const* labels = (void* const*) execute(-1, NULL);
+#endif
+  m_codes.resize(bytecode.countProcedures());
+  for (int procedureIndex = 0; procedureIndex < bytecode.countProcedures(); ++procedureIndex) {
+    const std::vector<long>& source = bytecode.procedure(procedureIndex).code;
+    std::vector<long>& code = m_codes[procedureIndex];
+    code = source;
+    // the jump targets become addresses in the code
+    for (int index = 0; index < (int) source.size(); index += Bytecode::size(&source[index])) {
+      const char* operands = Bytecode::format((Bytecode::Operation) source[index]);
+      for (int formatIndex = 0; operands[formatIndex]; ++formatIndex)
+        if (operands[formatIndex] == 't')
+          code[index+1+formatIndex] = (long) &code[source[index+1+formatIndex]];
+#ifdef FEATHER_THREADED_DISPATCH
+      code[index] = (long) labels[source[index]];
+#endif
+    };
+  };
+}
+
+bool
+Interpreter::call(int procedure, const std::vector<long>& arguments, long& result) {
+  const Bytecode::Procedure& callee = m_bytecode.procedure(procedure);
+  m_overflow = -1;
+  if (callee.frameSize > (int) m_stack.size()) {
+    m_overflow = procedure;
+    return false;
+  };
+  long* frame = &m_stack[0];
+  for (int index = 0; index < (int) arguments.size() && index < callee.parameters; ++index)
+    frame[index] = arguments[index];
+  result = execute(procedure, frame);
+  return m_overflow < 0;
+}
+
+long
+Interpreter::execute(int procedureIndex, long* frame) {
+#ifdef FEATHER_THREADED_DISPATCH
+  // in the order of Bytecode::Operation
+  static void* const labels[Bytecode::ONumberOfOperations] = { &&LOMove, &&LOExchange, &&LOAdd,
+    &&LOSubtract, &&LOMultiply, &&LODivide, &&LONegate, &&LONot, &&LOLess, &&LOLessOrEqual,
+    &&LOEqual, &&LODifferent, &&LOGreaterOrEqual, &&LOGreater, &&LOAddPointer, &&LOSubtractPointer,
+    &&LOPointerDifference, &&LOExtendChar, &&LOExtendInt, &&LOLoadChar, &&LOLoadInt, &&LOLoad,
+    &&LOStoreChar, &&LOStoreInt, &&LOStore, &&LOLoadLocalChar, &&LOLoadLocalInt, &&LOAddress,
+    &&LOJump, &&LOJumpIfTrue, &&LOJumpIfLess, &&LOJumpIfLessOrEqual, &&LOJumpIfEqual,
+    &&LOJumpIfDifferent, &&LOJumpIfGreaterOrEqual, &&LOJumpIfGreater, &&LOCall, &&LOCallNative,
+    &&LOReturn };
+  if (procedureIndex < 0)
+    return (long) labels;
+#define OPERATION(operation) L##operation:
+#define NEXT(size) pc += (size); goto *(void*) *pc
+#else
+  if (procedureIndex < 0)
+    return 0;
+#define OPERATION(operation) case Bytecode::operation:
+#define NEXT(size) pc += (size); continue
+#endif
+#define JUMP(target) pc = (const long*) (target); NEXT(0)
+
+  const Bytecode::Procedure& procedure = m_bytecode.procedure(procedureIndex);
+  long* r = frame;
+  for (std::vector<std::pair<int, long> >::const_iterator constantIter = procedure.constants.begin();
+      constantIter != procedure.constants.end(); ++constantIter)
+    r[constantIter->first] = constantIter->second;
+  const long* pc = &m_codes[procedureIndex][0];
+
+#ifdef FEATHER_THREADED_DISPATCH
+  goto *(void*) *pc;
+#else
+  while (true) switch (*pc) {
+#endif
+  OPERATION(OMove) r[pc[1]] = r[pc[2]]; NEXT(3);
+  OPERATION(OExchange) { long value = r[pc[1]]; r[pc[1]] = r[pc[2]]; r[pc[2]] = value; } NEXT(3);
+  // the int operations wrap on 32 bits and are extended again
+  OPERATION(OAdd) r[pc[1]] = (int) ((unsigned) r[pc[2]] + (unsigned) r[pc[3]]); NEXT(4);
+  OPERATION(OSubtract) r[pc[1]] = (int) ((unsigned) r[pc[2]] - (unsigned) r[pc[3]]); NEXT(4);
+  OPERATION(OMultiply) r[pc[1]] = (int) ((unsigned) r[pc[2]] * (unsigned) r[pc[3]]); NEXT(4);
+  OPERATION(ODivide) r[pc[1]] = (int) r[pc[2]] / (int) r[pc[3]]; NEXT(4);
+  OPERATION(ONegate) r[pc[1]] = (int) (0u - (unsigned) r[pc[2]]); NEXT(3);
+  OPERATION(ONot) r[pc[1]] = (r[pc[2]] == 0); NEXT(3);
+  OPERATION(OLess) r[pc[1]] = (r[pc[2]] < r[pc[3]]); NEXT(4);
+  OPERATION(OLessOrEqual) r[pc[1]] = (r[pc[2]] <= r[pc[3]]); NEXT(4);
+  OPERATION(OEqual) r[pc[1]] = (r[pc[2]] == r[pc[3]]); NEXT(4);
+  OPERATION(ODifferent) r[pc[1]] = (r[pc[2]] != r[pc[3]]); NEXT(4);
+  OPERATION(OGreaterOrEqual) r[pc[1]] = (r[pc[2]] >= r[pc[3]]); NEXT(4);
+  OPERATION(OGreater) r[pc[1]] = (r[pc[2]] > r[pc[3]]); NEXT(4);
+  OPERATION(OAddPointer) r[pc[1]] = r[pc[2]] + r[pc[3]]*pc[4]; NEXT(5);
+  OPERATION(OSubtractPointer) r[pc[1]] = r[pc[2]] - r[pc[3]]*pc[4]; NEXT(5);
+  OPERATION(OPointerDifference) r[pc[1]] = (r[pc[2]] - r[pc[3]])/pc[4]; NEXT(5);
+  OPERATION(OExtendChar) r[pc[1]] = (signed char) r[pc[2]]; NEXT(3);
+  OPERATION(OExtendInt) r[pc[1]] = (int) r[pc[2]]; NEXT(3);
+  OPERATION(OLoadChar) r[pc[1]] = *(const signed char*) r[pc[2]]; NEXT(3);
+  OPERATION(OLoadInt) r[pc[1]] = *(const int*) r[pc[2]]; NEXT(3);
+  OPERATION(OLoad) r[pc[1]] = *(const long*) r[pc[2]]; NEXT(3);
+  OPERATION(OStoreChar) *(char*) r[pc[1]] = (char) r[pc[2]]; NEXT(3);
+  OPERATION(OStoreInt) *(int*) r[pc[1]] = (int) r[pc[2]]; NEXT(3);
+  OPERATION(OStore) *(long*) r[pc[1]] = r[pc[2]]; NEXT(3);
+  // the low bytes of a register come first on x86-64
+  OPERATION(OLoadLocalChar) r[pc[1]] = *(const signed char*) &r[pc[2]]; NEXT(3);
+  OPERATION(OLoadLocalInt) r[pc[1]] = *(const int*) &r[pc[2]]; NEXT(3);
+  OPERATION(OAddress) r[pc[1]] = (long) &r[pc[2]]; NEXT(3);
+  OPERATION(OJump) JUMP(pc[1]);
+  OPERATION(OJumpIfTrue) if (r[pc[1]]) { JUMP(pc[2]); } NEXT(3);
+  OPERATION(OJumpIfLess) if (r[pc[1]] < r[pc[2]]) { JUMP(pc[3]); } NEXT(4);
+  OPERATION(OJumpIfLessOrEqual) if (r[pc[1]] <= r[pc[2]]) { JUMP(pc[3]); } NEXT(4);
+  OPERATION(OJumpIfEqual) if (r[pc[1]] == r[pc[2]]) { JUMP(pc[3]); } NEXT(4);
+  OPERATION(OJumpIfDifferent) if (r[pc[1]] != r[pc[2]]) { JUMP(pc[3]); } NEXT(4);
+  OPERATION(OJumpIfGreaterOrEqual) if (r[pc[1]] >= r[pc[2]]) { JUMP(pc[3]); } NEXT(4);
+  OPERATION(OJumpIfGreater) if (r[pc[1]] > r[pc[2]]) { JUMP(pc[3]); } NEXT(4);
+  OPERATION(OCall)
+    {  const Bytecode::Procedure& callee = m_bytecode.procedure(pc[2]);
+      // the frame of the callee follows the one of the caller
+      long* calleeFrame = r + procedure.frameSize;
+      char nativeBottom;
+      if (calleeFrame + callee.frameSize > &m_stack[0] + m_stack.size()
+          || (size_t) &nativeBottom < m_nativeLimit) {
+        m_overflow = pc[2];
+        return 0;
+      };
+      for (int index = 0; index < pc[3] && index < callee.parameters; ++index)
+        calleeFrame[index] = r[pc[4+index]];
+      r[pc[1]] = execute(pc[2], calleeFrame);
+      // the overflow unwinds all the frames
+      if (m_overflow >= 0)
+        return 0;
+    };
+    NEXT(4+pc[3]);
+  OPERATION(OCallNative)
+    {  long arguments[Bytecode::MaxNativeArguments] = { 0 };
+      for (int index = 0; index < pc[3]; ++index)
+        arguments[index] = r[pc[4+index]];
+      r[pc[1]] = m_bytecode.native(pc[2])(arguments[0], arguments[1], arguments[2], arguments[3],
+          arguments[4], arguments[5], arguments[6], arguments[7]);
+    };
+    NEXT(4+pc[3]);
+  OPERATION(OReturn) return r[pc[1]];
+#ifndef FEATHER_THREADED_DISPATCH
+  default:
+    assert(false);
+    return 0;
+  };
+#endif
+
+#undef JUMP
+#undef NEXT
+#undef OPERATION
+}
@@ -0,0 +1,227 @@
+#include "Liveness.h"
+
+namespace {
+
+// events of a block, in the order of the evaluation
+enum Event { EUse, EDefinition, EAddressTaken, EEnd };
+
+}
+
+Liveness::Kind
+Liveness::kind(const VirtualExpression& variable, int& index) {
+  if (variable.type() == VirtualExpression::TLocalVariable) {
+    assert(dynamic_cast<const LocalVariableExpression*>(&variable));
+    index = ((const LocalVariableExpression&) variable).getGlobalIndex();
+    return KLocal;
+  };
+  if (variable.type() == VirtualExpression::TParameter) {
+    assert(dynamic_cast<const ParameterExpression*>(&variable));
+    index = ((const ParameterExpression&) variable).getIndex();
+    return KParameter;
+  };
+  assert(dynamic_cast<const GlobalVariableExpression*>(&variable));
+  index = ((const GlobalVariableExpression&) variable).getIndex();
+  return KGlobal;
+}
+
+int
+Liveness::findVariable(const VirtualExpression& variable) const {
+  int index;
+  const std::vector<int>& variables = m_variables[kind(variable, index)];
+  return (index >= 0 && index < (int) variables.size()) ? variables[index] : -1;
+}
+
+int
+Liveness::addVariable(const VirtualExpression& variable) {
+  int index;
+  std::vector<int>& variables = m_variables[kind(variable, index)];
+  assert(index >= 0);
+  if (index >= (int) variables.size())
+    variables.resize(index+1, -1);
+  if (variables[index] < 0)
+    variables[index] = m_count++;
+  return variables[index];
+}
+
+void
+Liveness::collect(const VirtualExpression& expression, std::vector<int>& events) {
+  switch (expression.type()) {
+    case VirtualExpression::TLocalVariable:
+    case VirtualExpression::TParameter:
+    case VirtualExpression::TGlobalVariable:
+      events.push_back(EEnd*addVariable(expression) + EUse);
+      break;
+    case VirtualExpression::TComparison:
+      assert(dynamic_cast<const ComparisonExpression*>(&expression));
+      collect(((const ComparisonExpression&) expression).getFst(), events);
+      collect(((const ComparisonExpression&) expression).getSnd(), events);
+      break;
+    case VirtualExpression::TBinaryOperator:
+      assert(dynamic_cast<const BinaryOperatorExpression*>(&expression));
+      collect(((const BinaryOperatorExpression&) expression).getFst(), events);
+      collect(((const BinaryOperatorExpression&) expression).getSnd(), events);
+      break;
+    case VirtualExpression::TUnaryOperator:
+      assert(dynamic_cast<const UnaryOperatorExpression*>(&expression));
+      collect(((const UnaryOperatorExpression&) expression).getSubExpression(), events);
+      break;
+    case VirtualExpression::TCast:
+      assert(dynamic_cast<const CastExpression*>(&expression));
+      collect(((const CastExpression&) expression).getSubExpression(), events);
+      break;
+    case VirtualExpression::TDereference:
+      // ReferenceExpression shares the type of DereferenceExpression
+      if (dynamic_cast<const ReferenceExpression*>(&expression)) {
+        const VirtualExpression& subExpression = ((const ReferenceExpression&) expression).getSubExpression();
+        if (subExpression.type() == VirtualExpression::TLocalVariable
+            || subExpression.type() == VirtualExpression::TParameter
+            || subExpression.type() == VirtualExpression::TGlobalVariable)
+          events.push_back(EEnd*addVariable(subExpression) + EAddressTaken);
+        else
+          collect(subExpression, events);
+      }
+      else {
+        assert(dynamic_cast<const DereferenceExpression*>(&expression));
+        collect(((const DereferenceExpression&) expression).getSubExpression(), events);
+      };
+      break;
+    case VirtualExpression::TFunctionCall:
+      {  assert(dynamic_cast<const FunctionCallExpression*>(&expression));
+        const FunctionCallExpression& call = (const FunctionCallExpression&) expression;
+        for (int index = 0; index < call.countArguments(); ++index)
+          collect(call.getArgument(index), events);
+      };
+      break;
+    case VirtualExpression::TAssign:
+      {  assert(dynamic_cast<const AssignExpression*>(&expression));
+        const AssignExpression& assign = (const AssignExpression&) expression;
+        // the right value is read before the left value is written
+        collect(assign.getRValue(), events);
+        const VirtualExpression& lvalue = assign.getLValue();
+        if (lvalue.type() == VirtualExpression::TLocalVariable
+            || lvalue.type() == VirtualExpression::TParameter
+            || lvalue.type() == VirtualExpression::TGlobalVariable)
+          events.push_back(EEnd*addVariable(lvalue) + EDefinition);
+        else
+          collect(lvalue, events);
+      };
+      break;
+    default:
+      // constants; the phi functions are not inserted yet
+      break;
+  };
+}
+
+Liveness::Liveness(const ControlFlowGraph& graph, bool isPruned)
+  :  m_count(0), m_words(0), m_isPruned(isPruned) {
+  int blocks = graph.countBlocks();
+  std::vector<int> events, eventStarts;
+  eventStarts.reserve(blocks+1);
+  eventStarts.push_back(0);
+  for (int block = 0; block < blocks; ++block) {
+    VirtualInstruction* instruction = &graph.first(block);
+    while (true) {
+      int index = instruction->getRegistrationIndex();
+      if (index >= (int) m_blockOf.size())
+        m_blockOf.resize(index+1, -1);
+      m_blockOf[index] = block;
+      if (instruction->type() == VirtualInstruction::TExpression) {
+        assert(dynamic_cast<const ExpressionInstruction*>(instruction));
+        collect(((const ExpressionInstruction&) *instruction).getExpression(), events);
+      }
+      else if (instruction->type() == VirtualInstruction::TIf) {
+        assert(dynamic_cast<const IfInstruction*>(instruction));
+        collect(((const IfInstruction&) *instruction).getExpression(), events);
+      }
+      else if (instruction->type() == VirtualInstruction::TReturn) {
+        assert(dynamic_cast<const ReturnInstruction*>(instruction));
+        collect(((const ReturnInstruction&) *instruction).getResult(), events);
+      };
+      if (instruction == &graph.last(block))
+        break;
+      instruction = instruction->getSNextInstruction();
+    };
+    eventStarts.push_back(events.size());
+  };
+
+  // upward exposed uses and assignments of each block
+  m_words = (m_count+31)/32;
+  std::vector<unsigned> upwardExposed(blocks*m_words, 0U), killed(blocks*m_words, 0U);
+  m_globalNames.assign(m_words, 0U);
+  m_alwaysLive.assign(m_words, 0U);
+  for (int block = 0; block < blocks; ++block) {
+    unsigned* blockExposed = &upwardExposed[block*m_words];
+    unsigned* blockKilled = &killed[block*m_words];
+    for (int index = eventStarts[block]; index < eventStarts[block+1]; ++index) {
+      int variable = events[index] / EEnd;
+      switch (events[index] % EEnd) {
+        case EUse:
+          if (!contain(blockKilled, variable)) {
+            add(blockExposed, variable);
+            add(&m_globalNames[0], variable);
+          };
+          break;
+        case EDefinition:
+          add(blockKilled, variable);
+          break;
+        case EAddressTaken:
+          add(&m_alwaysLive[0], variable);
+          break;
+      };
+    };
+  };
+  if (!m_isPruned)
+    return;
+
+  // backward fixpoint over the postorder, each block visited after its
+  // successors except along the back edges
+  m_liveIns.swap(upwardExposed);
+  const std::vector<int>& order = graph.reversePostorder();
+  std::vector<unsigned> liveOut(m_words);
+  bool hasChanged = true;
+  while (hasChanged) {
+    hasChanged = false;
+    for (std::vector<int>::const_reverse_iterator blockIter = order.rbegin(); blockIter != order.rend(); ++blockIter) {
+      int block = *blockIter;
+      liveOut.assign(m_words, 0U);
+      for (int index = 0; index < graph.countSuccessors(block); ++index) {
+        const unsigned* successorIn = &m_liveIns[graph.successor(block, index)*m_words];
+        for (int word = 0; word < m_words; ++word)
+          liveOut[word] |= successorIn[word];
+      };
+      unsigned* blockIn = &m_liveIns[block*m_words];
+      const unsigned* blockKilled = &killed[block*m_words];
+      for (int word = 0; word < m_words; ++word) {
+        unsigned newIn = blockIn[word] | (liveOut[word] & ~blockKilled[word]);
+        if (newIn != blockIn[word]) {
+          blockIn[word] = newIn;
+          hasChanged = true;
+        };
+      };
+    };
+  };
+}
+
+bool
+Liveness::isGlobalName(const VirtualExpression& variable) const {
+  int index;
+  if (kind(variable, index) == KGlobal)
+    return true;
+  int id = findVariable(variable);
+  return (id >= 0) && (contain(&m_alwaysLive[0], id) || contain(&m_globalNames[0], id));
+}
+
+bool
+Liveness::isLiveAt(const VirtualInstruction& leader, const VirtualExpression& variable) const {
+  assert(m_isPruned);
+  int index;
+  if (kind(variable, index) == KGlobal)
+    return true;
+  int id = findVariable(variable);
+  if (id < 0)
+    return false;
+  if (contain(&m_alwaysLive[0], id))
+    return true;
+  int block = m_blockOf[leader.getRegistrationIndex()];
+  return contain(&m_liveIns[block*m_words], id);
+}
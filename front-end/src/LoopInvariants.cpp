@@ -0,0 +1,123 @@
+#include "LoopInvariants.h"
+#include <algorithm>
+
+LoopInvariantMotion::LoopInvariantMotion(Function& function)
+  :  m_function(function), m_graph(function), m_chains(m_graph), m_naturalLoops(m_graph),
+    m_hoistedInstructions(0), m_loops(0) {
+  m_orderIndexes.assign(m_graph.countBlocks(), -1);
+  const std::vector<int>& order = m_graph.reversePostorder();
+  for (int index = 0; index < (int) order.size(); ++index)
+    m_orderIndexes[order[index]] = index;
+  m_isInLoop.assign(m_graph.countBlocks(), false);
+  m_isHoisted.assign(m_graph.countInstructions(), false);
+  m_lasts.reserve(m_graph.countBlocks());
+  for (int block = 0; block < m_graph.countBlocks(); ++block)
+    m_lasts.push_back(&m_graph.last(block));
+}
+
+bool
+LoopInvariantMotion::isInvariant(const VirtualExpression& expression) const {
+  switch (expression.type()) {
+    case VirtualExpression::TConstant:
+    case VirtualExpression::TChar:
+      return true;
+    case VirtualExpression::TParameter:
+      assert(dynamic_cast<const ParameterExpression*>(&expression));
+      return !m_chains.isAssignedParameter(((const ParameterExpression&) expression).getIndex());
+    case VirtualExpression::TLocalVariable:
+      {  int variable = m_chains.findVariable(expression);
+        const VirtualInstruction* definition = (variable >= 0) ? m_chains.getDefinition(variable) : NULL;
+        return definition && (m_isHoisted[definition->getRegistrationIndex()]
+            || !m_isInLoop[m_graph.blockOf(*definition)]);
+      };
+    case VirtualExpression::TComparison:
+      assert(dynamic_cast<const ComparisonExpression*>(&expression));
+      return isInvariant(((const ComparisonExpression&) expression).getFst())
+        && isInvariant(((const ComparisonExpression&) expression).getSnd());
+    case VirtualExpression::TBinaryOperator:
+      {  assert(dynamic_cast<const BinaryOperatorExpression*>(&expression));
+        const BinaryOperatorExpression& binary = (const BinaryOperatorExpression&) expression;
+        if (binary.getOperator() == BinaryOperatorExpression::ODivide) {
+          if (binary.getSnd().type() != VirtualExpression::TConstant)
+            return false;
+          assert(dynamic_cast<const ConstantExpression*>(&binary.getSnd()));
+          int divisor = ((const ConstantExpression&) binary.getSnd()).value();
+          if (divisor == 0 || divisor == -1)
+            return false;
+        };
+        return isInvariant(binary.getFst()) && isInvariant(binary.getSnd());
+      };
+    case VirtualExpression::TUnaryOperator:
+      assert(dynamic_cast<const UnaryOperatorExpression*>(&expression));
+      return isInvariant(((const UnaryOperatorExpression&) expression).getSubExpression());
+    case VirtualExpression::TCast:
+      assert(dynamic_cast<const CastExpression*>(&expression));
+      return isInvariant(((const CastExpression&) expression).getSubExpression());
+    default:
+      // the globals, the memory accesses and the calls
+      return false;
+  };
+}
+
+bool
+LoopInvariantMotion::isHoistable(const VirtualInstruction& instruction) const {
+  if (instruction.type() != VirtualInstruction::TExpression)
+    return false;
+  assert(dynamic_cast<const ExpressionInstruction*>(&instruction));
+  const ExpressionInstruction& expressionInstruction = (const ExpressionInstruction&) instruction;
+  const VirtualExpression& expression = expressionInstruction.getExpression();
+  if (expression.type() != VirtualExpression::TAssign || expressionInstruction.isPhi())
+    return false;
+  assert(dynamic_cast<const AssignExpression*>(&expression));
+  const AssignExpression& assign = (const AssignExpression&) expression;
+  int variable = m_chains.findVariable(assign.getLValue());
+  if (variable < 0 || !m_chains.isSSA(variable) || m_isHoisted[instruction.getRegistrationIndex()])
+    return false;
+  // the copies and the constants are left to the other passes
+  VirtualExpression::Type type = assign.getRValue().type();
+  return (type == VirtualExpression::TComparison || type == VirtualExpression::TBinaryOperator
+      || type == VirtualExpression::TUnaryOperator || type == VirtualExpression::TCast)
+    && isInvariant(assign.getRValue());
+}
+
+void
+LoopInvariantMotion::hoist(const NaturalLoops::Loop& loop) {
+  ++m_loops;
+  for (std::vector<int>::const_iterator blockIter = loop.blocks.begin(); blockIter != loop.blocks.end(); ++blockIter)
+    m_isInLoop[*blockIter] = true;
+  VirtualInstruction* preheader = &m_naturalLoops.preheader(loop);
+  std::vector<std::pair<int, int> > orderedBlocks;
+  for (std::vector<int>::const_iterator blockIter = loop.blocks.begin(); blockIter != loop.blocks.end(); ++blockIter)
+    orderedBlocks.push_back(std::make_pair(m_orderIndexes[*blockIter], *blockIter));
+  std::sort(orderedBlocks.begin(), orderedBlocks.end());
+
+  // the moved instructions keep their order after the preheader
+  for (std::vector<std::pair<int, int> >::const_iterator blockIter = orderedBlocks.begin(); blockIter != orderedBlocks.end(); ++blockIter) {
+    int block = blockIter->second;
+    VirtualInstruction* instruction = &m_graph.first(block);
+    while (true) {
+      VirtualInstruction* next = (instruction == m_lasts[block]) ? NULL : instruction->getSNextInstruction();
+      if (isHoistable(*instruction)) {
+        // a block never starts with an assignment
+        if (instruction == m_lasts[block])
+          m_lasts[block] = instruction->getSPreviousInstruction();
+        m_function.moveInstructionAfter(*instruction, *preheader);
+        m_isHoisted[instruction->getRegistrationIndex()] = true;
+        preheader = instruction;
+        ++m_hoistedInstructions;
+      };
+      if (!next)
+        break;
+      instruction = next;
+    };
+  };
+  for (std::vector<int>::const_iterator blockIter = loop.blocks.begin(); blockIter != loop.blocks.end(); ++blockIter)
+    m_isInLoop[*blockIter] = false;
+}
+
+void
+LoopInvariantMotion::apply() {
+  for (int index = 0; index < m_naturalLoops.count(); ++index)
+    hoist(m_naturalLoops.loop(index));
+  m_function.invalidateControlFlow();
+}
@@ -0,0 +1,61 @@
+#include "Loops.h"
+#include <algorithm>
+
+NaturalLoops::NaturalLoops(ControlFlowGraph& graph)
+  :  m_graph(graph) {
+  if (!graph.hasDominators())
+    graph.computeDominators();
+  std::vector<int> loopOfHeader(graph.countBlocks(), -1);
+  const std::vector<int>& order = graph.reversePostorder();
+  for (std::vector<int>::const_iterator blockIter = order.begin(); blockIter != order.end(); ++blockIter) {
+    const VirtualInstruction& last = graph.last(*blockIter);
+    if (last.type() != VirtualInstruction::TGoto || !last.getSNextInstruction())
+      continue;
+    assert(dynamic_cast<const GotoInstruction*>(&last));
+    if (!((const GotoInstruction&) last).isLoop())
+      continue;
+    int header = graph.blockOf(*last.getSNextInstruction());
+    if (!graph.dominates(header, *blockIter))
+      continue;
+    if (loopOfHeader[header] < 0) {
+      loopOfHeader[header] = m_loops.size();
+      m_loops.push_back(Loop(header));
+    };
+    m_loops[loopOfHeader[header]].latches.push_back(*blockIter);
+  };
+
+  // the body climbs the predecessors from the latches up to the header
+  std::vector<int> isInBody(graph.countBlocks(), -1);
+  std::vector<Loop> loops;
+  for (int loopIndex = 0; loopIndex < (int) m_loops.size(); ++loopIndex) {
+    Loop& loop = m_loops[loopIndex];
+    isInBody[loop.header] = loopIndex;
+    loop.blocks.push_back(loop.header);
+    std::vector<int> blocksToVisit(loop.latches);
+    while (!blocksToVisit.empty()) {
+      int block = blocksToVisit.back();
+      blocksToVisit.pop_back();
+      if (isInBody[block] == loopIndex || !graph.isReachable(block))
+        continue;
+      isInBody[block] = loopIndex;
+      loop.blocks.push_back(block);
+      for (int index = 0; index < graph.countPredecessors(block); ++index)
+        blocksToVisit.push_back(graph.predecessor(block, index));
+    };
+    const VirtualInstruction* entering = graph.first(loop.header).getSPreviousInstruction();
+    if (entering && isInBody[graph.blockOf(*entering)] != loopIndex)
+      loops.push_back(loop);
+  };
+  m_loops.swap(loops);
+  std::stable_sort(m_loops.begin(), m_loops.end(), isLarger);
+}
+
+VirtualInstruction&
+NaturalLoops::preheader(const Loop& loop) const {
+  VirtualInstruction* result = header(loop).getSPreviousInstruction();
+  assert(result);
+  if (result->type() == VirtualInstruction::TGoto && result->getSPreviousInstruction()
+      && result->getSPreviousInstruction()->type() != VirtualInstruction::TIf)
+    result = result->getSPreviousInstruction();
+  return *result;
+}
@@ -0,0 +1,37 @@
+#include "Parallel.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <vector>
+
+void*
+ParallelLoop::work(void* argument) {
+  ParallelLoop& loop = *((ParallelLoop*) argument);
+  int index;
+  while ((index = __sync_fetch_and_add(&loop.m_next, 1)) < loop.m_count)
+    loop.execute(index);
+  return NULL;
+}
+
+void
+ParallelLoop::run(int count, int threads) {
+  m_count = count;
+  m_next = 0;
+  if (threads > count)
+    threads = count;
+  std::vector<pthread_t> workers;
+  for (int thread = 1; thread < threads; ++thread) {
+    pthread_t worker;
+    if (pthread_create(&worker, NULL, &ParallelLoop::work, this) == 0)
+      workers.push_back(worker);
+  };
+  // the calling thread takes its share of the iterations
+  work(this);
+  for (std::vector<pthread_t>::iterator iter = workers.begin(); iter != workers.end(); ++iter)
+    pthread_join(*iter, NULL);
+}
+
+int
+ParallelLoop::countProcessors() {
+  long result = sysconf(_SC_NPROCESSORS_ONLN);
+  return (result > 0) ? (int) result : 1;
+}
@@ -0,0 +1,69 @@
+#include "ParallelCopy.h"
+
+int
+ParallelCopy::countReads(const std::vector<Move>& pending, const std::string& location) const {
+  int result = 0;
+  for (std::vector<Move>::const_iterator moveIter = pending.begin(); moveIter != pending.end(); ++moveIter)
+    if (moveIter->source == location)
+      ++result;
+  return result;
+}
+
+void
+ParallelCopy::sequentialize(const std::string& temporary, std::vector<Move>& moves) {
+  std::vector<Move> pending, constants;
+  m_removedCopies = 0;
+  for (std::vector<Move>::const_iterator copyIter = m_copies.begin(); copyIter != m_copies.end(); ++copyIter) {
+    if (copyIter->source.empty())
+      constants.push_back(*copyIter);
+    else if (copyIter->source == copyIter->destination)
+      ++m_removedCopies;
+    else
+      pending.push_back(*copyIter);
+  };
+
+  while (!pending.empty()) {
+    bool hasProgressed = false;
+    for (int index = 0; index < (int) pending.size(); ) {
+      if (countReads(pending, pending[index].destination) > 0) {
+        ++index;
+        continue;
+      };
+      moves.push_back(pending[index]);
+      pending.erase(pending.begin() + index);
+      hasProgressed = true;
+    };
+    if (hasProgressed)
+      continue;
+
+    // every destination is still read: pending[0] is in a cycle
+    Move cycle = pending[0];
+    if (isRegister(cycle.source) && isRegister(cycle.destination)) {
+      // the source receives the former value of the destination
+      cycle.isExchange = true;
+      moves.push_back(cycle);
+      pending.erase(pending.begin());
+      for (std::vector<Move>::iterator moveIter = pending.begin(); moveIter != pending.end(); ++moveIter) {
+        if (moveIter->source == cycle.destination)
+          moveIter->source = cycle.source;
+        else if (moveIter->source == cycle.source)
+          moveIter->source = cycle.destination;
+        if (moveIter->source == moveIter->destination)
+          moveIter->source.clear();
+      };
+      // the copy closing a cycle of two registers is done by the exchange
+      for (int index = 0; index < (int) pending.size(); )
+        if (pending[index].source.empty())
+          pending.erase(pending.begin() + index);
+        else
+          ++index;
+    }
+    else {
+      moves.push_back(Move(temporary, cycle.destination, cycle.copy));
+      for (std::vector<Move>::iterator moveIter = pending.begin(); moveIter != pending.end(); ++moveIter)
+        if (moveIter->source == cycle.destination)
+          moveIter->source = temporary;
+    };
+  };
+  moves.insert(moves.end(), constants.begin(), constants.end());
+}
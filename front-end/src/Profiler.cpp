@@ -0,0 +1,174 @@
+#include "Profiler.h"
+#include "SyntaxTree.h"
+#include <iomanip>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <time.h>
+
+namespace {
+
+void
+printJsonString(std::ostream& out, const std::string& text) {
+  out << '"';
+  for (std::string::const_iterator charIter = text.begin(); charIter != text.end(); ++charIter) {
+    if (*charIter == '"' || *charIter == '\\')
+      out << '\\';
+    out << *charIter;
+  };
+  out << '"';
+}
+
+void
+printJsonRecord(std::ostream& out, const PhaseProfiler::Record& record, bool hasFunction) {
+  out << "{ \"phase\": ";
+  printJsonString(out, record.phase);
+  if (hasFunction) {
+    out << ", \"function\": ";
+    if (record.function.empty())
+      out << "null";
+    else
+      printJsonString(out, record.function);
+  };
+  out << ", \"wall_ms\": " << record.wallTime*1000.0 << ", \"cpu_ms\": " << record.cpuTime*1000.0
+    << ", \"peak_rss_kb\": " << record.peakResidentSize << ", \"instructions\": " << record.instructions
+    << ", \"arena_allocations\": " << record.arenaAllocations << ", \"arena_bytes\": " << record.arenaBytes
+    << ", \"tasks\": " << record.tasks << " }";
+}
+
+void
+printTableRecord(std::ostream& out, const PhaseProfiler::Record& record, const std::string& function) {
+  out << std::left << std::setw(16) << record.phase << ' ' << std::setw(20) << function << std::right
+    << std::setw(10) << record.wallTime*1000.0 << std::setw(10) << record.cpuTime*1000.0
+    << std::setw(10) << record.peakResidentSize << std::setw(8) << record.instructions
+    << std::setw(13) << record.arenaAllocations << std::setw(13) << record.arenaBytes << std::setw(9) << record.tasks << '\n';
+}
+
+}
+
+PhaseProfiler::Measure::Measure(PhaseProfiler* profiler, const char* phase, const Function* function)
+  :  m_profiler(profiler), m_function(function) {
+  if (!m_profiler)
+    return;
+  m_start.phase = phase;
+  if (m_function) {
+    m_start.function = m_function->getName();
+    m_start.arenaAllocations = m_function->arena().countAllocations();
+    m_start.arenaBytes = m_function->arena().allocated();
+    m_start.tasks = m_function->countExecutedTasks();
+  };
+  m_start.wallTime = wallTime();
+  m_start.cpuTime = cpuTime();
+}
+
+PhaseProfiler::Measure::~Measure() {
+  if (!m_profiler)
+    return;
+  Record record = m_start;
+  record.wallTime = wallTime() - m_start.wallTime;
+  record.cpuTime = cpuTime() - m_start.cpuTime;
+  record.peakResidentSize = peakResidentSize();
+  if (m_function) {
+    record.instructions = m_function->countInstructions();
+    record.arenaAllocations = m_function->arena().countAllocations() - m_start.arenaAllocations;
+    record.arenaBytes = m_function->arena().allocated() - m_start.arenaBytes;
+    record.tasks = m_function->countExecutedTasks() - m_start.tasks;
+  };
+  m_profiler->add(record);
+}
+
+void
+PhaseProfiler::add(const Record& record) {
+  pthread_mutex_lock(&m_lock);
+  m_records.push_back(record);
+  pthread_mutex_unlock(&m_lock);
+}
+
+void
+PhaseProfiler::sumPhases(std::vector<Record>& totals) const {
+  for (std::vector<Record>::const_iterator recordIter = m_records.begin(); recordIter != m_records.end(); ++recordIter) {
+    std::vector<Record>::iterator totalIter = totals.begin();
+    while (totalIter != totals.end() && std::string(totalIter->phase) != recordIter->phase)
+      ++totalIter;
+    if (totalIter == totals.end()) {
+      totals.push_back(Record());
+      totalIter = totals.end()-1;
+      totalIter->phase = recordIter->phase;
+    };
+    totalIter->wallTime += recordIter->wallTime;
+    totalIter->cpuTime += recordIter->cpuTime;
+    // the peak of the process only grows
+    if (recordIter->peakResidentSize > totalIter->peakResidentSize)
+      totalIter->peakResidentSize = recordIter->peakResidentSize;
+    totalIter->instructions += recordIter->instructions;
+    totalIter->arenaAllocations += recordIter->arenaAllocations;
+    totalIter->arenaBytes += recordIter->arenaBytes;
+    totalIter->tasks += recordIter->tasks;
+  };
+}
+
+void
+PhaseProfiler::printTable(std::ostream& out) const {
+  std::ios::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(3);
+  out << std::left << std::setw(16) << "phase" << ' ' << std::setw(20) << "function" << std::right
+    << std::setw(10) << "wall ms" << std::setw(10) << "cpu ms" << std::setw(10) << "rss kB"
+    << std::setw(8) << "instr" << std::setw(13) << "arena allocs" << std::setw(13) << "arena bytes"
+    << std::setw(9) << "tasks" << '\n';
+  for (std::vector<Record>::const_iterator recordIter = m_records.begin(); recordIter != m_records.end(); ++recordIter)
+    printTableRecord(out, *recordIter, recordIter->function.empty() ? "-" : recordIter->function);
+  std::vector<Record> totals;
+  sumPhases(totals);
+  out << '\n';
+  for (std::vector<Record>::const_iterator totalIter = totals.begin(); totalIter != totals.end(); ++totalIter)
+    printTableRecord(out, *totalIter, "total");
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void
+PhaseProfiler::printJson(std::ostream& out) const {
+  out << "{\n  \"records\": [";
+  for (std::vector<Record>::const_iterator recordIter = m_records.begin(); recordIter != m_records.end(); ++recordIter) {
+    out << (recordIter == m_records.begin() ? "\n    " : ",\n    ");
+    printJsonRecord(out, *recordIter, true);
+  };
+  out << "\n  ],\n  \"phases\": [";
+  std::vector<Record> totals;
+  sumPhases(totals);
+  for (std::vector<Record>::const_iterator totalIter = totals.begin(); totalIter != totals.end(); ++totalIter) {
+    out << (totalIter == totals.begin() ? "\n    " : ",\n    ");
+    printJsonRecord(out, *totalIter, false);
+  };
+  out << "\n  ]\n}\n";
+}
+
+double
+PhaseProfiler::wallTime() {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + now.tv_usec/1000000.0;
+}
+
+double
+PhaseProfiler::cpuTime() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  struct timespec now;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) == 0)
+    return now.tv_sec + now.tv_nsec/1000000000.0;
+#endif
+  return (double) clock() / CLOCKS_PER_SEC;
+}
+
+long
+PhaseProfiler::peakResidentSize() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#ifdef __APPLE__
+  // in bytes on Mac OS X, in kilobytes elsewhere
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
@@ -0,0 +1,236 @@
+#include "RegisterAllocation.h"
+#include <algorithm>
+
+namespace {
+
+// beyond, the loops add no weight and the costs stay in an int
+const int MaxWeightedDepth = 4;
+
+void
+cover(RegisterAllocation::Interval& interval, int position) {
+  if (position < interval.start)
+    interval.start = position;
+  if (position > interval.end)
+    interval.end = position;
+}
+
+}
+
+RegisterAllocation::RegisterAllocation(ControlFlowGraph& graph, const std::vector<int>& layout)
+  :  m_graph(graph), m_chains(graph), m_positions(graph.countInstructions(), -1),
+    m_loopDepths(graph.countBlocks(), 0), m_coalescedCopies(0), m_usedRegisters(0),
+    m_allocatedVariables(0), m_spilledVariables(0) {
+  int position = 0;
+  for (std::vector<int>::const_iterator blockIter = layout.begin(); blockIter != layout.end(); ++blockIter) {
+    const VirtualInstruction* last = &graph.last(*blockIter);
+    for (const VirtualInstruction* instruction = &graph.first(*blockIter); ;
+        instruction = instruction->getSNextInstruction()) {
+      // an instruction reads at its even position and writes after
+      m_positions[instruction->getRegistrationIndex()] = position;
+      position += 2;
+      if (instruction == last)
+        break;
+    };
+  };
+
+  NaturalLoops loops(graph);
+  for (int loopIndex = 0; loopIndex < loops.count(); ++loopIndex) {
+    const std::vector<int>& blocks = loops.loop(loopIndex).blocks;
+    for (std::vector<int>::const_iterator blockIter = blocks.begin(); blockIter != blocks.end(); ++blockIter)
+      ++m_loopDepths[*blockIter];
+  };
+
+  std::vector<int> visits(graph.countBlocks(), -1);
+  std::vector<int> intervalIndexes(m_chains.countVariables(), -1);
+  for (int variable = 0; variable < m_chains.countVariables(); ++variable)
+    if (m_chains.isSSA(variable)) {
+      intervalIndexes[variable] = m_intervals.size();
+      buildInterval(variable, visits);
+    };
+  coalesce(intervalIndexes);
+  std::sort(m_intervals.begin(), m_intervals.end(), isStartingBefore);
+}
+
+int
+RegisterAllocation::weight(int block) const {
+  int result = 1;
+  for (int depth = std::min(m_loopDepths[block], MaxWeightedDepth); depth > 0; --depth)
+    result *= 10;
+  return result;
+}
+
+void
+RegisterAllocation::addUse(Interval& interval, int block, int position) {
+  cover(interval, position);
+  interval.spillCost += weight(block);
+}
+
+void
+RegisterAllocation::extendToDefinition(Interval& interval, int block, int definitionBlock,
+    std::vector<int>& visits) {
+  // the variable is live at the start of block, and at the end of its
+  // predecessors up to the definition
+  std::vector<int> blocksToVisit(1, block);
+  while (!blocksToVisit.empty()) {
+    int liveBlock = blocksToVisit.back();
+    blocksToVisit.pop_back();
+    if (visits[liveBlock] == interval.variable)
+      continue;
+    visits[liveBlock] = interval.variable;
+    cover(interval, m_positions[m_graph.first(liveBlock).getRegistrationIndex()]);
+    for (int index = 0; index < m_graph.countPredecessors(liveBlock); ++index) {
+      int predecessor = m_graph.predecessor(liveBlock, index);
+      if (!m_graph.isReachable(predecessor))
+        continue;
+      cover(interval, m_positions[m_graph.last(predecessor).getRegistrationIndex()]+1);
+      if (predecessor != definitionBlock)
+        blocksToVisit.push_back(predecessor);
+    };
+  };
+}
+
+void
+RegisterAllocation::buildInterval(int variable, std::vector<int>& visits) {
+  const VirtualInstruction& definition = *m_chains.getDefinition(variable);
+  int definitionBlock = m_graph.blockOf(definition);
+  int start = m_positions[definition.getRegistrationIndex()];
+  if (definition.type() == VirtualInstruction::TExpression) {
+    assert(dynamic_cast<const ExpressionInstruction*>(&definition));
+    const ExpressionInstruction& expression = (const ExpressionInstruction&) definition;
+    // a phi function is defined with its label, an assignment inside an
+    // expression may precede reads of the same instruction
+    if (expression.isPhi())
+      start = m_positions[m_graph.first(definitionBlock).getRegistrationIndex()];
+    else if (expression.getExpression().type() == VirtualExpression::TAssign
+        && m_chains.findVariable(((const AssignExpression&) expression.getExpression()).getLValue()) == variable)
+      ++start;
+  };
+  Interval interval(variable, start);
+  interval.spillCost = weight(definitionBlock);
+
+  for (int useIndex = 0; useIndex < m_chains.countUses(variable); ++useIndex) {
+    const VirtualInstruction& use = m_chains.use(variable, useIndex);
+    int block = m_graph.blockOf(use);
+    if (use.type() != VirtualInstruction::TExpression || !((const ExpressionInstruction&) use).isPhi()) {
+      addUse(interval, block, m_positions[use.getRegistrationIndex()]);
+      if (block != definitionBlock)
+        extendToDefinition(interval, block, definitionBlock, visits);
+      continue;
+    };
+    // the operands of a phi function are all handled at its first use
+    if (useIndex > 0 && &m_chains.use(variable, useIndex-1) == &use)
+      continue;
+    assert(dynamic_cast<const AssignExpression*>(&((const ExpressionInstruction&) use).getExpression()));
+    const AssignExpression& assign = (const AssignExpression&) ((const ExpressionInstruction&) use).getExpression();
+    assert(dynamic_cast<const PhiExpression*>(&assign.getRValue()));
+    const PhiExpression& phi = (const PhiExpression&) assign.getRValue();
+    for (int index = 0; index < phi.countOperands(); ++index) {
+      if (m_chains.findVariable(phi.getOperand(index)) != variable)
+        continue;
+      // the operand is read at the end of the predecessor, NULL being the
+      // instruction falling into the label
+      const GotoInstruction* origin = phi.getOrigin(index);
+      int predecessor = origin ? m_graph.blockOf(*origin)
+        : m_graph.blockOf(*m_graph.first(block).getSPreviousInstruction());
+      if (!m_graph.isReachable(predecessor))
+        continue;
+      addUse(interval, predecessor, m_positions[m_graph.last(predecessor).getRegistrationIndex()]+1);
+      if (predecessor != definitionBlock)
+        extendToDefinition(interval, predecessor, definitionBlock, visits);
+      int phiVariable = m_chains.findVariable(assign.getLValue());
+      if (phiVariable >= 0 && m_chains.isSSA(phiVariable) && phiVariable != variable)
+        m_phiCopies.push_back(std::make_pair(-weight(predecessor), std::make_pair(phiVariable, variable)));
+    };
+  };
+  m_intervals.push_back(interval);
+}
+
+void
+RegisterAllocation::coalesce(std::vector<int>& intervalIndexes) {
+  m_classes.resize(m_chains.countVariables());
+  for (int variable = 0; variable < (int) m_classes.size(); ++variable)
+    m_classes[variable] = variable;
+  std::stable_sort(m_phiCopies.begin(), m_phiCopies.end());
+  for (std::vector<std::pair<int, std::pair<int, int> > >::const_iterator copyIter = m_phiCopies.begin();
+      copyIter != m_phiCopies.end(); ++copyIter) {
+    int phiClass = findRoot(copyIter->second.first), operandClass = findRoot(copyIter->second.second);
+    if (phiClass == operandClass) {
+      ++m_coalescedCopies;
+      continue;
+    };
+    Interval& phiInterval = m_intervals[intervalIndexes[phiClass]];
+    const Interval& operandInterval = m_intervals[intervalIndexes[operandClass]];
+    if (phiInterval.end >= operandInterval.start && operandInterval.end >= phiInterval.start)
+      continue;
+    phiInterval.start = std::min(phiInterval.start, operandInterval.start);
+    phiInterval.end = std::max(phiInterval.end, operandInterval.end);
+    phiInterval.spillCost += operandInterval.spillCost;
+    m_classes[operandClass] = phiClass;
+    intervalIndexes[operandClass] = -1;
+    ++m_coalescedCopies;
+  };
+
+  // only the intervals of the classes remain
+  std::vector<Interval> intervals;
+  for (int variable = 0; variable < (int) m_classes.size(); ++variable) {
+    m_classes[variable] = findRoot(variable);
+    if (m_classes[variable] == variable && intervalIndexes[variable] >= 0)
+      intervals.push_back(m_intervals[intervalIndexes[variable]]);
+  };
+  m_intervals.swap(intervals);
+}
+
+void
+RegisterAllocation::allocate(int registers) {
+  m_registers.assign(m_chains.countVariables(), -1);
+  std::vector<bool> isFree(std::max(registers, 0), true);
+  // intervals holding a register
+  std::vector<int> active;
+  for (int intervalIndex = 0; intervalIndex < (int) m_intervals.size(); ++intervalIndex) {
+    const Interval& interval = m_intervals[intervalIndex];
+    int activeIndex = 0;
+    for (std::vector<int>::const_iterator activeIter = active.begin(); activeIter != active.end(); ++activeIter) {
+      const Interval& activeInterval = m_intervals[*activeIter];
+      if (activeInterval.end < interval.start)
+        isFree[m_registers[activeInterval.variable]] = true;
+      else
+        active[activeIndex++] = *activeIter;
+    };
+    active.resize(activeIndex);
+
+    int reg = std::find(isFree.begin(), isFree.end(), true) - isFree.begin();
+    if (reg < (int) isFree.size()) {
+      isFree[reg] = false;
+      m_registers[interval.variable] = reg;
+      active.push_back(intervalIndex);
+      continue;
+    };
+    int spilled = -1;
+    for (int index = 0; index < (int) active.size(); ++index) {
+      const Interval& activeInterval = m_intervals[active[index]];
+      const Interval& candidate = (spilled >= 0) ? m_intervals[active[spilled]] : interval;
+      if (activeInterval.spillCost < candidate.spillCost
+          || (activeInterval.spillCost == candidate.spillCost && activeInterval.end > candidate.end))
+        spilled = index;
+    };
+    if (spilled >= 0) {
+      int spilledVariable = m_intervals[active[spilled]].variable;
+      m_registers[interval.variable] = m_registers[spilledVariable];
+      m_registers[spilledVariable] = -1;
+      active[spilled] = intervalIndex;
+    };
+  };
+
+  m_usedRegisters = m_allocatedVariables = m_spilledVariables = 0;
+  for (int variable = 0; variable < m_chains.countVariables(); ++variable) {
+    if (!m_chains.isSSA(variable))
+      continue;
+    int reg = m_registers[m_classes[variable]];
+    if (reg >= 0) {
+      ++m_allocatedVariables;
+      m_usedRegisters = std::max(m_usedRegisters, reg+1);
+    }
+    else
+      ++m_spilledVariables;
+  };
+}
@@ -0,0 +1,186 @@
+#include "Renaming.h"
+
+SSARenaming::SSARenaming(Function& function)
+  :  m_graph(function.controlFlow()), m_chains(m_graph), m_ident(1) {
+  m_versions.assign(m_chains.countVariables(), -1);
+}
+
+int
+SSARenaming::findVariable(const LocalVariableExpression& local) const {
+  // -1 for a variable left as it is
+  int variable = m_chains.findVariable(local.scope().symbolTable(),
+      local.scope().originalIndex(local.getLocalScope()));
+  return (variable >= 0 && !m_chains.isAddressTaken(variable)) ? variable : -1;
+}
+
+void
+SSARenaming::define(LocalVariableExpression& local, VirtualInstruction& instruction) {
+  int variable = findVariable(local);
+  if (variable < 0)
+    return;
+  Scope& scope = local.scope();
+  scope.setSizeDefinitions();
+  int localIndex = local.getLocalScope();
+  if (scope.hasSSADefinition(localIndex)) {
+    localIndex = scope.addSSADeclaration(localIndex, m_ident);
+    local.setLocalScope(localIndex);
+  };
+  scope.setSSADefinition(localIndex, instruction);
+  m_oldVersions.push_back(std::make_pair(variable, m_versions[variable]));
+  m_versions[variable] = localIndex;
+}
+
+void
+SSARenaming::rename(VirtualExpression& expression, VirtualInstruction& instruction) {
+  switch (expression.type()) {
+    case VirtualExpression::TLocalVariable:
+      {  assert(dynamic_cast<const LocalVariableExpression*>(&expression));
+        LocalVariableExpression& local = (LocalVariableExpression&) expression;
+        int variable = findVariable(local);
+        if (variable >= 0 && m_versions[variable] >= 0)
+          local.setLocalScope(m_versions[variable]);
+      };
+      break;
+    case VirtualExpression::TComparison:
+      assert(dynamic_cast<const ComparisonExpression*>(&expression));
+      rename(((ComparisonExpression&) expression).getFst(), instruction);
+      rename(((ComparisonExpression&) expression).getSnd(), instruction);
+      break;
+    case VirtualExpression::TBinaryOperator:
+      assert(dynamic_cast<const BinaryOperatorExpression*>(&expression));
+      rename(((BinaryOperatorExpression&) expression).getFst(), instruction);
+      rename(((BinaryOperatorExpression&) expression).getSnd(), instruction);
+      break;
+    case VirtualExpression::TUnaryOperator:
+      assert(dynamic_cast<const UnaryOperatorExpression*>(&expression));
+      rename(((UnaryOperatorExpression&) expression).getSubExpression(), instruction);
+      break;
+    case VirtualExpression::TCast:
+      assert(dynamic_cast<const CastExpression*>(&expression));
+      rename(((CastExpression&) expression).getSubExpression(), instruction);
+      break;
+    case VirtualExpression::TDereference:
+      // ReferenceExpression shares the type of DereferenceExpression, its
+      // variable is never renamed
+      if (!dynamic_cast<const ReferenceExpression*>(&expression)) {
+        assert(dynamic_cast<const DereferenceExpression*>(&expression));
+        rename(((DereferenceExpression&) expression).getSubExpression(), instruction);
+      };
+      break;
+    case VirtualExpression::TFunctionCall:
+      {  assert(dynamic_cast<const FunctionCallExpression*>(&expression));
+        FunctionCallExpression& call = (FunctionCallExpression&) expression;
+        for (int index = 0; index < call.countArguments(); ++index)
+          rename(call.getArgument(index), instruction);
+      };
+      break;
+    case VirtualExpression::TAssign:
+      {  // the right value is read before the left one is written
+        assert(dynamic_cast<const AssignExpression*>(&expression));
+        AssignExpression& assign = (AssignExpression&) expression;
+        rename(assign.getRValue(), instruction);
+        VirtualExpression& lvalue = assign.getLValue();
+        if (lvalue.type() == VirtualExpression::TLocalVariable) {
+          assert(dynamic_cast<const LocalVariableExpression*>(&lvalue));
+          define((LocalVariableExpression&) lvalue, instruction);
+        }
+        else if (!DefUseChains::isVariable(lvalue))
+          rename(lvalue, instruction);
+      };
+      break;
+    default:
+      // the phi functions are renamed with their blocks
+      break;
+  };
+}
+
+void
+SSARenaming::fillPhis(int block, int successor) {
+  VirtualInstruction* instruction = &m_graph.first(successor);
+  if (instruction->type() != VirtualInstruction::TLabel)
+    return;
+  // the edge is named by its goto, NULL when the label is reached by falling
+  GotoInstruction* origin = NULL;
+  if (m_graph.last(block).type() == VirtualInstruction::TGoto) {
+    assert(dynamic_cast<GotoInstruction*>(&m_graph.last(block)));
+    origin = (GotoInstruction*) &m_graph.last(block);
+  };
+  for (instruction = instruction->getSNextInstruction(); instruction
+      && instruction->type() == VirtualInstruction::TExpression; instruction = instruction->getSNextInstruction()) {
+    assert(dynamic_cast<const ExpressionInstruction*>(instruction));
+    ExpressionInstruction& phiInstruction = (ExpressionInstruction&) *instruction;
+    if (!phiInstruction.isPhi())
+      break;
+    AssignExpression& assign = (AssignExpression&) phiInstruction.getExpression();
+    assert(dynamic_cast<const LocalVariableExpression*>(&assign.getLValue())
+        && dynamic_cast<const PhiExpression*>(&assign.getRValue()));
+    const LocalVariableExpression& lvalue = (const LocalVariableExpression&) assign.getLValue();
+    // the operand reads the declaration when no definition reaches it
+    LocalVariableExpression* operand = (LocalVariableExpression*) lvalue.clone();
+    int variable = findVariable(lvalue);
+    operand->setLocalScope((variable >= 0 && m_versions[variable] >= 0)
+        ? m_versions[variable] : lvalue.scope().originalIndex(lvalue.getLocalScope()));
+    ((PhiExpression&) assign.getRValue()).setOperand(origin, operand);
+  };
+}
+
+void
+SSARenaming::visitBlock(int block) {
+  VirtualInstruction* instruction = &m_graph.first(block);
+  while (true) {
+    if (instruction->type() == VirtualInstruction::TExpression) {
+      assert(dynamic_cast<const ExpressionInstruction*>(instruction));
+      ExpressionInstruction& expressionInstruction = (ExpressionInstruction&) *instruction;
+      if (expressionInstruction.isPhi()) {
+        AssignExpression& assign = (AssignExpression&) expressionInstruction.getExpression();
+        assert(dynamic_cast<const LocalVariableExpression*>(&assign.getLValue()));
+        define((LocalVariableExpression&) assign.getLValue(), *instruction);
+      }
+      else
+        rename(expressionInstruction.getExpression(), *instruction);
+    }
+    else if (instruction->type() == VirtualInstruction::TIf) {
+      assert(dynamic_cast<const IfInstruction*>(instruction));
+      rename(((IfInstruction&) *instruction).getExpression(), *instruction);
+    }
+    else if (instruction->type() == VirtualInstruction::TReturn) {
+      assert(dynamic_cast<const ReturnInstruction*>(instruction));
+      rename(((ReturnInstruction&) *instruction).getResult(), *instruction);
+    };
+    if (instruction == &m_graph.last(block))
+      break;
+    instruction = instruction->getSNextInstruction();
+  };
+  for (int index = 0; index < m_graph.countSuccessors(block); ++index)
+    fillPhis(block, m_graph.successor(block, index));
+}
+
+void
+SSARenaming::apply() {
+  if (!m_graph.hasDominators())
+    m_graph.computeDominators();
+  // preorder of the dominator tree, each level remembering the versions to
+  // restore when it is left
+  std::vector<std::pair<int, int> > stack;
+  std::vector<int> versionStarts;
+  visitBlock(m_graph.entry());
+  stack.push_back(std::make_pair(m_graph.entry(), 0));
+  versionStarts.push_back(0);
+  while (!stack.empty()) {
+    int block = stack.back().first;
+    int& childIndex = stack.back().second;
+    if (childIndex < m_graph.countChildren(block)) {
+      int child = m_graph.child(block, childIndex++);
+      versionStarts.push_back(m_oldVersions.size());
+      visitBlock(child);
+      stack.push_back(std::make_pair(child, 0));
+    }
+    else {
+      for (int index = m_oldVersions.size()-1; index >= versionStarts.back(); --index)
+        m_versions[m_oldVersions[index].first] = m_oldVersions[index].second;
+      m_oldVersions.resize(versionStarts.back());
+      versionStarts.pop_back();
+      stack.pop_back();
+    };
+  };
+}
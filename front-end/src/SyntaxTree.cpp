@@ -1,27 +1,42 @@
 #include "SyntaxTree.h"
 #include "Algorithms.h"
+#include "ControlFlow.h"
+#include "Liveness.h"
+#include "ConstantPropagation.h"
+#include "ValueNumbering.h"
+#include "LoopInvariants.h"
+#include "InductionVariables.h"
+#include "DeadCode.h"
+#include "Renaming.h"
+#include "Inliner.h"
+#include "CodeGenerator.h"
+#include "Interpreter.h"
+#include "Parallel.h"
+#include "Profiler.h"
 #include <stdio.h>
-
-extern Program::ParseContext parseContext;
-extern FILE *yyin;
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <sstream>
+#include <fstream>
 
-int yyparse ();
-
-int SymbolTable::addSSADeclaration(std::string& name, int localIndex, int& ident)
+int SymbolTable::addSSADeclaration(int localIndex, int& ident)
 {
-  std::stringstream out;
-  out << name << '_' << ident;
+  m_names.push_back(m_names[localIndex]);
+  m_renamedIndexes.push_back(localIndex);
+  m_versions.push_back(ident);
   ++ident;
-  m_localIndexes.insert(std::pair<std::string, int>(name = out.str(), m_types.size()));
-  m_types.push_back(m_types[localIndex]);
+  // each entry owns its type
+  m_types.push_back(m_types[localIndex] ? m_types[localIndex]->clone() : NULL);
   m_uniqueDefinitions.push_back(NULL);
   return m_types.size()-1;
 }
 
 Scope::FindResult
-Scope::find(const std::string& name, int& local, Scope& scope) const {
+Scope::find(Atom name, int& local, Scope& scope) const {
   FindResult result = FRNotFound;
   std::shared_ptr<SymbolTable> current = m_last;
   while (current.get() && result == FRNotFound) {
@@ -43,16 +58,32 @@ int
 Scope::getFunctionIndex(int local) const {
   std::shared_ptr<SymbolTable> current = m_last;
   while (current->m_parent.get()) {
-    local += current->m_parent->m_localIndexes.size();
+    local += current->m_parent->count();
     current = current->m_parent;
   };
   return local;
 }
 
+WorkList::~WorkList() {
+  for (std::vector<VirtualTask*>::iterator iIter = m_tasks.begin();
+  iIter != m_tasks.end(); ++iIter)
+  if (*iIter) delete (*iIter);
+  m_tasks.clear();
+  for (std::vector<int>::iterator indexIter = m_sortedIndexes.begin();
+  indexIter != m_sortedIndexes.end(); ++indexIter) {
+    std::vector<VirtualTask*>& bucket = m_sortedTasks[*indexIter];
+    for (std::vector<VirtualTask*>::iterator iIter = bucket.begin(); iIter != bucket.end(); ++iIter)
+    if (*iIter) delete (*iIter);
+  };
+  m_sortedTasks.clear();
+  m_sortedIndexes.clear();
+}
+
 void
 WorkList::execute() {
-  while (!m_tasks.empty()) {
+  while (!isEmpty()) {
     std::auto_ptr<VirtualTask> current(extractFirst());
+    ++m_executedTasks;
     Reusability reuse;
     current->getInstruction().handle(*current, *this, reuse);
     if (reuse.m_reuse) {
@@ -64,28 +95,53 @@ WorkList::execute() {
   };
 }
 
-void
-WorkList::addNewSorted(VirtualTask* virtualTask) {
+VirtualTask*
+WorkList::extractFirst() {
+  VirtualTask* result;
   if (!m_tasks.empty()) {
-    std::list<VirtualTask*>::iterator iter = m_tasks.begin();
-    std::auto_ptr<VirtualTask> task(virtualTask);
-    Comparison compare = (*iter)->compare(*virtualTask);
-    while (compare < CEqual) {
-      if (++iter != m_tasks.end())
-      compare = (*iter)->compare(*virtualTask);
-      else
-      break;
+    result = m_tasks.back();
+    m_tasks.pop_back();
+  }
+  else {
+    assert(!m_sortedIndexes.empty());
+    std::vector<VirtualTask*>& bucket = m_sortedTasks[m_sortedIndexes.front()];
+    result = bucket.back();
+    bucket.pop_back();
+    if (bucket.empty()) {
+      std::pop_heap(m_sortedIndexes.begin(), m_sortedIndexes.end(), std::greater<int>());
+      m_sortedIndexes.pop_back();
     };
-    if (compare == CEqual)
-    if (!(*iter)->mergeWith(*task))
-    m_tasks.insert(iter, task.release());
-    if (compare == CGreater)
-    m_tasks.insert(iter, task.release());
-    else if (compare == CLess)
-    m_tasks.push_back(task.release());
+  };
+  return result;
+}
+
+void
+WorkList::addNewSorted(VirtualTask* virtualTask) {
+  std::auto_ptr<VirtualTask> task(virtualTask);
+  // As in a single sorted list, the task goes before the first pending task
+  // that is not before it, the tasks added as first included. No traversal
+  // adds a sorted task while tasks added as first are pending, so this scan
+  // is usually empty.
+  for (int position = m_tasks.size(); --position >= 0;) {
+    Comparison compare = m_tasks[position]->compare(*task);
+    if (compare == CLess)
+    continue;
+    if (compare != CEqual || !m_tasks[position]->mergeWith(*task))
+    m_tasks.insert(m_tasks.begin()+position+1, task.release());
+    return;
+  };
+  int index = task->getInstruction().getRegistrationIndex();
+  assert(index >= 0);
+  if (index >= (int) m_sortedTasks.size())
+  m_sortedTasks.resize(index+1);
+  std::vector<VirtualTask*>& bucket = m_sortedTasks[index];
+  if (bucket.empty()) {
+    m_sortedIndexes.push_back(index);
+    std::push_heap(m_sortedIndexes.begin(), m_sortedIndexes.end(), std::greater<int>());
   }
-  else
-  m_tasks.push_back(virtualTask);
+  else if (bucket.back()->mergeWith(*task))
+  return;
+  bucket.push_back(task.release());
 }
 
 void LocalVariableExpression::handle(VirtualTask &vtTask, WorkList& continuations, Reusability& reuse)
@@ -105,113 +161,16 @@ void LocalVariableExpression::handle(VirtualTask &vtTask, WorkList& continuation
       {
         for (std::vector<GotoInstruction*>::const_iterator labelIter = task.m_dominationFrontier->begin(); labelIter != task.m_dominationFrontier->end(); ++labelIter)
         {
-          LabelInstruction& label = (LabelInstruction&) *((*labelIter)->getSNextInstruction());
-          if (!label.mark)
-          {
-            label.mark = new PhiInsertionTask::LabelResult();
-          }
-          PhiInsertionTask::LabelResult& result = *((PhiInsertionTask::LabelResult*) label.mark);
+          assert(dynamic_cast<const PhiInsertionAgenda*>(&continuations));
+          PhiInsertionTask::LabelResult& result = ((PhiInsertionAgenda&) continuations).labelResult(*(*labelIter)->getSNextInstruction());
           if (result.map().find(this) == result.map().end())
           {
-            std::pair<VirtualExpression*, std::pair<GotoInstruction*, GotoInstruction*> > insert;
-            insert.first = this;
-            insert.second.first = NULL;
-            insert.second.second = NULL;
-            result.map().insert(insert);
+            result.map().insert(std::make_pair(this, PhiInsertionTask::Origins()));
           }
         }
       }
     }
   }
-  else if (type == TTRenaming)
-  {
-    assert(dynamic_cast<const RenamingTask*>(&vtTask) && dynamic_cast<const RenamingAgenda*>(&continuations));
-    RenamingTask& task = (RenamingTask&) vtTask;
-    if (task.m_isLValue)
-    {
-      if (!task.m_isOnlyPhi && m_scope.hasSSADefinition(m_localIndex))
-      {
-        RenamingAgenda& remaingContinuations = (RenamingAgenda&) continuations;
-        task.m_localReplace = new LocalVariableExpression(*this);
-        m_localIndex = m_scope.addSSADeclaration(m_name, m_localIndex, remaingContinuations.m_ident);
-      }
-      task.m_localRename = this;
-    }
-    else // !rtTask.m_isLValue
-    {
-      RenamingTask::VariableRenaming locate(*this, task.m_function);
-      std::set<RenamingTask::VariableRenaming>::iterator found = task.m_renamings.find(locate);
-      if (found != task.m_renamings.end())
-      {
-        m_localIndex = found->getNewValue().m_localIndex;
-        m_name = found->getNewValue().m_name;
-      }
-    }
-  }
-}
-
-void
-ComparisonExpression::handle(VirtualTask& task, WorkList& continuations, Reusability& reuse) {
-  int type = task.getType();
-  if (type == TTRenaming) {
-    if (m_fst.get())
-    m_fst->handle(task, continuations, reuse);
-    if (m_snd.get())
-    m_snd->handle(task, continuations, reuse);
-  };
-}
-void
-UnaryOperatorExpression::handle(VirtualTask& task, WorkList& continuations, Reusability& reuse) {
-  int type = task.getType();
-  if (type == TTRenaming) {
-    if (m_subExpression.get())
-    m_subExpression->handle(task, continuations, reuse);
-  };
-}
-void
-BinaryOperatorExpression::handle(VirtualTask& task, WorkList& continuations, Reusability& reuse) {
-  int type = task.getType();
-  if (type == TTRenaming) {
-    if (m_fst.get())
-    m_fst->handle(task, continuations, reuse);
-    if (m_snd.get())
-    m_snd->handle(task, continuations, reuse);
-  };
-}
-void
-DereferenceExpression::handle(VirtualTask& task, WorkList& continuations, Reusability& reuse) {
-  int type = task.getType();
-  if (type == TTRenaming) {
-    if (m_subExpression.get())
-    m_subExpression->handle(task, continuations, reuse);
-  };
-}
-void
-ReferenceExpression::handle(VirtualTask& task, WorkList& continuations, Reusability& reuse) {
-  int type = task.getType();
-  if (type == TTRenaming) {
-    if (m_subExpression.get())
-    m_subExpression->handle(task, continuations, reuse);
-  };
-}
-void
-CastExpression::handle(VirtualTask& task, WorkList& continuations, Reusability& reuse) {
-  int type = task.getType();
-  if (type == TTRenaming) {
-    if (m_subExpression.get())
-    m_subExpression->handle(task, continuations, reuse);
-  };
-}
-void
-FunctionCallExpression::handle(VirtualTask& task, WorkList& continuations, Reusability& reuse) {
-  int type = task.getType();
-  if (type == TTRenaming) {
-    for (std::vector<VirtualExpression*>::const_iterator iter = m_arguments.begin();
-    iter != m_arguments.end(); ++iter) {
-      if (*iter)
-      (*iter)->handle(task, continuations, reuse);
-    };
-  };
 }
 
 void AssignExpression::handle(VirtualTask& vtTask, WorkList& continuations, Reusability& reuse)
@@ -225,84 +184,33 @@ void AssignExpression::handle(VirtualTask& vtTask, WorkList& continuations, Reus
     m_lvalue->handle(task, continuations, reuse);
     task.m_isLValue = false;
   }
-  else if (type == TTRenaming)
-  {
-    assert(dynamic_cast<const RenamingTask*>(&vtTask));
-    RenamingTask& task = (RenamingTask&) vtTask;
-    task.m_isLValue = true;
-    m_lvalue->handle(task, continuations, reuse);
-    task.m_isLValue = false;
-    m_rvalue->handle(task, continuations, reuse);
-  }
 }
 
 void PhiExpression::print(std::ostream& out) const
 {
+  // a join has two operands at least, those not yet known are no-expr
+  int count = (m_operands.size() < 2) ? 2 : m_operands.size();
   out << "phi(";
-  if (m_fst.get())
-  {
-    m_fst->print(out);
-    if (m_fstFrom)
-    {
-      out << ' ' << m_fstFrom->getRegistrationIndex();
-    }
-  }
-  else
-  {
-    out << "no-expr";
-  }
-  out << ", ";
-  if (m_snd.get())
-  {
-    m_snd->print(out);
-    if (m_sndFrom)
-    {
-      out << ' ' << m_sndFrom->getRegistrationIndex();
-    }
-  }
-  else
-  {
-    out << "no-expr";
-  }
-  out << ')';
-}
-
-void PhiExpression::handle(VirtualTask& vtTask, WorkList& continuations, Reusability& reuse)
-{
-  int type = vtTask.getType();
-  if (type == TTRenaming)
+  for (int index = 0; index < count; ++index)
   {
-    assert(dynamic_cast<const RenamingTask*>(&vtTask));
-    RenamingTask& task = (RenamingTask&) vtTask;
-    assert(m_fst.get());
-    if (!m_snd.get())
+    if (index > 0)
     {
-      m_snd.reset(m_fst->clone());
+      out << ", ";
     }
-    if (task.m_previousLabel == m_fstFrom)
+    if (index < m_operands.size())
     {
-      m_fst->handle(task, continuations, reuse);
-    }
-    else if (!m_sndFrom)
-    {
-      m_sndFrom = task.m_previousLabel;
-      std::set<RenamingTask::VariableRenaming>::const_iterator found = task.m_renamings.find(RenamingTask::VariableRenaming(*m_fst, task.m_function));
-      LocalVariableExpression* newValue = NULL;
-      if (found != task.m_renamings.end())
-      {
-        newValue = found->getSDominatorNewValue();
-      }
-      if (newValue)
+      m_operands[index].expression->print(out);
+      if (m_operands[index].origin)
       {
-        m_snd.reset(newValue->clone());
+        out << ' ' << m_operands[index].origin->getRegistrationIndex();
       }
     }
     else
     {
-      assert(task.m_previousLabel == m_sndFrom);
-      m_snd->handle(vtTask, continuations, reuse);
+      out << "no-expr";
     }
   }
+  out << ')';
 }
 
 void
@@ -331,124 +239,6 @@ void ExpressionInstruction::handle(VirtualTask& vtTask, WorkList& continuations,
       m_expression->handle(vtTask, continuations, reuse);
     }
   }
-  else if (type == TTRenaming)
-  {
-    if (m_expression.get())
-    {
-      m_expression->handle(vtTask, continuations, reuse);
-    }
-    assert(dynamic_cast<RenamingTask*>(&vtTask));
-    RenamingTask& task = (RenamingTask&) vtTask;
-    if (task.m_localRename)
-    {
-      if (task.m_localReplace)
-      {
-        std::set<RenamingTask::VariableRenaming>::iterator found = task.m_renamings.find(RenamingTask::VariableRenaming(*task.m_localReplace, task.m_function));
-        if (found != task.m_renamings.end())
-        {
-          const_cast<RenamingTask::VariableRenaming&>(*found).setNewValue(new LocalVariableExpression(*task.m_localRename), task.m_previousLabel ? task.m_previousLabel : (task.m_lastBranch ? task.m_lastBranch->getSPreviousInstruction() : NULL));
-          delete task.m_localReplace;
-          task.m_localReplace = NULL;
-        }
-        else
-        {
-          assert(!task.m_lastBranch || dynamic_cast<IfInstruction*>(task.m_lastBranch->getSPreviousInstruction()));
-          task.m_renamings.insert(RenamingTask::VariableRenaming(task.m_localReplace, new LocalVariableExpression(*task.m_localRename), task.m_function, task.m_previousLabel ? task.m_previousLabel : (task.m_lastBranch ? task.m_lastBranch->getSPreviousInstruction() : NULL)));
-          task.m_localReplace = NULL;
-        }
-      }
-      task.m_localRename->scope().setSSADefinition(task.m_localRename->getLocalScope(), *this);
-      task.m_localRename = NULL;
-    }
-    if (task.m_previousLabel)
-    {
-      bool isLast = true;
-      if (getSNextInstruction() && getSNextInstruction()->type() == TExpression)
-      {
-        assert(dynamic_cast<const ExpressionInstruction*>(getSNextInstruction()));
-        if (((const ExpressionInstruction&) *getSNextInstruction()).isPhi())
-        {
-          isLast = false;
-          if (task.m_isOnlyPhi)
-          {
-            VirtualInstruction::handle(task, continuations, reuse);
-          }
-        }
-      }
-      if (isLast)
-      {
-        assert(dynamic_cast<const LabelInstruction*>(task.m_previousLabel->getSNextInstruction()));
-        VirtualInstruction* dominator = ((LabelInstruction*) task.m_previousLabel->getSNextInstruction())->getSDominator();
-        assert(dominator);
-        std::set<RenamingTask::VariableRenaming>::iterator iter = task.m_renamings.begin();
-        while (iter != task.m_renamings.end())
-        {
-          if (!const_cast<RenamingTask::VariableRenaming&>(*iter).setDominator(*dominator, task.m_previousLabel))
-          {
-            std::set<RenamingTask::VariableRenaming>::iterator nextIter(iter);
-            ++nextIter;
-            const RenamingTask::VariableRenaming* next = (nextIter != task.m_renamings.end()) ? &(*nextIter) : NULL;
-            task.m_renamings.erase(iter);
-            if (next)
-            {
-              iter = task.m_renamings.find(*next);
-            }
-            else
-            {
-              iter = task.m_renamings.end();
-            }
-          }
-          else
-          {
-            ++iter;
-          }
-        }
-        task.m_previousLabel = NULL;
-      }
-      if (task.m_isOnlyPhi)
-      {
-        return;
-      }
-    }
-  }
-  VirtualInstruction::handle(vtTask, continuations, reuse);
-}
-
-void IfInstruction::handle(VirtualTask& vtTask, WorkList& continuations, Reusability& reuse)
-{
-  int type = vtTask.getType();
-  if (type == TTRenaming)
-  {
-    if (m_expression.get())
-    {
-      m_expression->handle(vtTask, continuations, reuse);
-    }
-    assert(dynamic_cast<const RenamingTask*>(&vtTask));
-    RenamingTask& task = (RenamingTask&) vtTask;
-    std::set<RenamingTask::VariableRenaming>::iterator iter = task.m_renamings.begin();
-    while (iter != task.m_renamings.end())
-    {
-      if (!const_cast<RenamingTask::VariableRenaming&>(*iter).setDominator(*this))
-      {
-        std::set<RenamingTask::VariableRenaming>::iterator nextIter(iter);
-        ++nextIter;
-        const RenamingTask::VariableRenaming* next = (nextIter != task.m_renamings.end()) ? &(*nextIter) : NULL;
-        task.m_renamings.erase(iter);
-        if (next)
-        {
-          iter = task.m_renamings.find(*next);
-        }
-        else
-        {
-          iter = task.m_renamings.end();
-        }
-      }
-      else
-      {
-        ++iter;
-      }
-    }
-  }
   VirtualInstruction::handle(vtTask, continuations, reuse);
 }
 
@@ -464,36 +254,9 @@ void GotoInstruction::handle(VirtualTask& vtTask, WorkList& continutations, Reus
     {
       for (std::vector<GotoInstruction*>::const_iterator labelIter = task.m_dominationFrontier->begin(); labelIter != task.m_dominationFrontier->end(); ++labelIter)
       {
-        LabelInstruction& label = (LabelInstruction&) *(*labelIter)->getSNextInstruction();
-        if (!label.mark)
-        {
-          label.mark = new PhiInsertionTask::LabelResult();
-        }
-        ((PhiInsertionTask::LabelResult*) label.mark)->variablesToAdd().insert(task.m_modified.begin(), task.m_modified.end());
-      }
-    }
-  }
-  else if (type == TTRenaming)
-  {
-    assert(dynamic_cast<const RenamingTask*>(&vtTask));
-    RenamingTask& task = (RenamingTask&) vtTask;
-    if ((m_context == CAfterIfThen) || (m_context == CAfterIfElse))
-    {
-      task.m_lastBranch = this;
-    }
-    else if (m_context >= CLoop)
-    {
-      task.m_previousLabel = this;
-      if (getSNextInstruction()->mark)
-      {
-        task.m_isOnlyPhi = true;
-        if (getSNextInstruction())
-        {
-          task.clearInstruction();
-          task.setInstruction(*getSNextInstruction());
-          reuse.setReuse();
-        }
-        return;
+        assert(dynamic_cast<const PhiInsertionAgenda*>(&continutations));
+        PhiInsertionTask::LabelResult& result = ((PhiInsertionAgenda&) continutations).labelResult(*(*labelIter)->getSNextInstruction());
+        result.variablesToAdd().insert(task.m_modified.begin(), task.m_modified.end());
       }
     }
   }
@@ -510,10 +273,8 @@ bool GotoInstruction::propagateOnUnmarked(VirtualTask& vtTask, WorkList& continu
       LabelInstruction& label = (LabelInstruction&) *getSNextInstruction();
       assert(dynamic_cast<const PhiInsertionTask*>(&vtTask));
       PhiInsertionTask &task = (PhiInsertionTask&) vtTask;
-      if (!label.mark)
-      {
-        label.mark = new PhiInsertionTask::LabelResult();
-      }
+      assert(dynamic_cast<const PhiInsertionAgenda*>(&continuations));
+      PhiInsertionTask::LabelResult& labelResult = ((PhiInsertionAgenda&) continuations).labelResult(label);
       bool hasFoundFrontier = false;
       if (task.m_dominationFrontier)
       {
@@ -521,8 +282,8 @@ bool GotoInstruction::propagateOnUnmarked(VirtualTask& vtTask, WorkList& continu
         {
           if ((*labelIter)->getSNextInstruction() == &label)
           {
-            PhiInsertionTask::LabelResult& result = *((PhiInsertionTask::LabelResult*) label.mark);
-            LocalVariableExpression afterLast(std::string(), task.m_scope.count(), task.m_scope);
+            PhiInsertionTask::LabelResult& result = labelResult;
+            LocalVariableExpression afterLast(Atoms::AEmpty, task.m_scope.count(), task.m_scope);
             for (PhiInsertionTask::ModifiedVariables::iterator iter = task.m_modified.begin(); iter != task.m_modified.end(); ++iter)
             {
               if (PhiInsertionTask::IsBefore().operator()(*iter, &afterLast))
@@ -530,18 +291,7 @@ bool GotoInstruction::propagateOnUnmarked(VirtualTask& vtTask, WorkList& continu
                 PhiInsertionTask::LabelResult::iterator found = result.map().find(*iter);
                 if (found != result.map().end())
                 {
-                  if (found->second.first == NULL)
-                  {
-                    found->second.first = *labelIter;
-                  }
-                  else if (found->second.second == NULL)
-                  {
-                    found->second.second = *labelIter;
-                  }
-                  else
-                  {
-                    assert(false);
-                  }
+                  found->second.push_back(*labelIter);
                 }
               }
             }
@@ -549,7 +299,7 @@ bool GotoInstruction::propagateOnUnmarked(VirtualTask& vtTask, WorkList& continu
           }
         }
       }
-      if (!((PhiInsertionTask::LabelResult*) label.mark)->hasMark())
+      if (!labelResult.hasMark())
       {
         task.clearInstruction();
         task.setInstruction(*getSNextInstruction());
@@ -557,12 +307,11 @@ bool GotoInstruction::propagateOnUnmarked(VirtualTask& vtTask, WorkList& continu
       }
       if (hasFoundFrontier)
       {
-        task.m_modified = ((PhiInsertionTask::LabelResult*) label.mark)->variablesToAdd();
+        task.m_modified = labelResult.variablesToAdd();
       }
-      else if (label.mark)
+      else
       {
-        PhiInsertionTask::LabelResult& result = *(PhiInsertionTask::LabelResult*) label.mark;
-        task.m_modified.insert(result.variablesToAdd().begin(), result.variablesToAdd().end());
+        task.m_modified.insert(labelResult.variablesToAdd().begin(), labelResult.variablesToAdd().end());
       }
       return true;
     }
@@ -614,70 +363,9 @@ void LabelInstruction::handle(VirtualTask& vtTask, WorkList& continuations, Reus
     ((LabelPhiFrontierAgenda&) continuations).propagateOn(*this, ((LabelPhiFrontierTask&) vtTask).m_modified);
     return;
   }
-  else if (type == TTRenaming)
-  {
-    assert(dynamic_cast<const RenamingTask*>(&vtTask));
-    RenamingTask& task = (RenamingTask&) vtTask;
-    if (task.m_previousLabel)
-    {
-      bool isLast = true;
-      if (getSNextInstruction() && getSNextInstruction()->type() == TExpression)
-      {
-        assert(dynamic_cast<const ExpressionInstruction*>(getSNextInstruction()));
-        if (((const ExpressionInstruction&) *getSNextInstruction()).isPhi())
-        {
-          isLast = false;
-          if (task.m_isOnlyPhi)
-          {
-            VirtualInstruction::handle(vtTask, continuations, reuse);
-          }
-        }
-      }
-      if (isLast)
-      {
-        assert(m_dominator);
-        std::set<RenamingTask::VariableRenaming>::iterator iter = task.m_renamings.begin();
-        while (iter != task.m_renamings.end())
-        {
-          if (!const_cast<RenamingTask::VariableRenaming&>(*iter).setDominator(*m_dominator))
-          {
-            std::set<RenamingTask::VariableRenaming>::iterator nextIter(iter);
-            ++nextIter;
-            const RenamingTask::VariableRenaming* next = (nextIter != task.m_renamings.end()) ? &(*nextIter) : NULL;
-            task.m_renamings.erase(iter);
-            if (next)
-            {
-              iter = task.m_renamings.find(*next);
-            }
-            else
-            {
-              iter = task.m_renamings.end();
-            }
-          }
-          else
-          {
-            ++iter;
-          }
-        }
-        task.m_previousLabel = NULL;
-      }
-      if (task.m_isOnlyPhi)
-      {
-        return;
-      }
-    }
-  }
   VirtualInstruction::handle(vtTask, continuations, reuse);
 }
 
-void
-ReturnInstruction::handle(VirtualTask& task, WorkList& continuations, Reusability& reuse) {
-  int type = task.getType();
-  if ((type == TTRenaming) && m_result.get())
-  m_result->handle(task, continuations, reuse);
-  VirtualInstruction::handle(task, continuations, reuse);
-}
-
 void
 EnterBlockInstruction::handle(VirtualTask& virtualTask, WorkList& continuations, Reusability& reuse) {
   VirtualInstruction::handle(virtualTask, continuations, reuse);
@@ -693,10 +381,6 @@ EnterBlockInstruction::handle(VirtualTask& virtualTask, WorkList& continuations,
     assert(dynamic_cast<const PhiInsertionTask*>(&virtualTask));
     ((PhiInsertionTask&) virtualTask).m_scope = m_scope;
   }
-  else if (type == TTRenaming)
-  {
-    m_scope.setSizeDefinitions();
-  }
 }
 
 void
@@ -712,7 +396,7 @@ ExitBlockInstruction::handle(VirtualTask& virtualTask, WorkList& continuations,
   {
     assert(dynamic_cast<const PhiInsertionTask*>(&virtualTask));
     PhiInsertionTask& task = (PhiInsertionTask&) virtualTask;
-    LocalVariableExpression lastExpr(std::string(), 0, task.m_scope);
+    LocalVariableExpression lastExpr(Atoms::AEmpty, 0, task.m_scope);
     task.m_scope.pop();
     PhiInsertionTask::ModifiedVariables::iterator last = task.m_modified.upper_bound(&lastExpr);
     task.m_modified.erase(last, task.m_modified.end());
@@ -720,6 +404,108 @@ ExitBlockInstruction::handle(VirtualTask& virtualTask, WorkList& continuations,
   VirtualInstruction::handle(virtualTask, continuations, reuse);
 }
 
+Function::~Function()
+{
+  delete m_controlFlow;
+  for (std::vector<VirtualInstruction*>::iterator iIter = m_instructions.begin();
+  iIter != m_instructions.end(); ++iIter)
+  if (*iIter) delete (*iIter);
+  m_instructions.clear();
+}
+
+ControlFlowGraph& Function::controlFlow()
+{
+  if (!m_controlFlow)
+  {
+    m_controlFlow = new ControlFlowGraph(*this);
+  }
+  return *m_controlFlow;
+}
+
+void Function::invalidateControlFlow()
+{
+  delete m_controlFlow;
+  m_controlFlow = NULL;
+}
+
+void Function::removeInstructions(const std::vector<VirtualInstruction*>& instructions)
+{
+  invalidateControlFlow();
+  std::vector<bool> isRemoved(m_instructions.size(), false);
+  for (std::vector<VirtualInstruction*>::const_iterator iter = instructions.begin(); iter != instructions.end(); ++iter)
+  {
+    VirtualInstruction& instruction = **iter;
+    assert(instruction.type() == VirtualInstruction::TExpression && instruction.m_previous
+        && instruction.m_previous->m_next == &instruction);
+    instruction.m_previous->m_next = instruction.m_next;
+    if (instruction.m_next)
+    {
+      instruction.m_next->m_previous = instruction.m_previous;
+    }
+    isRemoved[instruction.getRegistrationIndex()] = true;
+  }
+  // a label dominated by a removed instruction takes the previous one
+  for (std::vector<VirtualInstruction*>::const_iterator iter = m_instructions.begin(); iter != m_instructions.end(); ++iter)
+  {
+    if ((*iter)->type() == VirtualInstruction::TLabel)
+    {
+      assert(dynamic_cast<const LabelInstruction*>(*iter));
+      LabelInstruction& label = *((LabelInstruction*) *iter);
+      while (label.m_dominator && isRemoved[label.m_dominator->getRegistrationIndex()])
+      {
+        label.m_dominator = label.m_dominator->m_previous;
+      }
+    }
+  }
+  int count = 0;
+  for (int index = 0; index < (int) m_instructions.size(); ++index)
+  {
+    if (isRemoved[index])
+    {
+      delete m_instructions[index];
+    }
+    else
+    {
+      m_instructions[index]->m_registrationIndex = count;
+      m_instructions[count++] = m_instructions[index];
+    }
+  }
+  m_instructions.resize(count);
+}
+
+void Function::moveInstructionAfter(VirtualInstruction& instruction, VirtualInstruction& previous)
+{
+  invalidateControlFlow();
+  assert(instruction.type() == VirtualInstruction::TExpression && instruction.m_previous
+      && instruction.m_previous->m_next == &instruction);
+  instruction.m_previous->m_next = instruction.m_next;
+  if (instruction.m_next)
+  {
+    instruction.m_next->m_previous = instruction.m_previous;
+  }
+  VirtualInstruction* next = previous.m_next;
+  assert(!next || next->m_previous == &previous);
+  previous.m_next = &instruction;
+  instruction.m_previous = &previous;
+  instruction.m_next = next;
+  if (next)
+  {
+    next->m_previous = &instruction;
+  }
+}
+
+void Function::registerBefore(int first, const VirtualInstruction& next)
+{
+  invalidateControlFlow();
+  int position = next.getRegistrationIndex();
+  assert(position < first);
+  std::rotate(m_instructions.begin()+position, m_instructions.begin()+first, m_instructions.end());
+  for (int index = position; index < (int) m_instructions.size(); ++index)
+  {
+    m_instructions[index]->m_registrationIndex = index;
+  }
+}
+
 void Function::setDominationFrontier()
 {
   for (std::vector<VirtualInstruction*>::const_iterator iter = m_instructions.begin(); iter != m_instructions.end(); ++iter)
@@ -782,41 +568,42 @@ void Function::setDominationFrontier()
   }
 }
 
-void Function::insertPhiFunctions(const std::vector<LabelInstruction*>& labels)
+void Function::insertPhiFunctions(PhiInsertionAgenda& agenda, const Liveness* liveness)
 {
-  for (std::vector<LabelInstruction*>::const_iterator iter = labels.begin(); iter != labels.end(); ++iter)
+  m_phiCandidates = m_phis = 0;
+  for (std::vector<LabelInstruction*>::const_iterator iter = agenda.labels().begin(); iter != agenda.labels().end(); ++iter)
   {
     LabelInstruction& label = **iter;
-    if (label.mark != NULL)
+    PhiInsertionTask::LabelResult* result = agenda.findLabelResult(label);
+    if (result != NULL)
     {
-      PhiInsertionTask::LabelResult* result = (PhiInsertionTask::LabelResult*) label.mark;
       VirtualInstruction* previous = &label;
       for (PhiInsertionTask::LabelResult::iterator labelIter = result->map().begin(); labelIter != result->map().end(); ++labelIter)
       {
-        if (labelIter->second.first || labelIter->second.second)
+        if (!labelIter->second.empty())
         {
-          ExpressionInstruction* assign = new ExpressionInstruction();
+          ++m_phiCandidates;
+          if (liveness && !liveness->needsPhi(label, *labelIter->first))
+          {
+            continue;
+          }
+          ++m_phis;
+          ExpressionInstruction* assign = new (m_arena) ExpressionInstruction();
           // Requires casting for the next instruction (first argument)
           insertNewInstructionAfter((VirtualInstruction*) assign, *previous);
           previous = assign;
-          AssignExpression* assignExpression = new AssignExpression();
+          AssignExpression* assignExpression = new (m_arena) AssignExpression();
           assign->setExpression(assignExpression);
           VirtualExpression* lvalue = labelIter->first->clone();
           assignExpression->setLValue(lvalue);
-          PhiExpression* phi = new PhiExpression();
+          PhiExpression* phi = new (m_arena) PhiExpression();
           assignExpression->setRValue(phi);
-          if (labelIter->second.first)
+          for (int index = 0; index < labelIter->second.size(); ++index)
           {
-            phi->addReference(labelIter->first->clone(), *labelIter->second.first);
-          }
-          if (labelIter->second.second)
-          {
-            phi->addReference(labelIter->first->clone(), *labelIter->second.second);
+            phi->addReference(labelIter->first->clone(), *labelIter->second[index]);
           }
         }
       }
-      delete result;
-      label.mark = NULL;
     }
   }
 }
@@ -832,12 +619,172 @@ Program::printWithWorkList(std::ostream& out) const {
   };
 }
 
+void Program::computeDominators(Function& function, DominatorEngine engine)
+{
+  if (engine == DEBlocks)
+  {
+    ControlFlowGraph& graph = function.controlFlow();
+    graph.computeDominators();
+    graph.applyDominators();
+  }
+  else
+  {
+    DominationAgenda agenda(function);
+    agenda.execute();
+    function.addExecutedTasks(agenda);
+  }
+}
+
+void Program::computeDominationFrontiers(Function& function, DominatorEngine engine)
+{
+  if (engine == DEBlocks)
+  {
+    ControlFlowGraph& graph = function.controlFlow();
+    if (!graph.hasDominators())
+    {
+      graph.computeDominators();
+    }
+    graph.computeDominationFrontiers();
+    graph.applyDominationFrontiers();
+  }
+  else
+  {
+    function.setDominationFrontier();
+  }
+}
+
+void Program::insertPhiFunctions(Function& function, PhiPlacement placement)
+{
+  // the liveness is computed on the blocks before the first insertion
+  // drops them
+  std::auto_ptr<Liveness> liveness;
+  if (placement != PPMinimal)
+  {
+    liveness.reset(new Liveness(function.controlFlow(), placement == PPPruned));
+  }
+  PhiInsertionAgenda phiInsertionAgenda(function);
+  phiInsertionAgenda.execute();
+  function.addExecutedTasks(phiInsertionAgenda);
+  for (std::vector<LabelInstruction*>::const_iterator labelIter = phiInsertionAgenda.labels().begin(); labelIter != phiInsertionAgenda.labels().end(); ++labelIter)
+  {
+    LabelPhiFrontierAgenda labelPhiFrontierAgenda(phiInsertionAgenda);
+    labelPhiFrontierAgenda.propagate(**labelIter);
+    labelPhiFrontierAgenda.execute();
+    function.addExecutedTasks(labelPhiFrontierAgenda);
+  }
+  function.insertPhiFunctions(phiInsertionAgenda, liveness.get());
+}
+
+void Program::renameSSA(Function& function)
+{
+  SSARenaming renaming(function);
+  renaming.apply();
+}
+
+void Program::computeSSA(Function& function, DominatorEngine engine, PhiPlacement placement, PhaseProfiler* profiler)
+{
+  {
+    PhaseProfiler::Measure measure(profiler, "dominators", &function);
+    computeDominators(function, engine);
+  }
+  {
+    PhaseProfiler::Measure measure(profiler, "frontiers", &function);
+    computeDominationFrontiers(function, engine);
+  }
+  {
+    PhaseProfiler::Measure measure(profiler, "phi insertion", &function);
+    insertPhiFunctions(function, placement);
+  }
+  PhaseProfiler::Measure measure(profiler, "renaming", &function);
+  renameSSA(function);
+}
+
+void Program::propagateConstants(Function& function)
+{
+  ConstantPropagation propagation(function);
+  propagation.propagate();
+  propagation.apply();
+  function.addStatistic("expressions folded", propagation.countFoldedExpressions());
+  function.addStatistic("branches pruned", propagation.countPrunedBranches());
+  // the labels whose predecessors have been cut get their new dominator
+  computeDominators(function, DEBlocks);
+}
+
+void Program::numberValues(Function& function)
+{
+  ValueNumbering numbering(function);
+  numbering.apply();
+  function.addStatistic("redundant expressions", numbering.countRedundantExpressions());
+}
+
+void Program::hoistLoopInvariants(Function& function)
+{
+  LoopInvariantMotion motion(function);
+  motion.apply();
+  function.addStatistic("loops", motion.countLoops());
+  function.addStatistic("invariants hoisted", motion.countHoistedInstructions());
+  // the loop headers are now dominated by the last invariant moved
+  computeDominators(function, DEBlocks);
+}
+
+void Program::reduceInductionVariables(Function& function)
+{
+  InductionVariables inductions(function);
+  inductions.analyze();
+  inductions.reduceStrength();
+  function.addStatistic("induction variables", inductions.countInductions());
+  function.addStatistic("multiplications reduced", inductions.countReducedMultiplications());
+  function.addStatistic("trip counts", inductions.countTripCounts());
+  // the new phi functions and increments are not yet in the dominator tree
+  computeDominators(function, DEBlocks);
+}
+
+void Program::eliminateDeadCode(Function& function)
+{
+  DeadCodeElimination elimination(function);
+  elimination.mark();
+  elimination.sweep();
+  function.addStatistic("assignments removed", elimination.countRemovedAssignments());
+  function.addStatistic("phi functions removed", elimination.countRemovedPhis());
+  // the labels dominated by a removed instruction get a dominator again
+  computeDominators(function, DEBlocks);
+}
+
+void Program::optimize(Function& function, int optimizations, PhaseProfiler* profiler)
+{
+  if (optimizations & OConstantPropagation)
+  {
+    PhaseProfiler::Measure measure(profiler, "sccp", &function);
+    propagateConstants(function);
+  }
+  if (optimizations & OValueNumbering)
+  {
+    PhaseProfiler::Measure measure(profiler, "gvn", &function);
+    numberValues(function);
+  }
+  if (optimizations & OLoopInvariants)
+  {
+    PhaseProfiler::Measure measure(profiler, "licm", &function);
+    hoistLoopInvariants(function);
+  }
+  if (optimizations & OInductionVariables)
+  {
+    PhaseProfiler::Measure measure(profiler, "iv", &function);
+    reduceInductionVariables(function);
+  }
+  if (optimizations & ODeadCode)
+  {
+    PhaseProfiler::Measure measure(profiler, "dce", &function);
+    eliminateDeadCode(function);
+  }
+}
+
 void Program::computeDominators()
 {
   for (std::set<Function>::const_iterator functionIter = m_functions.begin(); functionIter != m_functions.end(); ++functionIter)
   {
-    DominationAgenda agenda(*functionIter);
-    agenda.execute();
+    PhaseProfiler::Measure measure(m_profiler, "dominators", &*functionIter);
+    computeDominators(const_cast<Function&>(*functionIter), m_dominatorEngine);
   }
 }
 
@@ -845,7 +792,8 @@ void Program::computeDominationFrontiers()
 {
   for (std::set<Function>::iterator functionIter = m_functions.begin(); functionIter != m_functions.end(); ++functionIter)
   {
-    const_cast<Function&>(*functionIter).setDominationFrontier();
+    PhaseProfiler::Measure measure(m_profiler, "frontiers", &*functionIter);
+    computeDominationFrontiers(const_cast<Function&>(*functionIter), m_dominatorEngine);
   }
 }
 
@@ -853,54 +801,703 @@ void Program::insertPhiFunctions()
 {
   for (std::set<Function>::const_iterator functionIter = m_functions.begin();  functionIter != m_functions.end(); ++functionIter)
   {
-    PhiInsertionAgenda phiInsertionAgenda(*functionIter);
-    phiInsertionAgenda.execute();
-    for (std::vector<LabelInstruction*>::const_iterator labelIter = phiInsertionAgenda.labels().begin(); labelIter != phiInsertionAgenda.labels().end(); ++labelIter)
+    PhaseProfiler::Measure measure(m_profiler, "phi insertion", &*functionIter);
+    insertPhiFunctions(const_cast<Function&>(*functionIter), m_phiPlacement);
+  }
+}
+
+void Program::renameSSA()
+{
+  for (std::set<Function>::const_iterator functionIter = m_functions.begin(); functionIter != m_functions.end(); ++functionIter)
+  {
+    PhaseProfiler::Measure measure(m_profiler, "renaming", &*functionIter);
+    renameSSA(const_cast<Function&>(*functionIter));
+  }
+}
+
+namespace {
+
+// expands the calls of function after the ones of its callees; a callee
+// still active is on a cycle of calls, which is kept there
+void inlineCalls(Function& function, int threshold, std::set<const Function*>& expanded,
+    std::set<const Function*>& active, PhaseProfiler* profiler)
+{
+  if (!expanded.insert(&function).second)
+  {
+    return;
+  }
+  active.insert(&function);
+  std::vector<Function*> callees;
+  Inliner::findCallees(function, callees);
+  for (std::vector<Function*>::const_iterator calleeIter = callees.begin(); calleeIter != callees.end(); ++calleeIter)
+  {
+    inlineCalls(**calleeIter, threshold, expanded, active, profiler);
+  }
+  PhaseProfiler::Measure measure(profiler, "inline", &function);
+  Inliner inliner(function, threshold);
+  inliner.apply(active);
+  active.erase(&function);
+  function.addStatistic("calls inlined", inliner.countInlinedCalls());
+}
+
+}
+
+void Program::inlineCalls()
+{
+  int threshold = Inliner::DefaultThreshold;
+  if (m_inlineThreshold >= 0)
+  {
+    threshold = m_inlineThreshold;
+  }
+  std::set<const Function*> expanded, active;
+  for (std::set<Function>::const_iterator functionIter = m_functions.begin(); functionIter != m_functions.end(); ++functionIter)
+  {
+    ::inlineCalls(const_cast<Function&>(*functionIter), threshold, expanded, active, m_profiler);
+  }
+}
+
+void Program::optimize()
+{
+  for (std::set<Function>::const_iterator functionIter = m_functions.begin(); functionIter != m_functions.end(); ++functionIter)
+  {
+    optimize(const_cast<Function&>(*functionIter), m_optimizations, m_profiler);
+  }
+}
+
+void Program::printStatistics(std::ostream& out) const
+{
+  for (std::set<Function>::const_iterator functionIter = m_functions.begin(); functionIter != m_functions.end(); ++functionIter)
+  {
+    const std::vector<std::pair<const char*, int> >& statistics = functionIter->statistics();
+    out << "function " << functionIter->getName() << ':';
+    for (std::vector<std::pair<const char*, int> >::const_iterator statisticIter = statistics.begin(); statisticIter != statistics.end(); ++statisticIter)
     {
-      LabelPhiFrontierAgenda labelPhiFrontierAgenda;
-      labelPhiFrontierAgenda.propagate(**labelIter);
-      labelPhiFrontierAgenda.execute();
+      out << (statisticIter == statistics.begin() ? " " : ", ") << statisticIter->second << ' ' << statisticIter->first;
     }
-    const_cast<Function&>(*functionIter).insertPhiFunctions(phiInsertionAgenda.labels());
+    out << '\n';
   }
 }
 
-void Program::renameSSA()
+void Program::benchDominators(std::ostream& out) const
+{
+  for (std::set<Function>::const_iterator functionIter = m_functions.begin(); functionIter != m_functions.end(); ++functionIter)
+  {
+    const Function& function = *functionIter;
+    int count = function.countInstructions();
+    clock_t start = clock();
+    computeDominators(const_cast<Function&>(function), DEWorkList);
+    double workListTime = (double) (clock() - start) / CLOCKS_PER_SEC;
+    std::vector<int> heights(count);
+    std::vector<VirtualInstruction*> dominators(count, (VirtualInstruction*) NULL);
+    for (int index = 0; index < count; ++index)
+    {
+      VirtualInstruction& instruction = function.getInstruction(index);
+      heights[index] = instruction.getDominationHeight();
+      if (instruction.type() == VirtualInstruction::TLabel)
+      {
+        assert(dynamic_cast<const LabelInstruction*>(&instruction));
+        dominators[index] = ((const LabelInstruction&) instruction).getSDominator();
+      }
+    }
+    start = clock();
+    ControlFlowGraph graph(function);
+    graph.computeDominators();
+    graph.applyDominators();
+    double blocksTime = (double) (clock() - start) / CLOCKS_PER_SEC;
+    int differences = 0;
+    for (int index = 0; index < count; ++index)
+    {
+      VirtualInstruction& instruction = function.getInstruction(index);
+      if (instruction.getDominationHeight() != heights[index]
+          || (instruction.type() == VirtualInstruction::TLabel
+            && ((const LabelInstruction&) instruction).getSDominator() != dominators[index]))
+      {
+        ++differences;
+      }
+    }
+    out << "function " << function.getName() << ": " << count << " instructions, "
+      << graph.countBlocks() << " blocks, worklist " << workListTime*1000.0
+      << " ms, blocks " << blocksTime*1000.0 << " ms";
+    if (differences)
+    {
+      out << ", " << differences << " differences";
+    }
+    out << '\n';
+  }
+}
+
+void Program::printPhiStatistics(std::ostream& out) const
+{
+  int candidates = 0, phis = 0;
+  for (std::set<Function>::const_iterator functionIter = m_functions.begin(); functionIter != m_functions.end(); ++functionIter)
+  {
+    out << "function " << functionIter->getName() << ": " << functionIter->countPhis()
+      << " phi functions inserted out of " << functionIter->countPhiCandidates() << '\n';
+    candidates += functionIter->countPhiCandidates();
+    phis += functionIter->countPhis();
+  }
+  out << "total: " << phis << " phi functions inserted out of " << candidates << '\n';
+}
+
+void Program::generateAssembly(std::ostream& out) const
+{
+  CodeGenerator generator(out, (m_registers >= 0) ? m_registers : CodeGenerator::countRegisters());
+  for (std::set<Function>::const_iterator functionIter = m_functions.begin(); functionIter != m_functions.end(); ++functionIter)
+  {
+    PhaseProfiler::Measure measure(m_profiler, "assembly", &*functionIter);
+    generator.generate(const_cast<Function&>(*functionIter));
+  }
+  generator.generateData();
+}
+
+int Program::runBytecode(const char* programName, int repeats, bool printBytecode, std::ostream& report) const
 {
+  Bytecode bytecode;
   for (std::set<Function>::const_iterator functionIter = m_functions.begin(); functionIter != m_functions.end(); ++functionIter)
   {
-    RenamingAgenda renamingAgenda(*functionIter);
-    renamingAgenda.execute();
+    if (!CodeGenerator::isExternal(*functionIter))
+    {
+      PhaseProfiler::Measure measure(m_profiler, "bytecode", &*functionIter);
+      bytecode.compile(const_cast<Function&>(*functionIter));
+    }
+  }
+  if (printBytecode)
+  {
+    bytecode.print(std::cout);
+  }
+  if (repeats <= 0)
+  {
+    return 0;
+  }
+  int main = bytecode.findProcedure("main");
+  if (main < 0)
+  {
+    report << "no function main to run" << std::endl;
+    return 1;
+  }
+  Interpreter interpreter(bytecode);
+  // main(1, { programName, NULL })
+  char* argv[] = { const_cast<char*>(programName), NULL };
+  std::vector<long> arguments;
+  arguments.push_back(1);
+  arguments.push_back((long) argv);
+  long result = 0;
+  clock_t start = clock();
+  for (int run = 0; run < repeats; ++run)
+  {
+    if (!interpreter.call(main, arguments, result))
+    {
+      std::cout.flush();
+      fflush(stdout);
+      report << "stack overflow in " << bytecode.procedure(interpreter.getOverflowProcedure()).name << std::endl;
+      return 1;
+    }
+  }
+  double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+  std::cout.flush();
+  fflush(stdout);
+  report << "main returned " << (int) result << ", " << repeats << " runs in " << seconds*1000.0
+    << " ms (" << seconds*1000000.0/repeats << " us per run)" << std::endl;
+  return (int) result;
+}
+
+namespace {
+
+class IsLarger
+{
+public:
+  bool operator()(const Function* fst, const Function* snd) const
+  {
+    return fst->countInstructions() > snd->countInstructions();
+  }
+};
+
+// Runs the whole SSA construction of each function on its own. The
+// functions only share the global scope, which is read, so the result does
+// not depend on the number of threads nor on the scheduling.
+class SSAConstruction : public ParallelLoop
+{
+private:
+  std::vector<Function*> m_functions;
+  Program::DominatorEngine m_dominatorEngine;
+  Program::PhiPlacement m_phiPlacement;
+  int m_optimizations;
+  PhaseProfiler* m_profiler;
+
+public:
+  SSAConstruction(const std::set<Function>& functions, Program::DominatorEngine dominatorEngine,
+      Program::PhiPlacement phiPlacement, int optimizations, PhaseProfiler* profiler)
+  :  m_dominatorEngine(dominatorEngine), m_phiPlacement(phiPlacement), m_optimizations(optimizations),
+    m_profiler(profiler)
+  {
+    for (std::set<Function>::const_iterator functionIter = functions.begin(); functionIter != functions.end(); ++functionIter)
+    {
+      m_functions.push_back(&const_cast<Function&>(*functionIter));
+    }
+    // the largest functions start first not to be left alone at the end
+    std::stable_sort(m_functions.begin(), m_functions.end(), IsLarger());
+  }
+  int count() const
+  {
+    return m_functions.size();
+  }
+  virtual void execute(int index)
+  {
+    Program::computeSSA(*m_functions[index], m_dominatorEngine, m_phiPlacement, m_profiler);
+    Program::optimize(*m_functions[index], m_optimizations, m_profiler);
   }
+};
+
+}
+
+void Program::computeSSA(int threads)
+{
+  SSAConstruction construction(m_functions, m_dominatorEngine, m_phiPlacement, m_optimizations, m_profiler);
+  construction.run(construction.count(), threads);
 }
 
 extern int yydebug;
+extern bool traceTokens;
+extern long scanTokens(FILE* input);
+extern bool parseProgram(Program& program, FILE* input);
 
-int main( int argc, char** argv ) {
-  // yydebug = 1;
-  Program program;
-  parseContext.setProgram(program);
-  if (argc > 1)
-  yyin = fopen(argv[1], "r");
-  while (yyparse() != 0);
-  if (yyin)
-  fclose(yyin);
-  std::cout << std::endl;
-  program.print(std::cout);
-  std::cout << std::endl;
-  program.printWithWorkList(std::cout);
-  std::cout << std::endl;
+// Stages of the compilation written by --emit, in their order. Without
+// --emit nothing is written, apart from the assembly of -S.
+enum Emission {
+  EAst = 1, EInstructions = 2, EDominators = 4, EFrontiers = 8, EPhi = 16, ESsa = 32, EAssembly = 64,
+  // the dumps written before --emit existed
+  EAllDumps = EAst | EInstructions | EDominators | EFrontiers | EPhi | ESsa
+};
+
+// comma separated list of stages, -1 for an unknown one
+static int readEmissions(const char* stages) {
+  static const char* const names[] = { "ast", "ir", "dom", "frontiers", "phi", "ssa", "asm", NULL };
+  int result = 0;
+  while (*stages) {
+    const char* end = strchr(stages, ',');
+    size_t length = end ? (size_t) (end - stages) : strlen(stages);
+    int emission = -1;
+    if (length == 3 && strncmp(stages, "all", 3) == 0)
+    emission = EAllDumps;
+    for (int index = 0; emission < 0 && names[index]; ++index)
+    if (strlen(names[index]) == length && strncmp(stages, names[index], length) == 0)
+    emission = 1 << index;
+    if (emission < 0)
+    return -1;
+    result |= emission;
+    stages += length + (end ? 1 : 0);
+  };
+  return result;
+}
+
+static void emitInstructions(std::ostream& out, const Program& program) {
+  program.printWithWorkList(out);
+  out << '\n';
+}
+
+// -S without -o: the assembly of file.c goes to file.s, a.s for the
+// standard input
+static std::string assemblyName(const char* fileName) {
+  std::string result = fileName ? fileName : "a";
+  std::string::size_type extension = result.rfind('.');
+  if (extension != std::string::npos && result.find('/', extension) == std::string::npos)
+  result.erase(extension);
+  return result + ".s";
+}
+
+// the output is written through a large buffer, flushed at the end; the
+// buffer belongs to the caller and has to outlive out
+static bool openOutput(std::ofstream& out, const std::string& outputName, std::vector<char>& buffer) {
+  buffer.resize(1 << 20);
+  out.rdbuf()->pubsetbuf(&buffer[0], buffer.size());
+  out.open(outputName.c_str());
+  if (!out) {
+    std::cerr << "cannot write " << outputName << std::endl;
+    return false;
+  };
+  return true;
+}
+
+static bool writeAssembly(const Program& program, std::ostream* out, const char* fileName) {
+  if (out) {
+    program.generateAssembly(*out);
+    return true;
+  };
+  std::vector<char> buffer;
+  std::ofstream assemblyFile;
+  if (!openOutput(assemblyFile, assemblyName(fileName), buffer))
+  return false;
+  program.generateAssembly(assemblyFile);
+  return true;
+}
+
+// The phases of a program one after the other, with the stages of --emit
+// written to out between them and the statistics to report: the path of a
+// single file without -j and the one of each unit of a batch. false when
+// the assembly cannot be written.
+static bool compileProgram(Program& program, int emissions, std::ostream& out, std::ostream* assemblyOut,
+    const char* fileName, bool phiStatistics, bool statistics, std::ostream& report) {
+  if (emissions & EInstructions)
+  emitInstructions(out, program);
   program.computeDominators();
-  program.printWithWorkList(std::cout);
-  std::cout << std::endl;
+  if (emissions & EDominators)
+  emitInstructions(out, program);
   program.computeDominationFrontiers();
-  program.printWithWorkList(std::cout);
-  std::cout << std::endl;
+  if (emissions & EFrontiers)
+  emitInstructions(out, program);
   program.insertPhiFunctions();
-  program.printWithWorkList(std::cout);
-  std::cout << std::endl;
+  if (emissions & EPhi)
+  emitInstructions(out, program);
+  if (phiStatistics)
+  program.printPhiStatistics(report);
   program.renameSSA();
-  program.printWithWorkList(std::cout);
-  std::cout << std::endl;
-  return 0;
+  if (emissions & ESsa)
+  emitInstructions(out, program);
+  if (program.getOptimizations()) {
+    program.optimize();
+    if (emissions & ESsa)
+    emitInstructions(out, program);
+  };
+  if ((emissions & EAssembly) && !writeAssembly(program, assemblyOut, fileName))
+  return false;
+  out.flush();
+  // the backend adds the statistics of the register allocation
+  if (statistics && (program.getOptimizations() || (emissions & EAssembly)))
+  program.printStatistics(report);
+  return true;
+}
+
+// --time-report: the measures of the phases go to the error output
+static int reportPhases(int result, const PhaseProfiler* profiler, PhaseProfiler::Format format) {
+  if (profiler)
+  profiler->print(std::cerr, format);
+  return result;
+}
+
+namespace {
+
+// Compilation of the translation units of a batch, each one with its own
+// program and parse, on the threads of -j. A unit writes the stages of a
+// single file compiled alone, kept until the end to be printed in the order
+// of the list whatever the scheduling.
+class BatchCompilation : public ParallelLoop
+{
+public:
+  class Unit
+  {
+  public:
+    std::string fileName;
+    // the stages of --emit and the assembly going to -o
+    std::string output;
+    // the statistics and the errors
+    std::string report;
+    bool valid;
+
+    Unit(const std::string& name) : fileName(name), valid(false) {}
+  };
+
+private:
+  const Program& m_options;
+  int m_emissions;
+  // -S without -o: the assembly of each unit goes to its own file.s
+  bool m_assemblyFiles;
+  bool m_phiStatistics;
+  bool m_statistics;
+  std::vector<Unit> m_units;
+
+public:
+  BatchCompilation(const Program& options, int emissions, bool assemblyFiles, bool phiStatistics,
+      bool statistics)
+  :  m_options(options), m_emissions(emissions), m_assemblyFiles(assemblyFiles),
+    m_phiStatistics(phiStatistics), m_statistics(statistics) {}
+
+  void addUnit(const std::string& fileName)
+  {
+    m_units.push_back(Unit(fileName));
+  }
+  int count() const
+  {
+    return m_units.size();
+  }
+  const Unit& unit(int index) const
+  {
+    return m_units[index];
+  }
+  virtual void execute(int index);
+};
+
+void BatchCompilation::execute(int index)
+{
+  Unit& unit = m_units[index];
+  std::ostringstream out, report;
+  FILE* input = fopen(unit.fileName.c_str(), "r");
+  if (!input)
+  {
+    unit.report = "cannot read " + unit.fileName + "\n";
+    return;
+  }
+  Program program;
+  program.copyOptions(m_options);
+  {
+    PhaseProfiler::Measure measure(m_options.getSProfiler(), "parse");
+    unit.valid = parseProgram(program, input);
+  }
+  fclose(input);
+  if (!unit.valid)
+  {
+    unit.report = unit.fileName + ": syntax error\n";
+    return;
+  }
+  if (program.getOptimizations() & Program::OInline)
+    program.inlineCalls();
+  if (m_emissions & EAst)
+  {
+    out << '\n';
+    program.print(out);
+    out << '\n';
+  }
+  // the phases of a unit run on its thread, as the ones of a single file
+  unit.valid = compileProgram(program, m_emissions, out, m_assemblyFiles ? NULL : &out, unit.fileName.c_str(),
+      m_phiStatistics, m_statistics, report);
+  unit.output = out.str();
+  unit.report = report.str();
+}
+
+// --batch=list: the names of the files, one per line
+bool readFileList(const char* listName, std::vector<std::string>& fileNames)
+{
+  std::ifstream list(listName);
+  if (!list)
+  {
+    std::cerr << "cannot read " << listName << std::endl;
+    return false;
+  }
+  std::string line;
+  while (std::getline(list, line))
+  {
+    std::string::size_type end = line.find_last_not_of(" \t\r");
+    if (end != std::string::npos)
+      fileNames.push_back(line.substr(0, end+1));
+  }
+  return true;
+}
+
+}
+
+int main( int argc, char** argv ) {
+  // yydebug = 1;
+  Program program;
+  const char* fileName = NULL;
+  std::vector<std::string> fileNames;
+  bool batch = false;
+  int threads = 0;
+  bool lexOnly = false;
+  bool benchDominators = false;
+  bool phiStatistics = false;
+  bool statistics = false;
+  bool assembly = false;
+  int emissions = 0;
+  const char* outputName = NULL;
+  int runs = 0;
+  bool printBytecode = false;
+  std::auto_ptr<PhaseProfiler> profiler;
+  PhaseProfiler::Format profileFormat = PhaseProfiler::FTable;
+  for (int argIndex = 1; argIndex < argc; ++argIndex) {
+    if (strcmp(argv[argIndex], "--trace-tokens") == 0)
+    traceTokens = true;
+    else if (strcmp(argv[argIndex], "--lex-only") == 0)
+    lexOnly = true;
+    else if (strcmp(argv[argIndex], "--dominators=worklist") == 0)
+    program.setDominatorEngine(Program::DEWorkList);
+    else if (strcmp(argv[argIndex], "--dominators=blocks") == 0)
+    program.setDominatorEngine(Program::DEBlocks);
+    else if (strcmp(argv[argIndex], "--bench-dominators") == 0)
+    benchDominators = true;
+    else if (strcmp(argv[argIndex], "--ssa=minimal") == 0)
+    program.setPhiPlacement(Program::PPMinimal);
+    else if (strcmp(argv[argIndex], "--ssa=semi-pruned") == 0)
+    program.setPhiPlacement(Program::PPSemiPruned);
+    else if (strcmp(argv[argIndex], "--ssa=pruned") == 0)
+    program.setPhiPlacement(Program::PPPruned);
+    else if (strcmp(argv[argIndex], "--phi-stats") == 0)
+    phiStatistics = true;
+    else if (strcmp(argv[argIndex], "--sccp") == 0)
+    program.addOptimizations(Program::OConstantPropagation);
+    else if (strcmp(argv[argIndex], "--gvn") == 0)
+    program.addOptimizations(Program::OValueNumbering);
+    else if (strcmp(argv[argIndex], "--licm") == 0)
+    program.addOptimizations(Program::OLoopInvariants);
+    else if (strcmp(argv[argIndex], "--iv") == 0)
+    program.addOptimizations(Program::OInductionVariables);
+    else if (strcmp(argv[argIndex], "--dce") == 0)
+    program.addOptimizations(Program::ODeadCode);
+    else if (strcmp(argv[argIndex], "--inline") == 0)
+    program.addOptimizations(Program::OInline);
+    else if (strncmp(argv[argIndex], "--inline-threshold=", 19) == 0) {
+      program.addOptimizations(Program::OInline);
+      program.setInlineThreshold(atoi(argv[argIndex]+19));
+    }
+    else if (strcmp(argv[argIndex], "-O") == 0)
+    program.addOptimizations(Program::OAll);
+    else if (strcmp(argv[argIndex], "--opt-stats") == 0)
+    statistics = true;
+    else if (strcmp(argv[argIndex], "-S") == 0)
+    assembly = true;
+    else if (strncmp(argv[argIndex], "--emit=", 7) == 0) {
+      int stages = readEmissions(argv[argIndex]+7);
+      if (stages < 0) {
+        std::cerr << "unknown stage in " << argv[argIndex]
+          << ", expected ast, ir, dom, frontiers, phi, ssa, asm or all" << std::endl;
+        return 1;
+      };
+      emissions |= stages;
+    }
+    else if (strcmp(argv[argIndex], "-o") == 0 && argIndex+1 < argc)
+    outputName = argv[++argIndex];
+    else if (strncmp(argv[argIndex], "--registers=", 12) == 0)
+    program.setRegisters(atoi(argv[argIndex]+12));
+    else if (strcmp(argv[argIndex], "--run") == 0)
+    runs = 1;
+    else if (strncmp(argv[argIndex], "--run=", 6) == 0)
+    runs = std::max(atoi(argv[argIndex]+6), 1);
+    else if (strcmp(argv[argIndex], "--bytecode") == 0)
+    printBytecode = true;
+    else if (strcmp(argv[argIndex], "--time-report") == 0
+        || strcmp(argv[argIndex], "--time-report=json") == 0) {
+      if (!profiler.get())
+      profiler.reset(new PhaseProfiler());
+      profileFormat = (argv[argIndex][13] == '=') ? PhaseProfiler::FJson : PhaseProfiler::FTable;
+    }
+    else if (strncmp(argv[argIndex], "-j", 2) == 0) {
+      // -j, -jN or -j N: SSA construction of the functions on N threads
+      const char* count = argv[argIndex]+2;
+      if (!*count && (argIndex+1 < argc) && isdigit(argv[argIndex+1][0]))
+      count = argv[++argIndex];
+      threads = atoi(count);
+      if (threads <= 0)
+      threads = ParallelLoop::countProcessors();
+    }
+    else if (strncmp(argv[argIndex], "--batch=", 8) == 0) {
+      if (!readFileList(argv[argIndex]+8, fileNames))
+      return 1;
+      batch = true;
+    }
+    else
+    fileNames.push_back(argv[argIndex]);
+  };
+  if (assembly)
+  emissions |= EAssembly;
+  if (batch || fileNames.size() > 1) {
+    // many translation units in one process, -j distributing the units
+    if (lexOnly || benchDominators || runs > 0 || printBytecode) {
+      std::cerr << "--lex-only, --bench-dominators, --run and --bytecode take a single file" << std::endl;
+      return 1;
+    };
+    program.setProfiler(profiler.get());
+    BatchCompilation compilation(program, emissions, assembly && !outputName, phiStatistics, statistics);
+    for (std::vector<std::string>::const_iterator nameIter = fileNames.begin(); nameIter != fileNames.end(); ++nameIter)
+    compilation.addUnit(*nameIter);
+    compilation.run(compilation.count(), std::max(threads, 1));
+    std::vector<char> outputBuffer;
+    std::ofstream outputFile;
+    if (outputName && !openOutput(outputFile, outputName, outputBuffer))
+    return 1;
+    std::ostream& out = outputName ? (std::ostream&) outputFile : std::cout;
+    int result = 0;
+    for (int index = 0; index < compilation.count(); ++index) {
+      const BatchCompilation::Unit& unit = compilation.unit(index);
+      out << unit.output;
+      std::cerr << unit.report;
+      if (!unit.valid)
+      result = 1;
+    };
+    out.flush();
+    return reportPhases(result, profiler.get(), profileFormat);
+  };
+  if (threads > 0 && (emissions & (EInstructions | EDominators | EFrontiers | EPhi))) {
+    // the phases are interleaved between the functions of a single file
+    std::cerr << "-j on a single file only writes the ast, ssa and asm stages" << std::endl;
+    return 1;
+  };
+  if (!fileNames.empty())
+  fileName = fileNames.front().c_str();
+  FILE* input = fileName ? fopen(fileName, "r") : stdin;
+  if (!input) {
+    std::cerr << "cannot read " << fileName << std::endl;
+    return 1;
+  };
+  if (lexOnly) {
+    // throughput of the scanner alone, the tokens are dropped
+    long size = 0;
+    if (fseek(input, 0, SEEK_END) == 0) {
+      size = ftell(input);
+      rewind(input);
+    };
+    clock_t start = clock();
+    long tokens = scanTokens(input);
+    double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    if (input != stdin)
+    fclose(input);
+    std::cerr << tokens << " tokens, " << size << " bytes in " << seconds << " s";
+    if (seconds > 0)
+    std::cerr << " (" << (size / seconds / (1024.0*1024.0)) << " MB/s)";
+    std::cerr << std::endl;
+    return 0;
+  };
+  program.setProfiler(profiler.get());
+  bool parsed;
+  {
+    PhaseProfiler::Measure measure(profiler.get(), "parse");
+    parsed = parseProgram(program, input);
+  }
+  if (input != stdin)
+  fclose(input);
+  // the parser has reported the syntax errors, nothing is compiled
+  if (!parsed)
+  return reportPhases(1, profiler.get(), profileFormat);
+  if (benchDominators) {
+    program.benchDominators(std::cout);
+    return 0;
+  };
+  if (program.getOptimizations() & Program::OInline)
+  program.inlineCalls();
+  // -o receives the stages of --emit, the assembly included; without it
+  // they go to the standard output and the assembly of -S to file.s
+  std::vector<char> outputBuffer;
+  std::ofstream outputFile;
+  if (outputName && !openOutput(outputFile, outputName, outputBuffer))
+  return 1;
+  if (!outputName && (emissions & ~EAssembly) && !isatty(fileno(stdout)))
+  setvbuf(stdout, NULL, _IOFBF, 1 << 20);
+  std::ostream& out = outputName ? (std::ostream&) outputFile : std::cout;
+  std::ostream* assemblyOut = (outputName || !assembly) ? &out : NULL;
+  if (emissions & EAst) {
+    out << '\n';
+    program.print(out);
+    out << '\n';
+  };
+  if (threads > 0) {
+    // the phases are interleaved between the functions: only the optimized
+    // SSA form is written
+    program.computeSSA(threads);
+    if (emissions & ESsa)
+    emitInstructions(out, program);
+    if (phiStatistics)
+    program.printPhiStatistics(std::cerr);
+    if ((emissions & EAssembly) && !writeAssembly(program, assemblyOut, fileName))
+    return 1;
+    if (statistics)
+    program.printStatistics(std::cerr);
+    out.flush();
+    if (runs > 0 || printBytecode)
+    return reportPhases(program.runBytecode(fileName ? fileName : "a.out", runs, printBytecode, std::cerr),
+        profiler.get(), profileFormat);
+    return reportPhases(0, profiler.get(), profileFormat);
+  };
+  if (!compileProgram(program, emissions, out, assemblyOut, fileName, phiStatistics, statistics, std::cerr))
+  return 1;
+  if (runs > 0 || printBytecode)
+  return reportPhases(program.runBytecode(fileName ? fileName : "a.out", runs, printBytecode, std::cerr),
+      profiler.get(), profileFormat);
+  return reportPhases(0, profiler.get(), profileFormat);
 }
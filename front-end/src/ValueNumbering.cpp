@@ -0,0 +1,262 @@
+#include "ValueNumbering.h"
+
+ValueNumbering::ValueNumbering(Function& function)
+  :  m_function(function), m_graph(function.controlFlow()), m_chains(m_graph),
+    m_count(0), m_redundantExpressions(0) {
+  m_variableNumbers.assign(m_chains.countVariables(), -1);
+  m_variables.assign(m_chains.countVariables(), NULL);
+}
+
+int
+ValueNumbering::newNumber() {
+  m_leaders.push_back(-1);
+  return m_count++;
+}
+
+int
+ValueNumbering::findNumber(const Key& key) {
+  std::map<Key, int>::const_iterator found = m_numbers.find(key);
+  if (found != m_numbers.end())
+    return found->second;
+  int result = newNumber();
+  m_numbers.insert(std::make_pair(key, result));
+  return result;
+}
+
+void
+ValueNumbering::setLeader(int number, int variable) {
+  m_oldLeaders.push_back(std::make_pair(number, m_leaders[number]));
+  m_leaders[number] = variable;
+}
+
+int
+ValueNumbering::number(const VirtualExpression& expression) {
+  // -1 for an expression whose value is not known by its operands
+  switch (expression.type()) {
+    case VirtualExpression::TConstant:
+      assert(dynamic_cast<const ConstantExpression*>(&expression));
+      return findNumber(Key(VirtualExpression::TConstant, 0, ((const ConstantExpression&) expression).value(), 0));
+    case VirtualExpression::TChar:
+      assert(dynamic_cast<const CharExpression*>(&expression));
+      return findNumber(Key(VirtualExpression::TConstant, 0, ((const CharExpression&) expression).value(), 0));
+    case VirtualExpression::TLocalVariable:
+      {  int variable = m_chains.findVariable(expression);
+        return (variable >= 0 && m_chains.isSSA(variable)) ? m_variableNumbers[variable] : -1;
+      };
+    case VirtualExpression::TParameter:
+      {  assert(dynamic_cast<const ParameterExpression*>(&expression));
+        int index = ((const ParameterExpression&) expression).getIndex();
+        if (m_chains.isAssignedParameter(index) || !DefUseChains::isInteger(expression, &m_function))
+          return -1;
+        return findNumber(Key(VirtualExpression::TParameter, 0, index, 0));
+      };
+    case VirtualExpression::TComparison:
+      {  assert(dynamic_cast<const ComparisonExpression*>(&expression));
+        const ComparisonExpression& comparison = (const ComparisonExpression&) expression;
+        int fst = number(comparison.getFst()), snd = number(comparison.getSnd());
+        if (fst < 0 || snd < 0)
+          return -1;
+        ComparisonExpression::Operator operatorCode = comparison.getOperator();
+        if (operatorCode == ComparisonExpression::OCompareGreater
+            || operatorCode == ComparisonExpression::OCompareGreaterOrEqual) {
+          // a > b is b < a
+          operatorCode = (operatorCode == ComparisonExpression::OCompareGreater)
+            ? ComparisonExpression::OCompareLess : ComparisonExpression::OCompareLessOrEqual;
+          std::swap(fst, snd);
+        }
+        else if ((operatorCode == ComparisonExpression::OCompareEqual
+              || operatorCode == ComparisonExpression::OCompareDifferent) && snd < fst)
+          std::swap(fst, snd);
+        return findNumber(Key(VirtualExpression::TComparison, operatorCode, fst, snd));
+      };
+    case VirtualExpression::TBinaryOperator:
+      {  assert(dynamic_cast<const BinaryOperatorExpression*>(&expression));
+        const BinaryOperatorExpression& binary = (const BinaryOperatorExpression&) expression;
+        int fst = number(binary.getFst()), snd = number(binary.getSnd());
+        if (fst < 0 || snd < 0)
+          return -1;
+        if ((binary.getOperator() == BinaryOperatorExpression::OPlus
+              || binary.getOperator() == BinaryOperatorExpression::OTimes) && snd < fst)
+          std::swap(fst, snd);
+        return findNumber(Key(VirtualExpression::TBinaryOperator, binary.getOperator(), fst, snd));
+      };
+    case VirtualExpression::TUnaryOperator:
+      {  assert(dynamic_cast<const UnaryOperatorExpression*>(&expression));
+        const UnaryOperatorExpression& unary = (const UnaryOperatorExpression&) expression;
+        int sub = number(unary.getSubExpression());
+        return (sub >= 0) ? findNumber(Key(VirtualExpression::TUnaryOperator, unary.getOperator(), sub, 0)) : -1;
+      };
+    default:
+      return -1;
+  };
+}
+
+VirtualExpression*
+ValueNumbering::replace(VirtualExpression& expression) {
+  // returns the leader replacing expression, NULL to keep it
+  if (expression.type() == VirtualExpression::TComparison
+      || expression.type() == VirtualExpression::TBinaryOperator
+      || expression.type() == VirtualExpression::TUnaryOperator) {
+    int value = number(expression);
+    if (value >= 0 && m_leaders[value] >= 0) {
+      ++m_redundantExpressions;
+      return m_variables[m_leaders[value]]->clone();
+    };
+  };
+  replaceOperands(expression);
+  return NULL;
+}
+
+void
+ValueNumbering::replaceOperands(VirtualExpression& expression) {
+  VirtualExpression* replacement;
+  switch (expression.type()) {
+    case VirtualExpression::TComparison:
+      {  assert(dynamic_cast<const ComparisonExpression*>(&expression));
+        ComparisonExpression& comparison = (ComparisonExpression&) expression;
+        if ((replacement = replace(comparison.getFst())) != NULL)
+          comparison.setFst(replacement);
+        if ((replacement = replace(comparison.getSnd())) != NULL)
+          comparison.setSnd(replacement);
+      };
+      break;
+    case VirtualExpression::TBinaryOperator:
+      {  assert(dynamic_cast<const BinaryOperatorExpression*>(&expression));
+        BinaryOperatorExpression& binary = (BinaryOperatorExpression&) expression;
+        if ((replacement = replace(binary.getFst())) != NULL)
+          binary.setFst(replacement);
+        if ((replacement = replace(binary.getSnd())) != NULL)
+          binary.setSnd(replacement);
+      };
+      break;
+    case VirtualExpression::TUnaryOperator:
+      assert(dynamic_cast<const UnaryOperatorExpression*>(&expression));
+      if ((replacement = replace(((UnaryOperatorExpression&) expression).getSubExpression())) != NULL)
+        ((UnaryOperatorExpression&) expression).setSubExpression(replacement);
+      break;
+    case VirtualExpression::TCast:
+      assert(dynamic_cast<const CastExpression*>(&expression));
+      if ((replacement = replace(((CastExpression&) expression).getSubExpression())) != NULL)
+        ((CastExpression&) expression).setSubExpression(replacement);
+      break;
+    case VirtualExpression::TDereference:
+      // the variable of a reference keeps its address
+      if (!dynamic_cast<const ReferenceExpression*>(&expression)) {
+        assert(dynamic_cast<const DereferenceExpression*>(&expression));
+        if ((replacement = replace(((DereferenceExpression&) expression).getSubExpression())) != NULL)
+          ((DereferenceExpression&) expression).setSubExpression(replacement);
+      };
+      break;
+    case VirtualExpression::TFunctionCall:
+      {  assert(dynamic_cast<const FunctionCallExpression*>(&expression));
+        FunctionCallExpression& call = (FunctionCallExpression&) expression;
+        for (int index = 0; index < call.countArguments(); ++index)
+          if ((replacement = replace(call.getArgument(index))) != NULL)
+            call.setArgument(index, replacement);
+      };
+      break;
+    case VirtualExpression::TAssign:
+      {  assert(dynamic_cast<const AssignExpression*>(&expression));
+        AssignExpression& assign = (AssignExpression&) expression;
+        if ((replacement = replace(assign.getRValue())) != NULL)
+          assign.setRValue(replacement);
+        if (!DefUseChains::isVariable(assign.getLValue()))
+          replaceOperands(assign.getLValue());
+      };
+      break;
+    default:
+      break;
+  };
+}
+
+void
+ValueNumbering::visit(VirtualInstruction& instruction) {
+  if (instruction.type() == VirtualInstruction::TExpression) {
+    assert(dynamic_cast<const ExpressionInstruction*>(&instruction));
+    ExpressionInstruction& expressionInstruction = (ExpressionInstruction&) instruction;
+    VirtualExpression& expression = expressionInstruction.getExpression();
+    int variable = -1;
+    if (expression.type() == VirtualExpression::TAssign) {
+      assert(dynamic_cast<const AssignExpression*>(&expression));
+      variable = m_chains.findVariable(((AssignExpression&) expression).getLValue());
+      if (variable >= 0 && !m_chains.isSSA(variable))
+        variable = -1;
+    };
+    if (variable < 0) {
+      replaceOperands(expression);
+      return;
+    };
+    AssignExpression& assign = (AssignExpression&) expression;
+    assert(dynamic_cast<const LocalVariableExpression*>(&assign.getLValue()));
+    m_variables[variable] = (const LocalVariableExpression*) &assign.getLValue();
+    if (expressionInstruction.isPhi() || !DefUseChains::isInteger(assign.getLValue())) {
+      replaceOperands(assign);
+      m_variableNumbers[variable] = newNumber();
+      return;
+    };
+    VirtualExpression* replacement = replace(assign.getRValue());
+    if (replacement)
+      assign.setRValue(replacement);
+    int value = number(assign.getRValue());
+    if (value < 0)
+      value = newNumber();
+    m_variableNumbers[variable] = value;
+    if (m_leaders[value] < 0)
+      setLeader(value, variable);
+  }
+  else if (instruction.type() == VirtualInstruction::TIf) {
+    assert(dynamic_cast<const IfInstruction*>(&instruction));
+    IfInstruction& ifInstruction = (IfInstruction&) instruction;
+    VirtualExpression* replacement = replace(ifInstruction.getExpression());
+    if (replacement)
+      ifInstruction.setExpression(replacement);
+  }
+  else if (instruction.type() == VirtualInstruction::TReturn) {
+    assert(dynamic_cast<const ReturnInstruction*>(&instruction));
+    ReturnInstruction& returnInstruction = (ReturnInstruction&) instruction;
+    VirtualExpression* replacement = replace(returnInstruction.getResult());
+    if (replacement)
+      returnInstruction.setResult(replacement);
+  };
+}
+
+void
+ValueNumbering::visitBlock(int block) {
+  VirtualInstruction* instruction = &m_graph.first(block);
+  while (true) {
+    visit(*instruction);
+    if (instruction == &m_graph.last(block))
+      break;
+    instruction = instruction->getSNextInstruction();
+  };
+}
+
+void
+ValueNumbering::apply() {
+  if (!m_graph.hasDominators())
+    m_graph.computeDominators();
+  // preorder of the dominator tree, each level remembering the leaders to
+  // restore when it is left
+  std::vector<std::pair<int, int> > stack;
+  std::vector<int> leaderStarts;
+  visitBlock(m_graph.entry());
+  stack.push_back(std::make_pair(m_graph.entry(), 0));
+  leaderStarts.push_back(0);
+  while (!stack.empty()) {
+    int block = stack.back().first;
+    int& childIndex = stack.back().second;
+    if (childIndex < m_graph.countChildren(block)) {
+      int child = m_graph.child(block, childIndex++);
+      leaderStarts.push_back(m_oldLeaders.size());
+      visitBlock(child);
+      stack.push_back(std::make_pair(child, 0));
+    }
+    else {
+      for (int index = m_oldLeaders.size()-1; index >= leaderStarts.back(); --index)
+        m_leaders[m_oldLeaders[index].first] = m_oldLeaders[index].second;
+      m_oldLeaders.resize(leaderStarts.back());
+      leaderStarts.pop_back();
+      stack.pop_back();
+    };
+  };
+}